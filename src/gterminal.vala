@@ -545,6 +545,288 @@ namespace GTerminal
     return run (receiver);
   }
 
+  /* Batch runner */
+
+  private class BatchJob : Object
+  {
+    public string name;
+    public string[]? argv = null;
+    public string? profile = null;
+    public string? working_directory = null;
+
+    public int exit_code = -1;
+    public string? error_message = null;
+    public int64 start_time = 0;
+    public int64 end_time = 0;
+
+    private Receiver? receiver = null;
+
+    public signal void done ();
+
+    public BatchJob (string name)
+    {
+      this.name = name;
+    }
+
+    private void finish (int code,
+                         string? message)
+    {
+      if (end_time != 0)
+        return;
+
+      end_time = get_monotonic_time ();
+      exit_code = code;
+      error_message = message;
+      receiver = null;
+      done ();
+    }
+
+    /* Marks the job as failed without launching it */
+    public void skip (string message)
+    {
+      start_time = get_monotonic_time ();
+      finish (-1, message);
+    }
+
+    /* Creates the terminal (as a new tab in @window_id if non-zero),
+     * and starts the command. Returns the ID of the window the terminal
+     * was created in, or 0 on failure.
+     */
+    public async uint launch (Server server,
+                              uint window_id,
+                              string? startup_id,
+                              bool active)
+    {
+      start_time = get_monotonic_time ();
+
+      try {
+        var builder = new GLib.VariantBuilder (VariantType.VARDICT);
+        Terminal.Client.append_create_instance_options (builder,
+                                                        OpenOptions.display_name,
+                                                        startup_id,
+                                                        OpenOptions.geometry,
+                                                        OpenOptions.role,
+                                                        profile != null ? profile : OpenOptions.profile,
+                                                        null /* title */,
+                                                        active,
+                                                        OpenOptions.maximise,
+                                                        OpenOptions.fullscreen);
+        if (window_id != 0)
+          builder.add ("{sv}", "window-id", new Variant.uint32 (window_id));
+        if (OpenOptions.show_menubar_set)
+          builder.add ("{sv}", "show-menubar", new Variant.boolean (OpenOptions.show_menubar));
+
+        var path = yield server.call ("CreateInstance" /* (a{sv}) */,
+                                      new Variant ("(a{sv})", builder),
+                                      DBusCallFlags.NO_AUTO_START, -1,
+                                      null);
+
+        string obj_path;
+        path.get ("(o)", out obj_path);
+
+        receiver = yield Bus.get_proxy (BusType.SESSION,
+                                        GlobalOptions.get_app_id (),
+                                        obj_path,
+                                        DBusProxyFlags.DO_NOT_LOAD_PROPERTIES);
+
+        /* Connect before Exec so that a quickly exiting child isn't missed */
+        receiver.ChildExited.connect ((s) => {
+          finish (mangle_exit_code (s), null);
+        });
+
+        var exec = new GLib.VariantBuilder (VariantType.TUPLE);
+        exec.open (VariantType.VARDICT); {
+          Terminal.Client.append_exec_options (exec,
+                                               working_directory != null ? working_directory
+                                                                         : OpenOptions.working_directory,
+                                               null /* fd array */,
+                                               argv == null);
+        } exec.close ();
+        exec.add_value (new Variant.bytestring_array (argv));
+
+        yield receiver.call ("Exec" /* (a{sv}aay) */,
+                             exec.end (),
+                             DBusCallFlags.NO_AUTO_START, -1,
+                             null);
+
+        return window_id_from_object_path (obj_path);
+      } catch (Error e) {
+        DBusError.strip_remote_error (e);
+        finish (-1, e.message);
+        return 0;
+      }
+    }
+  }
+
+  private uint window_id_from_object_path (string path)
+  {
+    var p = path.index_of ("/window/");
+    if (p < 0)
+      return 0;
+
+    var id = path.substring (p + "/window/".length);
+    var end = id.index_of_char ('/');
+    if (end <= 0)
+      return 0;
+
+    int64 v;
+    if (!int64.try_parse (id.substring (0, end), out v) ||
+        v <= 0 || v > uint.MAX)
+      return 0;
+
+    return (uint) v;
+  }
+
+  /* The first job of a group creates the window, the others are
+   * then launched concurrently as tabs in it. If the window could not
+   * be created, the rest of the group is skipped.
+   *
+   * The startup ID belongs to a single window, so only the first group
+   * gets it.
+   */
+  private async void batch_launch_group (Server server,
+                                         GenericArray<BatchJob> jobs,
+                                         string? startup_id)
+  {
+    var window_id = yield jobs[0].launch (server, 0, startup_id, true);
+    for (uint i = 1; i < jobs.length; i++) {
+      if (window_id == 0)
+        jobs[i].skip ("Not started because \"%s\" failed to open the window".printf (jobs[0].name));
+      else
+        jobs[i].launch.begin (server, window_id, null, false);
+    }
+  }
+
+  private string json_quote (string str)
+  {
+    var b = new StringBuilder ("\"");
+    for (int i = 0; i < str.length; i++) {
+      char c = str[i];
+      switch (c) {
+      case '"':  b.append ("\\\""); break;
+      case '\\': b.append ("\\\\"); break;
+      case '\n': b.append ("\\n"); break;
+      case '\r': b.append ("\\r"); break;
+      case '\t': b.append ("\\t"); break;
+      default:
+        if ((uchar) c < 0x20)
+          b.append_printf ("\\u%04x", (uint) c);
+        else
+          b.append_c (c);
+        break;
+      }
+    }
+    b.append_c ('"');
+    return b.str;
+  }
+
+  /* Reads a manifest keyfile with one group per command:
+   *
+   *   [build]
+   *   Command=make -j8
+   *   Profile=<uuid or name>
+   *   WorkingDirectory=/srv/app
+   *   Window=deploy
+   *
+   * Commands sharing the same Window value are opened as tabs of one
+   * window; a missing Command opens the user's shell.
+   */
+  private int batch (string[] argv) throws Error
+  {
+    OpenOptions.parse_argv (argv);
+
+    if (OpenOptions.argv_post != null)
+      throw new OptionError.BAD_VALUE (_("Extraneous arguments after '--'"));
+    if (OpenOptions.fd_list != null)
+      throw new OptionError.BAD_VALUE (_("FD passing is not supported for '%s'"), argv[0]);
+    if (OpenOptions.argv_pre == null || OpenOptions.argv_pre.length < 2)
+      throw new OptionError.UNKNOWN_OPTION (_("Missing argument"));
+
+    var manifest = new KeyFile ();
+    manifest.load_from_file (OpenOptions.argv_pre[1], KeyFileFlags.NONE);
+
+    var profiles = new Terminal.ProfilesList ();
+    var jobs = new GenericArray<BatchJob> ();
+    var groups = new GenericArray<GenericArray<BatchJob>> ();
+    var groups_by_name = new HashTable<string, GenericArray<BatchJob>> (str_hash, str_equal);
+
+    foreach (var name in manifest.get_groups ()) {
+      var job = new BatchJob (name);
+
+      if (manifest.has_key (name, "Command")) {
+        string[] cmd_argv;
+        Shell.parse_argv (manifest.get_string (name, "Command"), out cmd_argv);
+        job.argv = cmd_argv;
+      }
+      if (manifest.has_key (name, "Profile")) {
+        /* Profile names are resolved by the server */
+        var profile = manifest.get_string (name, "Profile");
+        if (Terminal.SettingsList.valid_uuid (profile))
+          profile = profiles.dup_uuid (profile);
+        job.profile = profile;
+      }
+      if (manifest.has_key (name, "WorkingDirectory"))
+        job.working_directory = manifest.get_string (name, "WorkingDirectory");
+
+      GenericArray<BatchJob>? group = null;
+      if (manifest.has_key (name, "Window")) {
+        var window = manifest.get_string (name, "Window");
+        group = groups_by_name.lookup (window);
+        if (group == null) {
+          group = new GenericArray<BatchJob> ();
+          groups_by_name.insert (window, group);
+          groups.add (group);
+        }
+      } else {
+        group = new GenericArray<BatchJob> ();
+        groups.add (group);
+      }
+
+      group.add (job);
+      jobs.add (job);
+    }
+
+    if (jobs.length == 0)
+      throw new OptionError.BAD_VALUE (_("No commands in \"%s\""), OpenOptions.argv_pre[1]);
+
+    var loop = new GLib.MainLoop ();
+    uint pending = jobs.length;
+    for (uint i = 0; i < jobs.length; i++) {
+      jobs[i].done.connect (() => {
+        if (--pending == 0 && loop.is_running ())
+          loop.quit ();
+      });
+    }
+
+    var server = get_server ();
+    for (uint i = 0; i < groups.length; i++)
+      batch_launch_group.begin (server, groups[i], i == 0 ? OpenOptions.startup_id : null);
+
+    if (pending > 0)
+      loop.run ();
+
+    bool success = true;
+    var json = new StringBuilder ("{\n  \"jobs\": [");
+    for (uint i = 0; i < jobs.length; i++) {
+      var job = jobs[i];
+
+      json.append_printf ("%s\n    { \"name\": %s, ", i > 0 ? "," : "", json_quote (job.name));
+      if (job.error_message != null)
+        json.append_printf ("\"exit-code\": null, \"error\": %s, ", json_quote (job.error_message));
+      else
+        json.append_printf ("\"exit-code\": %d, ", job.exit_code);
+      json.append_printf ("\"wall-time-ms\": %.3f }",
+                          (double) (job.end_time - job.start_time) / 1000.0);
+
+      if (job.exit_code != 0)
+        success = false;
+    }
+    json.append ("\n  ]\n}\n");
+    Output.print ("%s", json.str);
+
+    return success ? Posix.EXIT_SUCCESS : Posix.EXIT_FAILURE;
+  }
+
   private int help (string[] argv) throws Error
   {
     /* FIXME: launch man pager for gterminal(1) */
@@ -684,15 +966,21 @@ namespace GTerminal
     if (!Terminal.SettingsList.valid_uuid (uuid))
       throw new OptionError.BAD_VALUE ("\"%s\" is not a valid profile UUID", uuid);
 
+    int64 count = 1;
+    if (argv.length > 2 &&
+        (!int64.try_parse (argv[2], out count) || count < 1 || count > Terminal.SettingsList.MAX_CLONES))
+      throw new OptionError.BAD_VALUE ("\"%s\" is not a valid number of clones", argv[2]);
+
     var service = new Terminal.ProfilesList ();
     if (!service.has_child (uuid))
       throw new OptionError.BAD_VALUE ("No profile with UUID \"%s\" exists", uuid);
 
-    var new_uuid = service.clone_child (uuid);
-    if (new_uuid == null)
+    var new_uuids = service.clone_child_n (uuid, (uint) count);
+    if (new_uuids == null)
       throw new OptionError.FAILED ("Failed to clone profile \"%s\"", uuid);
 
-    Output.print ("%s\n", new_uuid);
+    for (uint i = 0; i < new_uuids.length; i++)
+      Output.print ("%s\n", new_uuids[i]);
     Settings.sync ();
     return Posix.EXIT_SUCCESS;
   }
@@ -715,12 +1003,58 @@ namespace GTerminal
     return Posix.EXIT_SUCCESS;
   }
 
+  private int profiles_export (string[] argv) throws Error
+  {
+    if (argv.length < 2)
+      throw new OptionError.UNKNOWN_OPTION (_("Missing argument"));
+
+    var filename = argv[1];
+    string[]? uuids = null;
+    if (argv.length > 2) {
+      uuids = argv[2:argv.length];
+      for (uint i = 0; i < uuids.length; i++) {
+        if (!Terminal.SettingsList.valid_uuid (uuids[i]))
+          throw new OptionError.BAD_VALUE ("\"%s\" is not a valid profile UUID", uuids[i]);
+      }
+    }
+
+    var service = new Terminal.ProfilesList ();
+    var keyfile = new KeyFile ();
+    service.export_children (uuids, keyfile);
+
+    if (filename == "-")
+      stdout.puts (keyfile.to_data ());
+    else
+      keyfile.save_to_file (filename);
+
+    return Posix.EXIT_SUCCESS;
+  }
+
+  private int profiles_import (string[] argv) throws Error
+  {
+    if (argv.length < 2)
+      throw new OptionError.UNKNOWN_OPTION (_("Missing argument"));
+
+    var keyfile = new KeyFile ();
+    keyfile.load_from_file (argv[1], KeyFileFlags.NONE);
+
+    var service = new Terminal.ProfilesList ();
+    var uuids = service.import_children (keyfile);
+    for (uint i = 0; i < uuids.length; i++)
+      Output.print ("%s\n", uuids[i]);
+
+    Settings.sync ();
+    return Posix.EXIT_SUCCESS;
+  }
+
   private int profiles (string[] argv) throws Error
   {
     var map = new Verb[] {
       Verb ("add", profiles_add),
       Verb ("clone", profiles_clone),
+      Verb ("export", profiles_export),
       Verb ("get-default", profiles_get_default),
+      Verb ("import", profiles_import),
       Verb ("list", profiles_list),
       Verb ("remove", profiles_remove),
       Verb ("set-default", profiles_set_default)
@@ -742,6 +1076,7 @@ namespace GTerminal
     int status;
     try {
       var map = new Verb[] {
+        Verb ("batch", batch),
         Verb ("help", help),
         Verb ("open", open),
         Verb ("shell", open),
@@ -394,6 +394,11 @@ migrate_profile (TerminalSettingsList *list,
 
   path = gconf_concat_dir_and_key (GCONF_PROFILES_PREFIX, gconf_id);
 
+  /* Collect all changes and write them out in one go; with the DConf
+   * backend this becomes a single changeset instead of one write per key.
+   */
+  g_settings_delay (settings);
+
   migrate_string (client, path, KEY_VISIBLE_NAME,
                   settings, TERMINAL_PROFILE_VISIBLE_NAME_KEY);
 
@@ -470,6 +475,11 @@ migrate_profile (TerminalSettingsList *list,
   migrate_string (client, path, KEY_ENCODING,
                   settings, TERMINAL_PROFILE_ENCODING_KEY);
 
+  if (verbose)
+    g_printerr ("Writing profile %s\n", gconf_id);
+
+  g_settings_apply (settings);
+
   g_free (path);
   g_object_unref (settings);
 }
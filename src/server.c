@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <locale.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
@@ -33,6 +34,7 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
+#include <glib-unix.h>
 #include <gio/gio.h>
 
 #include "terminal-app.h"
@@ -44,8 +46,6 @@
 
 static char *app_id = NULL;
 
-#define INACTIVITY_TIMEOUT (100 /* ms */)
-
 static gboolean
 option_app_id_cb (const gchar *option_name,
                     const gchar *value,
@@ -100,6 +100,20 @@ increase_rlimit_nofile (void)
   return TRUE;
 }
 
+#ifdef ENABLE_DEBUG
+
+/* kill -USR1 prints the trace buffer */
+static gboolean
+dump_trace_cb (gpointer user_data)
+{
+  gs_free char *trace = _terminal_debug_trace_dump ();
+
+  g_printerr ("%s", trace);
+  return G_SOURCE_CONTINUE;
+}
+
+#endif /* ENABLE_DEBUG */
+
 enum {
   _EXIT_FAILURE_WRONG_ID = 7,
   _EXIT_FAILURE_NO_UTF8 = 8,
@@ -113,6 +127,7 @@ main (int argc, char **argv)
   gs_unref_object GApplication *app = NULL;
   const char *home_dir, *charset;
   GError *error = NULL;
+  gint64 span;
 
   if (G_UNLIKELY ((getuid () != geteuid () ||
                   getgid () != getegid ()) &&
@@ -155,6 +170,12 @@ main (int argc, char **argv)
 
   _terminal_debug_init ();
 
+#ifdef ENABLE_DEBUG
+  if (_terminal_debug_on (TERMINAL_DEBUG_TRACE) ||
+      _terminal_debug_on (TERMINAL_DEBUG_STALLS))
+    g_unix_signal_add (SIGUSR1, dump_trace_cb, NULL);
+#endif
+
   // FIXMEchpe: just use / here but make sure #565328 doesn't regress
   /* Change directory to $HOME so we don't prevent unmounting, e.g. if the
    * factory is started by nautilus-open-terminal. See bug #565328.
@@ -167,22 +188,27 @@ main (int argc, char **argv)
   g_set_prgname ("gnome-terminal-server");
   g_set_application_name (_("Terminal"));
 
+  span = _terminal_debug_span_begin ("gtk_init_with_args");
   if (!gtk_init_with_args (&argc, &argv, NULL, options, NULL, &error)) {
     g_printerr ("Failed to parse arguments: %s\n", error->message);
     g_error_free (error);
     exit (_EXIT_FAILURE_GTK_INIT);
   }
+  _terminal_debug_span_end (span, "gtk_init_with_args");
 
   if (!increase_rlimit_nofile ()) {
     g_printerr ("Failed to increase RLIMIT_NOFILE: %m\n");
   }
 
   /* Now we can create the app */
+  span = _terminal_debug_span_begin ("terminal_app_new");
   app = terminal_app_new (app_id);
   g_free (app_id);
+  _terminal_debug_span_end (span, "terminal_app_new");
 
-  /* We stay around a bit after the last window closed */
-  g_application_set_inactivity_timeout (app, INACTIVITY_TIMEOUT);
+#ifdef ENABLE_DEBUG
+  _terminal_debug_watchdog_start ();
+#endif
 
   return g_application_run (app, 0, NULL);
 }
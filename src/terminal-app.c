@@ -24,6 +24,7 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
 #include "terminal-intl.h"
 #include "terminal-debug.h"
@@ -38,6 +39,7 @@
 #include "terminal-encoding.h"
 #include "terminal-schemas.h"
 #include "terminal-gdbus.h"
+#include "terminal-options.h"
 #include "terminal-defines.h"
 #include "terminal-prefs.h"
 #include "terminal-libgsystem.h"
@@ -46,18 +48,27 @@
 #include "terminal-search-provider.h"
 #endif /* ENABLE_SEARCH_PROVIDER */
 
-#include <sys/wait.h>
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
 
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
+
 #define DESKTOP_INTERFACE_SETTINGS_SCHEMA       "org.gnome.desktop.interface"
 
 #define SYSTEM_PROXY_SETTINGS_SCHEMA            "org.gnome.system.proxy"
 
 #define GTK_SETTING_PREFER_DARK_THEME           "gtk-application-prefer-dark-theme"
 
+/* We stay around a bit after the last window closed */
+#define INACTIVITY_TIMEOUT (100 /* ms */)
+
+/* Number of recent launches to base the keep-alive time on */
+#define N_RECENT_LAUNCHES (8)
+
 /*
  * Session state is stored entirely in the RestartCommand command line.
  *
@@ -90,6 +101,27 @@ struct _TerminalApp
   GSettings *desktop_interface_settings;
   GSettings *system_proxy_settings;
 
+  gboolean migrating;
+  gint64 migration_start_time;
+  GSList *migration_waiters; /* in reverse order */
+
+  gint64 launch_times[N_RECENT_LAUNCHES]; /* ring buffer */
+  guint n_launches;
+  guint trim_caches_idle_id;
+
+  GQueue spare_windows; /* of owned TerminalWindow */
+  guint refill_spare_windows_idle_id;
+
+  GQueue pty_pool; /* of owned VtePty */
+  guint refill_pty_pool_idle_id;
+  guint pty_pool_hits;
+  guint pty_pool_misses;
+
+  guint scrollback_budget_timeout_id;
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  GMemoryMonitor *memory_monitor;
+#endif
+
 #ifdef ENABLE_SEARCH_PROVIDER
   TerminalSearchProvider *search_provider;
 #endif /* ENABLE_SEARCH_PROVIDER */
@@ -105,6 +137,66 @@ static guint signals[LAST_SIGNAL];
 
 /* Helper functions */
 
+typedef struct {
+  TerminalAppMigratedFunc func;
+  gpointer user_data;
+} MigrationWaiter;
+
+static void
+terminal_app_migration_done (TerminalApp *app)
+{
+  GSList *waiters, *l;
+
+  _terminal_debug_print (TERMINAL_DEBUG_SERVER | TERMINAL_DEBUG_PERF,
+                         "Settings migration took %.3f ms\n",
+                         (g_get_monotonic_time () - app->migration_start_time) / 1000.);
+
+  app->migrating = FALSE;
+
+  /* Run the deferred work in the order it was requested */
+  waiters = g_slist_reverse (app->migration_waiters);
+  app->migration_waiters = NULL;
+
+  for (l = waiters; l != NULL; l = l->next) {
+    MigrationWaiter *waiter = l->data;
+
+    waiter->func (app, waiter->user_data);
+    g_slice_free (MigrationWaiter, waiter);
+  }
+  g_slist_free (waiters);
+}
+
+#ifdef ENABLE_MIGRATION
+static void
+migration_wait_cb (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  GSubprocess *process = G_SUBPROCESS (source);
+  TerminalApp *app = user_data;
+  gs_free_error GError *error = NULL;
+
+  if (!g_subprocess_wait_finish (process, result, &error)) {
+    g_printerr ("Failed to migrate settings: %s\n", error->message);
+  } else if (g_subprocess_get_if_exited (process)) {
+    if (g_subprocess_get_exit_status (process) != 0)
+      g_printerr ("Profile migrator exited with status %d\n",
+                  g_subprocess_get_exit_status (process));
+  } else {
+    g_printerr ("Profile migrator exited abnormally.\n");
+  }
+
+  terminal_app_migration_done (app);
+
+  g_application_release (G_APPLICATION (app));
+  g_object_unref (app);
+}
+#endif /* ENABLE_MIGRATION */
+
+/* Runs the migrator without waiting for it; anything that needs
+ * the profiles is deferred with terminal_app_defer_until_migrated()
+ * until it has finished.
+ */
 static void
 maybe_migrate_settings (TerminalApp *app)
 {
@@ -116,7 +208,7 @@ maybe_migrate_settings (TerminalApp *app)
 #endif
     NULL 
   };
-  int status;
+  gs_unref_object GSubprocess *process = NULL;
   gs_free_error GError *error = NULL;
 #endif /* ENABLE_MIGRATION */
   guint version;
@@ -129,24 +221,19 @@ maybe_migrate_settings (TerminalApp *app)
   }
 
 #ifdef ENABLE_MIGRATION
-  if (!g_spawn_sync (NULL /* our home directory */,
-                     (char **) argv,
-                     NULL /* envv */,
-                     0,
-                     NULL, NULL,
-                     NULL, NULL,
-                     &status,
-                     &error)) {
+  process = g_subprocess_newv (argv, G_SUBPROCESS_FLAGS_NONE, &error);
+  if (process == NULL) {
     g_printerr ("Failed to migrate settings: %s\n", error->message);
     return;
   }
 
-  if (WIFEXITED (status)) {
-    if (WEXITSTATUS (status) != 0)
-      g_printerr ("Profile migrator exited with status %d\n", WEXITSTATUS (status));
-  } else {
-    g_printerr ("Profile migrator exited abnormally.\n");
-  }
+  app->migrating = TRUE;
+  app->migration_start_time = g_get_monotonic_time ();
+
+  /* Don't exit before the migration is done */
+  g_application_hold (G_APPLICATION (app));
+  g_subprocess_wait_async (process, NULL,
+                           migration_wait_cb, g_object_ref (app));
 #else
   g_settings_set_uint (terminal_app_get_global_settings (app),
                        TERMINAL_SETTING_SCHEMA_VERSION,
@@ -298,6 +385,13 @@ terminal_app_encoding_list_notify_cb (GSettings   *settings,
         continue;
 
       encoding = terminal_app_ensure_encoding (app, encodings[i]);
+
+      /* Not known yet; terminal_app_encodings_validated_cb() will
+       * update the list once the encoding has been checked.
+       */
+      if (!encoding->validity_checked)
+        continue;
+
       if (!terminal_encoding_is_valid (encoding))
         continue;
 
@@ -307,6 +401,23 @@ terminal_app_encoding_list_notify_cb (GSettings   *settings,
   g_signal_emit (app, signals[ENCODING_LIST_CHANGED], 0);
 }
 
+static void
+terminal_app_encodings_validated_cb (GObject      *source,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  TerminalApp *app = user_data;
+  gs_free_error GError *error = NULL;
+
+  if (terminal_encodings_validate_finish (app->encodings, result, &error))
+    terminal_app_encoding_list_notify_cb (app->global_settings, "encodings", app);
+  else if (error != NULL)
+    _terminal_debug_print (TERMINAL_DEBUG_ENCODINGS,
+                           "Failed to validate encodings: %s\n", error->message);
+
+  g_object_unref (app);
+}
+
 #if GTK_CHECK_VERSION (3, 19, 0)
 static void
 terminal_app_theme_variant_changed_cb (GSettings   *settings,
@@ -326,6 +437,432 @@ terminal_app_theme_variant_changed_cb (GSettings   *settings,
 }
 #endif /* GTK+ 3.19 */
 
+/* Keep-alive policy
+ *
+ * If terminals were opened frequently in the recent past, we stay around
+ * for twice the mean interval between those launches after the last
+ * window is closed (up to the configured maximum), so that the next launch
+ * doesn't have to pay for D-Bus activation and GTK+ initialisation again.
+ */
+
+static void
+terminal_app_update_inactivity_timeout (TerminalApp *app)
+{
+  guint max_timeout, timeout, n;
+
+  max_timeout = g_settings_get_uint (app->global_settings,
+                                     TERMINAL_SETTING_SERVER_KEEP_ALIVE_MAX_KEY) * 1000;
+  timeout = INACTIVITY_TIMEOUT;
+
+  n = MIN (app->n_launches, N_RECENT_LAUNCHES);
+  if (max_timeout > INACTIVITY_TIMEOUT && n >= 2) {
+    gint64 oldest, newest, interval;
+
+    oldest = app->launch_times[(app->n_launches - n) % N_RECENT_LAUNCHES];
+    newest = app->launch_times[(app->n_launches - 1) % N_RECENT_LAUNCHES];
+    interval = (newest - oldest) / (n - 1) / 1000; /* ms */
+
+    if (interval < (gint64) max_timeout)
+      timeout = (guint) CLAMP (2 * interval, INACTIVITY_TIMEOUT, (gint64) max_timeout);
+  }
+
+  _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                         "Inactivity timeout now %u ms\n", timeout);
+
+  g_application_set_inactivity_timeout (G_APPLICATION (app), timeout);
+}
+
+static void
+terminal_app_keep_alive_changed_cb (GSettings   *settings,
+                                    const char  *key,
+                                    TerminalApp *app)
+{
+  terminal_app_update_inactivity_timeout (app);
+}
+
+/* PTY pool
+ *
+ * Opening a PTY pair is on the critical path of every child launch, so
+ * while windows are open we keep a few open PTYs around for
+ * terminal_screen_do_exec() to take. A PTY is never reused once a child
+ * has been attached to it.
+ */
+
+static gboolean
+terminal_app_refill_pty_pool_cb (TerminalApp *app)
+{
+  VtePty *pty;
+  gint64 start_time;
+  GError *error = NULL;
+
+  if (g_queue_get_length (&app->pty_pool) >=
+      g_settings_get_uint (app->global_settings, TERMINAL_SETTING_PTY_POOL_SIZE_KEY) ||
+      gtk_application_get_windows (GTK_APPLICATION (app)) == NULL)
+    goto done;
+
+  start_time = g_get_monotonic_time ();
+
+  pty = vte_pty_new_sync (VTE_PTY_DEFAULT, NULL, &error);
+  if (pty == NULL) {
+    _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                           "Failed to open a PTY for the pool: %s\n",
+                           error->message);
+    g_error_free (error);
+    goto done;
+  }
+
+  g_queue_push_tail (&app->pty_pool, pty);
+
+  _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                         "PTY allocation took %.3f ms (%u in pool)\n",
+                         (g_get_monotonic_time () - start_time) / 1000.,
+                         g_queue_get_length (&app->pty_pool));
+
+  return TRUE; /* run again */
+
+done:
+  app->refill_pty_pool_idle_id = 0;
+  return FALSE;
+}
+
+static void
+terminal_app_schedule_refill_pty_pool (TerminalApp *app)
+{
+  if (app->refill_pty_pool_idle_id != 0 ||
+      g_settings_get_uint (app->global_settings, TERMINAL_SETTING_PTY_POOL_SIZE_KEY) == 0)
+    return;
+
+  app->refill_pty_pool_idle_id =
+    g_idle_add_full (G_PRIORITY_LOW,
+                     (GSourceFunc) terminal_app_refill_pty_pool_cb,
+                     app, NULL);
+}
+
+static void
+terminal_app_clear_pty_pool (TerminalApp *app)
+{
+  VtePty *pty;
+
+  if (app->refill_pty_pool_idle_id != 0) {
+    g_source_remove (app->refill_pty_pool_idle_id);
+    app->refill_pty_pool_idle_id = 0;
+  }
+
+  while ((pty = g_queue_pop_head (&app->pty_pool)) != NULL)
+    g_object_unref (pty);
+}
+
+static void
+terminal_app_pty_pool_size_changed_cb (GSettings   *settings,
+                                       const char  *key,
+                                       TerminalApp *app)
+{
+  guint size;
+  VtePty *pty;
+
+  /* Close the PTYs beyond the new size; the refill takes care of growing */
+  size = g_settings_get_uint (settings, TERMINAL_SETTING_PTY_POOL_SIZE_KEY);
+  while (g_queue_get_length (&app->pty_pool) > size &&
+         (pty = g_queue_pop_tail (&app->pty_pool)) != NULL)
+    g_object_unref (pty);
+
+  terminal_app_schedule_refill_pty_pool (app);
+}
+
+/* While we're idle (no windows open) and waiting to exit, drop what we
+ * can recreate cheaply, so that staying around costs little memory.
+ */
+static gboolean
+terminal_app_trim_caches_cb (TerminalApp *app)
+{
+  app->trim_caches_idle_id = 0;
+
+  if (gtk_application_get_windows (GTK_APPLICATION (app)) != NULL ||
+      g_hash_table_size (app->screen_map) != 0)
+    return FALSE;
+
+  _terminal_debug_print (TERMINAL_DEBUG_SERVER, "Trimming caches\n");
+
+  terminal_app_clear_pty_pool (app);
+
+  _terminal_screen_trim_caches ();
+
+#ifdef HAVE_MALLOC_TRIM
+  malloc_trim (0);
+#endif
+
+  return FALSE;
+}
+
+/* Spare window pool
+ *
+ * While real windows are open, we keep a few hidden windows around, each
+ * with a terminal whose PTY is already open, so that a new window only
+ * needs its profile applied before being shown. They are thrown away when
+ * the last real window closes, so they don't keep the server alive.
+ */
+
+static guint
+terminal_app_get_spare_window_pool_size (TerminalApp *app)
+{
+  return g_settings_get_uint (app->global_settings,
+                              TERMINAL_SETTING_SPARE_WINDOW_POOL_SIZE_KEY);
+}
+
+/* Like gtk_application_get_active_window(), but skips the spare windows,
+ * which are registered with the application but never shown.
+ */
+static GtkWindow *
+terminal_app_get_active_real_window (TerminalApp *app)
+{
+  GList *l;
+
+  for (l = gtk_application_get_windows (GTK_APPLICATION (app)); l != NULL; l = l->next)
+    if (g_queue_find (&app->spare_windows, l->data) == NULL)
+      return l->data;
+
+  return NULL;
+}
+
+static gboolean
+terminal_app_has_real_windows (TerminalApp *app)
+{
+  return terminal_app_get_active_real_window (app) != NULL;
+}
+
+static gboolean
+terminal_app_refill_spare_windows_cb (TerminalApp *app)
+{
+  TerminalWindow *window;
+  TerminalScreen *screen;
+  gs_unref_object GSettings *profile = NULL;
+  gint64 start_time;
+
+  if (g_queue_get_length (&app->spare_windows) >= terminal_app_get_spare_window_pool_size (app) ||
+      !terminal_app_has_real_windows (app))
+    goto done;
+
+  profile = terminal_settings_list_ref_default_child (app->profiles_list);
+  if (profile == NULL)
+    goto done;
+
+  start_time = g_get_monotonic_time ();
+
+  window = terminal_app_new_window (app, gdk_screen_get_default ());
+  screen = terminal_screen_new (profile, NULL, NULL, NULL, 1.0);
+  terminal_window_add_screen (window, screen, -1);
+  gtk_widget_realize (GTK_WIDGET (window));
+  _terminal_screen_prepare_pty (screen);
+
+  g_queue_push_tail (&app->spare_windows, window);
+
+  _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                         "Prepared spare window %p in %.3f ms (%u spare)\n",
+                         window,
+                         (g_get_monotonic_time () - start_time) / 1000.,
+                         g_queue_get_length (&app->spare_windows));
+
+  /* One window per idle iteration, so as not to block the main loop for long */
+  if (g_queue_get_length (&app->spare_windows) < terminal_app_get_spare_window_pool_size (app))
+    return TRUE; /* run again */
+
+done:
+  app->refill_spare_windows_idle_id = 0;
+  return FALSE;
+}
+
+static void
+terminal_app_schedule_refill_spare_windows (TerminalApp *app)
+{
+  if (app->refill_spare_windows_idle_id != 0 ||
+      terminal_app_get_spare_window_pool_size (app) == 0)
+    return;
+
+  app->refill_spare_windows_idle_id =
+    g_idle_add_full (G_PRIORITY_LOW,
+                     (GSourceFunc) terminal_app_refill_spare_windows_cb,
+                     app, NULL);
+}
+
+static void
+terminal_app_clear_spare_windows (TerminalApp *app)
+{
+  TerminalWindow *window;
+
+  if (app->refill_spare_windows_idle_id != 0) {
+    g_source_remove (app->refill_spare_windows_idle_id);
+    app->refill_spare_windows_idle_id = 0;
+  }
+
+  /* Pop before destroying, since destroying re-enters window_removed */
+  while ((window = g_queue_pop_head (&app->spare_windows)) != NULL)
+    gtk_widget_destroy (GTK_WIDGET (window));
+}
+
+/* Scrollback budget
+ *
+ * With a scrollback budget set, we periodically add up the estimated
+ * scrollback size of all terminals, and when it is over budget, trim the
+ * terminals that aren't being shown, least recently viewed first, down to
+ * the floor. Low memory warnings lower the target further.
+ */
+
+#define SCROLLBACK_BUDGET_CHECK_INTERVAL (30) /* s */
+
+static gint
+compare_screens_by_last_viewed_time (gconstpointer a,
+                                     gconstpointer b)
+{
+  gint64 ta = terminal_screen_get_last_viewed_time ((TerminalScreen *) a);
+  gint64 tb = terminal_screen_get_last_viewed_time ((TerminalScreen *) b);
+
+  return ta < tb ? -1 : ta > tb ? 1 : 0;
+}
+
+static void
+terminal_app_enforce_scrollback_budget (TerminalApp *app,
+                                        gsize        target)
+{
+  GHashTableIter iter;
+  gpointer value;
+  GList *candidates = NULL, *l;
+  gsize total = 0, freed = 0;
+  glong floor_lines;
+  gint64 span;
+
+  span = _terminal_debug_span_begin ("scrollback budget");
+
+  g_hash_table_iter_init (&iter, app->screen_map);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    TerminalScreen *screen = value;
+    GtkWidget *toplevel;
+
+    total += terminal_screen_get_scrollback_size (screen);
+
+    if (gtk_widget_get_mapped (GTK_WIDGET (screen)))
+      continue;
+
+    toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+    if (gtk_widget_is_toplevel (toplevel) &&
+        g_queue_find (&app->spare_windows, toplevel) != NULL)
+      continue;
+
+    candidates = g_list_prepend (candidates, screen);
+  }
+
+  if (total <= target)
+    goto out;
+
+  floor_lines = g_settings_get_uint (app->global_settings,
+                                     TERMINAL_SETTING_SCROLLBACK_BUDGET_FLOOR_KEY);
+
+  candidates = g_list_sort (candidates, compare_screens_by_last_viewed_time);
+  for (l = candidates; l != NULL && total - freed > target; l = l->next)
+    freed += terminal_screen_trim_scrollback (l->data, floor_lines);
+
+  _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                         "Scrollback at %" G_GSIZE_FORMAT " bytes, over the target of %" G_GSIZE_FORMAT "; "
+                         "trimmed %" G_GSIZE_FORMAT " bytes\n",
+                         total, target, freed);
+  _terminal_debug_counter_add ("scrollback bytes trimmed", freed);
+
+out:
+  g_list_free (candidates);
+  _terminal_debug_span_end (span, "scrollback budget");
+}
+
+static gsize
+terminal_app_get_scrollback_budget (TerminalApp *app)
+{
+  return (gsize) g_settings_get_uint (app->global_settings,
+                                      TERMINAL_SETTING_SCROLLBACK_BUDGET_KEY) * 1024 * 1024;
+}
+
+static gboolean
+terminal_app_scrollback_budget_timeout_cb (TerminalApp *app)
+{
+  terminal_app_enforce_scrollback_budget (app, terminal_app_get_scrollback_budget (app));
+  return TRUE; /* run again */
+}
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+
+static void
+terminal_app_low_memory_warning_cb (GMemoryMonitor             *monitor,
+                                    GMemoryMonitorWarningLevel  level,
+                                    TerminalApp                *app)
+{
+  gsize budget, target;
+
+  budget = terminal_app_get_scrollback_budget (app);
+  if (budget == 0)
+    return;
+
+  if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL)
+    target = 0;
+  else if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM)
+    target = budget / 4;
+  else
+    target = budget / 2;
+
+  _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                         "Low memory warning (level %d)\n", level);
+
+  terminal_app_enforce_scrollback_budget (app, target);
+}
+
+static void
+terminal_app_set_memory_monitor_enabled (TerminalApp *app,
+                                         gboolean     enabled)
+{
+  if (enabled == (app->memory_monitor != NULL))
+    return;
+
+  if (enabled) {
+    /* Newer than GLIB_VERSION_MAX_ALLOWED, but only built when available */
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+    app->memory_monitor = g_memory_monitor_dup_default ();
+    G_GNUC_END_IGNORE_DEPRECATIONS
+    g_signal_connect (app->memory_monitor, "low-memory-warning",
+                      G_CALLBACK (terminal_app_low_memory_warning_cb), app);
+  } else {
+    g_signal_handlers_disconnect_by_func (app->memory_monitor,
+                                          G_CALLBACK (terminal_app_low_memory_warning_cb),
+                                          app);
+    g_clear_object (&app->memory_monitor);
+  }
+}
+
+#endif /* GLib 2.64 */
+
+static void
+terminal_app_scrollback_budget_changed_cb (GSettings   *settings,
+                                           const char  *key,
+                                           TerminalApp *app)
+{
+  gboolean enabled;
+
+  if (app->scrollback_budget_timeout_id != 0) {
+    g_source_remove (app->scrollback_budget_timeout_id);
+    app->scrollback_budget_timeout_id = 0;
+  }
+
+  enabled = terminal_app_get_scrollback_budget (app) != 0;
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  /* Only talk to the memory monitor while there's a budget to enforce */
+  terminal_app_set_memory_monitor_enabled (app, enabled);
+#endif
+
+  if (!enabled)
+    return;
+
+  app->scrollback_budget_timeout_id =
+    g_timeout_add_seconds (SCROLLBACK_BUDGET_CHECK_INTERVAL,
+                           (GSourceFunc) terminal_app_scrollback_budget_timeout_cb,
+                           app);
+}
+
 /* App menu callbacks */
 
 static void
@@ -336,7 +873,7 @@ app_menu_preferences_cb (GSimpleAction *action,
   TerminalApp *app = user_data;
   GtkWindow *window;
 
-  window = gtk_application_get_active_window (GTK_APPLICATION (app));
+  window = terminal_app_get_active_real_window (app);
   if (!TERMINAL_IS_WINDOW (window))
     return;
 
@@ -364,10 +901,13 @@ app_menu_quit_cb (GSimpleAction *action,
                   GVariant      *parameter,
                   gpointer       user_data)
 {
-  GtkApplication *application = user_data;
+  TerminalApp *app = user_data;
   GtkWindow *window;
 
-  window = gtk_application_get_active_window (application);
+  window = terminal_app_get_active_real_window (app);
+  if (window == NULL)
+    return;
+
   if (TERMINAL_IS_WINDOW (window))
     terminal_window_request_close (TERMINAL_WINDOW (window));
   else /* a dialogue */
@@ -395,10 +935,15 @@ terminal_app_startup (GApplication *application)
     { "about",       app_menu_about_cb,         NULL, NULL, NULL },
     { "quit",        app_menu_quit_cb,          NULL, NULL, NULL }
   };
+  gint64 startup_span, span;
+
+  startup_span = _terminal_debug_span_begin ("terminal_app_startup");
 
   g_application_set_resource_base_path (application, TERMINAL_RESOURCES_PATH_PREFIX);
 
+  span = _terminal_debug_span_begin ("GtkApplication startup");
   G_APPLICATION_CLASS (terminal_app_parent_class)->startup (application);
+  _terminal_debug_span_end (span, "GtkApplication startup");
 
   /* Need to set the WM class (bug #685742) */
   gdk_set_program_class("Gnome-terminal");
@@ -407,21 +952,46 @@ terminal_app_startup (GApplication *application)
                                    app_menu_actions, G_N_ELEMENTS (app_menu_actions),
                                    application);
 
-
+  span = _terminal_debug_span_begin ("app_load_css");
   app_load_css (application);
+  _terminal_debug_span_end (span, "app_load_css");
+
+  _terminal_debug_span_end (startup_span, "terminal_app_startup");
 
   _terminal_debug_print (TERMINAL_DEBUG_SERVER, "Startup complete\n");
 }
 
+/* GtkApplicationClass impl */
+
+static void
+terminal_app_window_removed (GtkApplication *application,
+                             GtkWindow      *window)
+{
+  TerminalApp *app = TERMINAL_APP (application);
+
+  GTK_APPLICATION_CLASS (terminal_app_parent_class)->window_removed (application, window);
+
+  g_queue_remove (&app->spare_windows, window);
+  if (!terminal_app_has_real_windows (app))
+    terminal_app_clear_spare_windows (app);
+
+  if (gtk_application_get_windows (application) == NULL &&
+      app->trim_caches_idle_id == 0)
+    app->trim_caches_idle_id = g_idle_add ((GSourceFunc) terminal_app_trim_caches_cb, app);
+}
+
 /* GObjectClass impl */
 
 static void
 terminal_app_init (TerminalApp *app)
 {
   gs_unref_object GSettings *settings;
+  gint64 span;
 
   gtk_window_set_default_icon_name (GNOME_TERMINAL_ICON_NAME);
 
+  span = _terminal_debug_span_begin ("terminal_app_init: settings");
+
   /* Desktop proxy settings */
   app->system_proxy_settings = g_settings_new (SYSTEM_PROXY_SETTINGS_SCHEMA);
 
@@ -431,10 +1001,14 @@ terminal_app_init (TerminalApp *app)
   /* Terminal global settings */
   app->global_settings = g_settings_new (TERMINAL_SETTING_SCHEMA);
 
+  _terminal_debug_span_end (span, "terminal_app_init: settings");
+
 #if GTK_CHECK_VERSION (3, 19, 0)
   {
   GtkSettings *gtk_settings;
 
+  span = _terminal_debug_span_begin ("terminal_app_init: theme variant");
+
   gtk_settings = gtk_settings_get_default ();
   terminal_app_theme_variant_changed_cb (app->global_settings,
                                          TERMINAL_SETTING_THEME_VARIANT_KEY, gtk_settings);
@@ -442,27 +1016,61 @@ terminal_app_init (TerminalApp *app)
                     "changed::" TERMINAL_SETTING_THEME_VARIANT_KEY,
                     G_CALLBACK (terminal_app_theme_variant_changed_cb),
                     gtk_settings);
+
+  _terminal_debug_span_end (span, "terminal_app_init: theme variant");
   }
 #endif /* GTK+ 3.19 */
 
+  terminal_app_update_inactivity_timeout (app);
+  g_signal_connect (app->global_settings,
+                    "changed::" TERMINAL_SETTING_SERVER_KEEP_ALIVE_MAX_KEY,
+                    G_CALLBACK (terminal_app_keep_alive_changed_cb),
+                    app);
+
+  g_queue_init (&app->spare_windows);
+  g_queue_init (&app->pty_pool);
+  g_signal_connect (app->global_settings,
+                    "changed::" TERMINAL_SETTING_PTY_POOL_SIZE_KEY,
+                    G_CALLBACK (terminal_app_pty_pool_size_changed_cb),
+                    app);
+
+  terminal_app_scrollback_budget_changed_cb (app->global_settings,
+                                             TERMINAL_SETTING_SCROLLBACK_BUDGET_KEY, app);
+  g_signal_connect (app->global_settings,
+                    "changed::" TERMINAL_SETTING_SCROLLBACK_BUDGET_KEY,
+                    G_CALLBACK (terminal_app_scrollback_budget_changed_cb),
+                    app);
+
   /* Check if we need to migrate from gconf to dconf */
+  span = _terminal_debug_span_begin ("terminal_app_init: migration check");
   maybe_migrate_settings (app);
+  _terminal_debug_span_end (span, "terminal_app_init: migration check");
 
   /* Get the profiles */
+  span = _terminal_debug_span_begin ("terminal_app_init: terminal_profiles_list_new");
   app->profiles_list = terminal_profiles_list_new ();
+  _terminal_debug_span_end (span, "terminal_app_init: terminal_profiles_list_new");
 
   /* Get the encodings */
+  span = _terminal_debug_span_begin ("terminal_app_init: encodings");
   app->encodings = terminal_encodings_get_builtins ();
+  terminal_encodings_load_validity_cache (app->encodings);
   terminal_app_encoding_list_notify_cb (app->global_settings, "encodings", app);
   g_signal_connect (app->global_settings,
                     "changed::encodings",
                     G_CALLBACK (terminal_app_encoding_list_notify_cb),
                     app);
+  terminal_encodings_validate_async (app->encodings, NULL,
+                                     terminal_app_encodings_validated_cb,
+                                     g_object_ref (app));
+  _terminal_debug_span_end (span, "terminal_app_init: encodings");
 
   app->screen_map = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
+  span = _terminal_debug_span_begin ("terminal_app_init: terminal_accels_init");
   settings = g_settings_get_child (app->global_settings, "keybindings");
   terminal_accels_init (G_APPLICATION (app), settings);
+  _terminal_debug_span_end (span, "terminal_app_init: terminal_accels_init");
 }
 
 static void
@@ -473,6 +1081,24 @@ terminal_app_finalize (GObject *object)
   g_signal_handlers_disconnect_by_func (app->global_settings,
                                         G_CALLBACK (terminal_app_encoding_list_notify_cb),
                                         app);
+  g_signal_handlers_disconnect_by_func (app->global_settings,
+                                        G_CALLBACK (terminal_app_keep_alive_changed_cb),
+                                        app);
+  g_signal_handlers_disconnect_by_func (app->global_settings,
+                                        G_CALLBACK (terminal_app_scrollback_budget_changed_cb),
+                                        app);
+  g_signal_handlers_disconnect_by_func (app->global_settings,
+                                        G_CALLBACK (terminal_app_pty_pool_size_changed_cb),
+                                        app);
+  if (app->scrollback_budget_timeout_id != 0)
+    g_source_remove (app->scrollback_budget_timeout_id);
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  terminal_app_set_memory_monitor_enabled (app, FALSE);
+#endif
+  if (app->trim_caches_idle_id != 0)
+    g_source_remove (app->trim_caches_idle_id);
+  terminal_app_clear_spare_windows (app);
+  terminal_app_clear_pty_pool (app);
   g_hash_table_destroy (app->encodings);
   g_hash_table_destroy (app->screen_map);
 
@@ -485,6 +1111,31 @@ terminal_app_finalize (GObject *object)
   G_OBJECT_CLASS (terminal_app_parent_class)->finalize (object);
 }
 
+#ifdef ENABLE_DEBUG
+
+static gboolean
+terminal_app_handle_dump_trace_cb (TerminalDiagnostics   *diagnostics,
+                                   GDBusMethodInvocation *invocation,
+                                   gpointer               user_data)
+{
+  gs_free char *trace = _terminal_debug_trace_dump ();
+
+  terminal_diagnostics_complete_dump_trace (diagnostics, invocation, trace);
+  return TRUE; /* handled */
+}
+
+static gboolean
+terminal_app_handle_get_memory_report_cb (TerminalDiagnostics   *diagnostics,
+                                          GDBusMethodInvocation *invocation,
+                                          TerminalApp           *app)
+{
+  terminal_diagnostics_complete_get_memory_report (diagnostics, invocation,
+                                                   terminal_app_get_memory_report (app));
+  return TRUE; /* handled */
+}
+
+#endif /* ENABLE_DEBUG */
+
 static gboolean
 terminal_app_dbus_register (GApplication    *application,
                             GDBusConnection *connection,
@@ -494,12 +1145,17 @@ terminal_app_dbus_register (GApplication    *application,
   TerminalApp *app = TERMINAL_APP (application);
   gs_unref_object TerminalObjectSkeleton *object = NULL;
   gs_unref_object TerminalFactory *factory = NULL;
+  gint64 span;
+
+  span = _terminal_debug_span_begin ("D-Bus registration");
 
   if (!G_APPLICATION_CLASS (terminal_app_parent_class)->dbus_register (application,
                                                                        connection,
                                                                        object_path,
-                                                                       error))
+                                                                       error)) {
+    _terminal_debug_span_end (span, "D-Bus registration");
     return FALSE;
+  }
 
 #ifdef ENABLE_SEARCH_PROVIDER
   if (g_settings_get_boolean (app->global_settings, TERMINAL_SETTING_SHELL_INTEGRATION_KEY)) {
@@ -510,8 +1166,10 @@ terminal_app_dbus_register (GApplication    *application,
     if (!terminal_search_provider_dbus_register (search_provider,
                                                  connection,
                                                  TERMINAL_SEARCH_PROVIDER_PATH,
-                                                 error))
+                                                 error)) {
+      _terminal_debug_span_end (span, "D-Bus registration");
       return FALSE;
+    }
 
     gs_transfer_out_value (&app->search_provider, &search_provider);
   }
@@ -521,11 +1179,25 @@ terminal_app_dbus_register (GApplication    *application,
   factory = terminal_factory_impl_new ();
   terminal_object_skeleton_set_factory (object, factory);
 
+#ifdef ENABLE_DEBUG
+  {
+    gs_unref_object TerminalDiagnostics *diagnostics = terminal_diagnostics_skeleton_new ();
+
+    g_signal_connect (diagnostics, "handle-dump-trace",
+                      G_CALLBACK (terminal_app_handle_dump_trace_cb), NULL);
+    g_signal_connect (diagnostics, "handle-get-memory-report",
+                      G_CALLBACK (terminal_app_handle_get_memory_report_cb), app);
+    terminal_object_skeleton_set_diagnostics (object, diagnostics);
+  }
+#endif
+
   app->object_manager = g_dbus_object_manager_server_new (TERMINAL_OBJECT_PATH_PREFIX);
   g_dbus_object_manager_server_export (app->object_manager, G_DBUS_OBJECT_SKELETON (object));
 
   /* And export the object */
   g_dbus_object_manager_server_set_connection (app->object_manager, connection);
+
+  _terminal_debug_span_end (span, "D-Bus registration");
   return TRUE;
 }
 
@@ -560,6 +1232,7 @@ terminal_app_class_init (TerminalAppClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GApplicationClass *g_application_class = G_APPLICATION_CLASS (klass);
+  GtkApplicationClass *gtk_application_class = GTK_APPLICATION_CLASS (klass);
 
   object_class->finalize = terminal_app_finalize;
 
@@ -568,6 +1241,8 @@ terminal_app_class_init (TerminalAppClass *klass)
   g_application_class->dbus_register = terminal_app_dbus_register;
   g_application_class->dbus_unregister = terminal_app_dbus_unregister;
 
+  gtk_application_class->window_removed = terminal_app_window_removed;
+
   signals[ENCODING_LIST_CHANGED] =
     g_signal_new (I_("encoding-list-changed"),
                   G_OBJECT_CLASS_TYPE (object_class),
@@ -605,6 +1280,188 @@ terminal_app_new_window (TerminalApp *app,
   return window;
 }
 
+/**
+ * terminal_app_note_launch:
+ * @app: a #TerminalApp
+ *
+ * Records that a terminal was requested now, and adapts how long
+ * the server stays around after the last window is closed.
+ */
+void
+terminal_app_note_launch (TerminalApp *app)
+{
+  g_return_if_fail (TERMINAL_IS_APP (app));
+
+  app->launch_times[app->n_launches % N_RECENT_LAUNCHES] = g_get_monotonic_time ();
+  app->n_launches++;
+
+  terminal_app_update_inactivity_timeout (app);
+  terminal_app_schedule_refill_pty_pool (app);
+  terminal_app_schedule_refill_spare_windows (app);
+}
+
+/**
+ * terminal_app_defer_until_migrated:
+ * @app: a #TerminalApp
+ * @func: the function to call once the settings are migrated
+ * @user_data: data to pass to @func
+ *
+ * Calls @func once the settings migration started at startup has
+ * finished, or right away if there is none running. Requests that
+ * depend on the profiles must be deferred like this.
+ */
+void
+terminal_app_defer_until_migrated (TerminalApp            *app,
+                                   TerminalAppMigratedFunc func,
+                                   gpointer                user_data)
+{
+  MigrationWaiter *waiter;
+
+  g_return_if_fail (TERMINAL_IS_APP (app));
+  g_return_if_fail (func != NULL);
+
+  if (!app->migrating) {
+    func (app, user_data);
+    return;
+  }
+
+  _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                         "Deferring request until the settings are migrated\n");
+
+  waiter = g_slice_new (MigrationWaiter);
+  waiter->func = func;
+  waiter->user_data = user_data;
+  app->migration_waiters = g_slist_prepend (app->migration_waiters, waiter);
+}
+
+/**
+ * terminal_app_is_migrating_settings:
+ * @app: a #TerminalApp
+ *
+ * Returns: whether the settings migration started at startup is
+ *   still running
+ */
+gboolean
+terminal_app_is_migrating_settings (TerminalApp *app)
+{
+  g_return_val_if_fail (TERMINAL_IS_APP (app), FALSE);
+
+  return app->migrating;
+}
+
+/**
+ * terminal_app_take_pty:
+ * @app: a #TerminalApp
+ *
+ * Takes an unused PTY from the PTY pool.
+ *
+ * Returns: (transfer full): a #VtePty, or %NULL if the pool is off or
+ *   empty
+ */
+VtePty *
+terminal_app_take_pty (TerminalApp *app)
+{
+  VtePty *pty;
+
+  g_return_val_if_fail (TERMINAL_IS_APP (app), NULL);
+
+  /* The pool is off; don't count misses or schedule a refill */
+  if (g_settings_get_uint (app->global_settings, TERMINAL_SETTING_PTY_POOL_SIZE_KEY) == 0)
+    return NULL;
+
+  pty = g_queue_pop_head (&app->pty_pool);
+  if (pty != NULL) {
+    app->pty_pool_hits++;
+    _terminal_debug_counter_add ("PTY pool hits", 1);
+  } else {
+    app->pty_pool_misses++;
+    _terminal_debug_counter_add ("PTY pool misses", 1);
+  }
+
+  _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                         "PTY pool %s, hit rate %u/%u\n",
+                         pty != NULL ? "hit" : "miss",
+                         app->pty_pool_hits,
+                         app->pty_pool_hits + app->pty_pool_misses);
+
+  terminal_app_schedule_refill_pty_pool (app);
+
+  return pty;
+}
+
+/**
+ * terminal_app_take_spare_window:
+ * @app: a #TerminalApp
+ * @screen: the #GdkScreen the window is for
+ * @profile: the profile for the terminal
+ * @zoom: the zoom factor for the terminal
+ * @terminal: (out): return location for the window's terminal
+ *
+ * Takes a prepared window from the spare window pool, if one is available
+ * for @screen, and sets up its terminal for @profile and @zoom.
+ *
+ * Returns: (transfer none): a #TerminalWindow, or %NULL
+ */
+TerminalWindow *
+terminal_app_take_spare_window (TerminalApp     *app,
+                                GdkScreen       *screen,
+                                GSettings       *profile,
+                                double           zoom,
+                                TerminalScreen **terminal)
+{
+  TerminalWindow *window = NULL;
+  TerminalScreen *spare_screen;
+  GList *l;
+
+  g_return_val_if_fail (TERMINAL_IS_APP (app), NULL);
+  g_return_val_if_fail (terminal != NULL, NULL);
+
+  for (l = app->spare_windows.head; l != NULL; l = l->next) {
+    if (gtk_window_get_screen (GTK_WINDOW (l->data)) == screen) {
+      window = l->data;
+      g_queue_delete_link (&app->spare_windows, l);
+      break;
+    }
+  }
+
+  terminal_app_schedule_refill_spare_windows (app);
+
+  if (window == NULL)
+    return NULL;
+
+  spare_screen = terminal_window_get_active (window);
+  terminal_screen_set_profile (spare_screen, profile);
+  vte_terminal_set_size (VTE_TERMINAL (spare_screen),
+                         g_settings_get_int (profile, TERMINAL_PROFILE_DEFAULT_SIZE_COLUMNS_KEY),
+                         g_settings_get_int (profile, TERMINAL_PROFILE_DEFAULT_SIZE_ROWS_KEY));
+  vte_terminal_set_font_scale (VTE_TERMINAL (spare_screen), zoom);
+  terminal_window_update_size (window);
+
+  _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                         "Using spare window %p (%u left)\n",
+                         window, g_queue_get_length (&app->spare_windows));
+
+  *terminal = spare_screen;
+  return window;
+}
+
+/**
+ * terminal_app_is_spare_window:
+ * @app: a #TerminalApp
+ * @window: a #GtkWindow
+ *
+ * Returns: whether @window is a hidden spare window that should not be
+ *   exposed to the user
+ */
+gboolean
+terminal_app_is_spare_window (TerminalApp *app,
+                              GtkWindow   *window)
+{
+  g_return_val_if_fail (TERMINAL_IS_APP (app), FALSE);
+
+  return g_queue_find (&app->spare_windows, window) != NULL;
+}
+
 TerminalScreen *
 terminal_app_new_terminal (TerminalApp     *app,
                            TerminalWindow  *window,
@@ -639,6 +1496,334 @@ terminal_app_get_screen_by_uuid (TerminalApp *app,
   return g_hash_table_lookup (app->screen_map, uuid);
 }
 
+/**
+ * terminal_app_get_memory_report:
+ * @app: a #TerminalApp
+ *
+ * Collects the memory reports of all the screens the user can see, see
+ * terminal_screen_get_memory_report(), as a dictionary with the keys
+ * "screens" (aa{sv}) and "regex-bytes" (t), the memory the compiled
+ * regexes that all screens share use, or 0 if it isn't known.
+ *
+ * Returns: (transfer floating): a #GVariant of type a{sv}
+ */
+GVariant *
+terminal_app_get_memory_report (TerminalApp *app)
+{
+  GVariantBuilder builder, screens;
+  GHashTableIter iter;
+  gpointer value;
+
+  g_return_val_if_fail (TERMINAL_IS_APP (app), NULL);
+
+  g_variant_builder_init (&screens, G_VARIANT_TYPE ("aa{sv}"));
+  g_hash_table_iter_init (&iter, app->screen_map);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    TerminalScreen *screen = value;
+    GtkWidget *toplevel;
+
+    toplevel = gtk_widget_get_toplevel (GTK_WIDGET (screen));
+    if (gtk_widget_is_toplevel (toplevel) &&
+        terminal_app_is_spare_window (app, GTK_WINDOW (toplevel)))
+      continue;
+
+    g_variant_builder_add_value (&screens, terminal_screen_get_memory_report (screen));
+  }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "screens", g_variant_builder_end (&screens));
+  g_variant_builder_add (&builder, "{sv}", "regex-bytes",
+                         g_variant_new_uint64 (terminal_screen_get_regex_memory_size ()));
+
+  return g_variant_builder_end (&builder);
+}
+
+/* Saving the session
+ *
+ * The key file is put together right away, but only written once the
+ * scrollback of every terminal has been written to its side file, which
+ * happens in the background (see terminal_screen_save_contents_async()).
+ * The side files are named after the terminal's group in the key file,
+ * so saving again overwrites them; any left over from an earlier save
+ * with more terminals are removed.
+ */
+
+#define SAVE_CONFIG_SCROLLBACK_SUFFIX ".txt.gz"
+
+typedef struct {
+  GKeyFile *key_file;
+  char *path;
+  char *scrollback_dir;
+  GHashTable *scrollback_files; /* basenames written by this save */
+  guint n_pending;
+  guint n_windows;
+  guint n_tabs;
+  gint64 span;
+} SaveConfigData;
+
+typedef struct {
+  GTask *task;
+  char *group;
+  char *path;
+} SaveConfigScrollbackData;
+
+static void
+save_config_data_free (SaveConfigData *data)
+{
+  g_key_file_free (data->key_file);
+  g_free (data->path);
+  g_free (data->scrollback_dir);
+  g_hash_table_unref (data->scrollback_files);
+  g_slice_free (SaveConfigData, data);
+}
+
+static void
+save_config_prune_scrollback_dir (SaveConfigData *data)
+{
+  GDir *dir;
+  const char *name;
+
+  dir = g_dir_open (data->scrollback_dir, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL) {
+    gs_free char *path = NULL;
+
+    if (!g_str_has_suffix (name, SAVE_CONFIG_SCROLLBACK_SUFFIX) ||
+        g_hash_table_contains (data->scrollback_files, name))
+      continue;
+
+    path = g_build_filename (data->scrollback_dir, name, NULL);
+    if (g_unlink (path) != 0)
+      _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                             "Failed to remove stale scrollback file %s: %s\n",
+                             path, g_strerror (errno));
+  }
+
+  g_dir_close (dir);
+}
+
+static void
+save_config_complete (GTask *task)
+{
+  SaveConfigData *data = g_task_get_task_data (task);
+  GError *error = NULL;
+
+  save_config_prune_scrollback_dir (data);
+
+  if (g_key_file_save_to_file (data->key_file, data->path, &error)) {
+    _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                           "Saved %u windows with %u terminals to %s\n",
+                           data->n_windows, data->n_tabs, data->path);
+    g_task_return_boolean (task, TRUE);
+  } else
+    g_task_return_error (task, error);
+
+  _terminal_debug_span_end (data->span, "terminal_app_save_config");
+}
+
+static void
+save_config_scrollback_done_cb (GObject *source_object,
+                                GAsyncResult *result,
+                                gpointer user_data)
+{
+  SaveConfigScrollbackData *scrollback = user_data;
+  SaveConfigData *data = g_task_get_task_data (scrollback->task);
+  GError *error = NULL;
+
+  if (terminal_screen_save_contents_finish (TERMINAL_SCREEN (source_object), result, &error)) {
+    gs_free char *escaped = g_strescape (scrollback->path, NULL);
+
+    g_key_file_set_string (data->key_file, scrollback->group,
+                           TERMINAL_CONFIG_TERMINAL_PROP_SCROLLBACK, escaped);
+  } else {
+    /* Not fatal; the tab is restored without its scrollback */
+    _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                           "Failed to save the scrollback of %s: %s\n",
+                           scrollback->group, error->message);
+    g_error_free (error);
+  }
+
+  if (--data->n_pending == 0)
+    save_config_complete (scrollback->task);
+
+  g_object_unref (scrollback->task);
+  g_free (scrollback->group);
+  g_free (scrollback->path);
+  g_slice_free (SaveConfigScrollbackData, scrollback);
+}
+
+static void
+save_config_screen (GTask *task,
+                    TerminalScreen *screen,
+                    const char *group)
+{
+  SaveConfigData *data = g_task_get_task_data (task);
+  SaveConfigScrollbackData *scrollback;
+  gs_unref_object GFile *file = NULL;
+  char *basename;
+
+  terminal_screen_save_config (screen, data->key_file, group);
+
+  basename = g_strconcat (group, SAVE_CONFIG_SCROLLBACK_SUFFIX, NULL);
+
+  scrollback = g_slice_new (SaveConfigScrollbackData);
+  scrollback->task = g_object_ref (task);
+  scrollback->group = g_strdup (group);
+  scrollback->path = g_build_filename (data->scrollback_dir, basename, NULL);
+
+  g_hash_table_add (data->scrollback_files, basename);
+
+  data->n_pending++;
+  file = g_file_new_for_path (scrollback->path);
+  terminal_screen_save_contents_async (screen, file, TRUE,
+                                       g_task_get_cancellable (task),
+                                       NULL, NULL,
+                                       save_config_scrollback_done_cb,
+                                       scrollback);
+}
+
+/**
+ * terminal_app_save_config_async:
+ * @app: a #TerminalApp
+ * @path: the absolute path of the file to write
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: called when done
+ * @user_data: data for @callback
+ *
+ * Saves the open windows and their terminals to @path, in the format
+ * that --load-config reads. The scrollback of each terminal goes to a
+ * compressed side file in the directory @path.scrollback.
+ */
+void
+terminal_app_save_config_async (TerminalApp        *app,
+                                const char         *path,
+                                GCancellable       *cancellable,
+                                GAsyncReadyCallback callback,
+                                gpointer            user_data)
+{
+  gs_unref_object GTask *task = NULL;
+  SaveConfigData *data;
+  GPtrArray *window_groups;
+  GList *l;
+
+  g_return_if_fail (TERMINAL_IS_APP (app));
+  g_return_if_fail (g_path_is_absolute (path));
+
+  task = g_task_new (app, cancellable, callback, user_data);
+
+  data = g_slice_new0 (SaveConfigData);
+  data->span = _terminal_debug_span_begin ("terminal_app_save_config");
+  data->path = g_strdup (path);
+  data->scrollback_dir = g_strconcat (path, ".scrollback", NULL);
+  data->scrollback_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  data->key_file = g_key_file_new ();
+  g_task_set_task_data (task, data, (GDestroyNotify) save_config_data_free);
+
+  if (g_mkdir_with_parents (data->scrollback_dir, 0700) != 0) {
+    int errsv = errno;
+
+    g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (errsv),
+                             "Failed to create directory \"%s\": %s",
+                             data->scrollback_dir, g_strerror (errsv));
+    _terminal_debug_span_end (data->span, "terminal_app_save_config");
+    return;
+  }
+
+  g_key_file_set_integer (data->key_file, TERMINAL_CONFIG_GROUP, TERMINAL_CONFIG_PROP_VERSION, TERMINAL_CONFIG_VERSION);
+  g_key_file_set_integer (data->key_file, TERMINAL_CONFIG_GROUP, TERMINAL_CONFIG_PROP_COMPAT_VERSION, TERMINAL_CONFIG_COMPAT_VERSION);
+
+  window_groups = g_ptr_array_new_with_free_func (g_free);
+
+  /* Keeps the task from completing while the tabs are still being added */
+  data->n_pending = 1;
+
+  for (l = gtk_application_get_windows (GTK_APPLICATION (app)); l != NULL; l = l->next) {
+    TerminalWindow *window;
+    TerminalScreen *active_screen;
+    GPtrArray *tab_groups;
+    GList *containers, *lc;
+    GdkWindow *gdk_window;
+    char *window_group;
+    const char *role;
+
+    if (!TERMINAL_IS_WINDOW (l->data) ||
+        g_queue_find (&app->spare_windows, l->data) != NULL)
+      continue;
+
+    window = TERMINAL_WINDOW (l->data);
+    window_group = g_strdup_printf ("Window%u", ++data->n_windows);
+    active_screen = terminal_window_get_active (window);
+    tab_groups = g_ptr_array_new_with_free_func (g_free);
+
+    containers = terminal_window_list_screen_containers (window);
+    for (lc = containers; lc != NULL; lc = lc->next) {
+      TerminalScreen *screen;
+      char *tab_group;
+
+      screen = terminal_screen_container_get_screen (lc->data);
+      tab_group = g_strdup_printf ("Terminal%u", ++data->n_tabs);
+
+      save_config_screen (task, screen, tab_group);
+
+      if (screen == active_screen)
+        g_key_file_set_string (data->key_file, window_group, TERMINAL_CONFIG_WINDOW_PROP_ACTIVE_TAB, tab_group);
+
+      g_ptr_array_add (tab_groups, tab_group);
+    }
+    g_list_free (containers);
+
+    g_key_file_set_string_list (data->key_file, window_group, TERMINAL_CONFIG_WINDOW_PROP_TABS,
+                                (const char * const *) tab_groups->pdata, tab_groups->len);
+    g_ptr_array_free (tab_groups, TRUE);
+
+    role = gtk_window_get_role (GTK_WINDOW (window));
+    if (role != NULL)
+      g_key_file_set_string (data->key_file, window_group, TERMINAL_CONFIG_WINDOW_PROP_ROLE, role);
+
+    gdk_window = gtk_widget_get_window (GTK_WIDGET (window));
+    if (gdk_window != NULL) {
+      GdkWindowState state = gdk_window_get_state (gdk_window);
+
+      if (state & GDK_WINDOW_STATE_MAXIMIZED)
+        g_key_file_set_boolean (data->key_file, window_group, TERMINAL_CONFIG_WINDOW_PROP_MAXIMIZED, TRUE);
+      if (state & GDK_WINDOW_STATE_FULLSCREEN)
+        g_key_file_set_boolean (data->key_file, window_group, TERMINAL_CONFIG_WINDOW_PROP_FULLSCREEN, TRUE);
+    }
+
+    g_key_file_set_boolean (data->key_file, window_group, TERMINAL_CONFIG_WINDOW_PROP_MENUBAR_VISIBLE,
+                            terminal_window_get_menubar_visible (window));
+
+    g_ptr_array_add (window_groups, window_group);
+  }
+
+  g_key_file_set_string_list (data->key_file, TERMINAL_CONFIG_GROUP, TERMINAL_CONFIG_PROP_WINDOWS,
+                              (const char * const *) window_groups->pdata, window_groups->len);
+  g_ptr_array_free (window_groups, TRUE);
+
+  if (--data->n_pending == 0)
+    save_config_complete (task);
+}
+
+/**
+ * terminal_app_save_config_finish:
+ * @app: a #TerminalApp
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError to fill in
+ *
+ * Returns: %TRUE on success, or %FALSE with @error filled in
+ */
+gboolean
+terminal_app_save_config_finish (TerminalApp  *app,
+                                 GAsyncResult *result,
+                                 GError      **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, app), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 void
 terminal_app_register_screen (TerminalApp *app,
                               TerminalScreen *screen)
@@ -71,6 +71,28 @@ void terminal_app_remove_profile (TerminalApp *app,
 TerminalWindow * terminal_app_new_window   (TerminalApp *app,
                                             GdkScreen *screen);
 
+void terminal_app_note_launch (TerminalApp *app);
+
+TerminalWindow *terminal_app_take_spare_window (TerminalApp     *app,
+                                                GdkScreen       *screen,
+                                                GSettings       *profile,
+                                                double           zoom,
+                                                TerminalScreen **terminal);
+
+gboolean terminal_app_is_spare_window (TerminalApp *app,
+                                       GtkWindow   *window);
+
+VtePty *terminal_app_take_pty (TerminalApp *app);
+
+typedef void (* TerminalAppMigratedFunc) (TerminalApp *app,
+                                          gpointer     user_data);
+
+void terminal_app_defer_until_migrated (TerminalApp            *app,
+                                        TerminalAppMigratedFunc func,
+                                        gpointer                user_data);
+
+gboolean terminal_app_is_migrating_settings (TerminalApp *app);
+
 TerminalScreen *terminal_app_new_terminal (TerminalApp     *app,
                                            TerminalWindow  *window,
                                            GSettings       *profile,
@@ -79,6 +101,18 @@ TerminalScreen *terminal_app_new_terminal (TerminalApp     *app,
                                            char           **child_env,
                                            double           zoom);
 
+GVariant *terminal_app_get_memory_report (TerminalApp *app);
+
+void terminal_app_save_config_async (TerminalApp        *app,
+                                     const char         *path,
+                                     GCancellable       *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer            user_data);
+
+gboolean terminal_app_save_config_finish (TerminalApp  *app,
+                                          GAsyncResult *result,
+                                          GError      **error);
+
 TerminalScreen *terminal_app_get_screen_by_uuid (TerminalApp *app,
                                                  const char  *uuid);
 
@@ -0,0 +1,1419 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* gnome-terminal-bench: runs a private gnome-terminal-server on a private
+ * session bus and a virtual display, drives it through the Factory and
+ * Receiver D-Bus interfaces, and prints latency percentiles.
+ *
+ * With --output, it instead measures how fast the terminals process
+ * output: it streams generated corpora (plain ASCII, SGR colours, wide CJK
+ * and long wrapped lines) through the PTYs of 1, 10 and 100 busy tabs, and
+ * reports the throughput, and the frame intervals that the server reports
+ * when built with --enable-debug.
+ *
+ * With --layout, it instead measures restoring a layout of 20 windows with
+ * 10 tabs each, once tab by tab through CreateInstance and Exec, as the
+ * client used to, and once with a single RestoreLayout call.
+ *
+ * With --spare-windows N, it instead measures the time from CreateInstance
+ * to the first output in the new window, with the server started once
+ * without spare windows and once with N. The server reports these times
+ * when built with --enable-debug.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "terminal-client-utils.h"
+#include "terminal-defines.h"
+#include "terminal-gdbus-generated.h"
+#include "terminal-libgsystem.h"
+
+#define BENCH_APP_ID            "org.gnome.Terminal.Bench"
+#define STARTUP_TIMEOUT         (10 * G_USEC_PER_SEC)
+#define EVENT_TIMEOUT           (5 * G_USEC_PER_SEC)
+#define N_SPAWN_ROUNDS          (5)
+
+static char *server_path = NULL;
+static char *backend = NULL;
+static int broadway_display = 5;
+static int iterations = 50;
+static int spawn_batch = 20;
+static gboolean output_mode = FALSE;
+static int output_size = 1024;
+static int max_tabs = 100;
+static gboolean layout_mode = FALSE;
+static int layout_windows = 20;
+static int layout_tabs = 10;
+static int spare_windows = 0;
+
+static const GOptionEntry options[] = {
+  { "server", 0, 0, G_OPTION_ARG_FILENAME, &server_path,
+    "The gnome-terminal-server to benchmark", "PATH" },
+  { "backend", 0, 0, G_OPTION_ARG_STRING, &backend,
+    "The virtual display to use: \"xvfb\" (default) or \"broadway\"", "BACKEND" },
+  { "broadway-display", 0, 0, G_OPTION_ARG_INT, &broadway_display,
+    "The display number for broadwayd", "NUMBER" },
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+    "Number of samples for each latency measurement", "N" },
+  { "spawn-batch", 0, 0, G_OPTION_ARG_INT, &spawn_batch,
+    "Number of terminals to spawn at once for the throughput measurement", "N" },
+  { "output", 0, 0, G_OPTION_ARG_NONE, &output_mode,
+    "Measure output throughput instead of latencies", NULL },
+  { "output-size", 0, 0, G_OPTION_ARG_INT, &output_size,
+    "Amount of output per tab, in KiB", "KIB" },
+  { "max-tabs", 0, 0, G_OPTION_ARG_INT, &max_tabs,
+    "Largest number of busy tabs to measure output with", "N" },
+  { "layout", 0, 0, G_OPTION_ARG_NONE, &layout_mode,
+    "Measure restoring a layout instead of latencies", NULL },
+  { "layout-windows", 0, 0, G_OPTION_ARG_INT, &layout_windows,
+    "Number of windows in the layout", "N" },
+  { "layout-tabs", 0, 0, G_OPTION_ARG_INT, &layout_tabs,
+    "Number of tabs in each window of the layout", "N" },
+  { "spare-windows", 0, 0, G_OPTION_ARG_INT, &spare_windows,
+    "Measure new windows without and with N spare windows instead of latencies", "N" },
+  { NULL }
+};
+
+typedef struct {
+  GTestDBus *bus;
+  GSubprocess *display_process;
+  GSubprocess *server_process;
+  char *display_name;
+
+  GDBusConnection *connection;
+  TerminalFactory *factory;
+  guint child_exited_id;
+  guint interfaces_removed_id;
+
+  /* object path → monotonic time of the event */
+  GHashTable *exited_times;
+  GHashTable *removed_times;
+
+  /* Output and spare windows modes only */
+  GDataInputStream *server_stderr;
+  GCancellable *cancellable;
+
+  /* Output mode only */
+  GArray *frame_intervals; /* ms */
+  char *corpus_dir;
+
+  /* Spare windows mode only */
+  GArray *first_output; /* ms */
+  guint n_spare_windows_prepared;
+  char *config_dir;
+} Bench;
+
+/* Statistics */
+
+static int
+compare_doubles (gconstpointer a,
+                 gconstpointer b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/* Nearest-rank percentile of the sorted @samples */
+static double
+percentile (GArray *samples,
+            guint   p)
+{
+  guint rank;
+
+  rank = (p * samples->len + 99) / 100;
+  rank = CLAMP (rank, 1, samples->len);
+
+  return g_array_index (samples, double, rank - 1);
+}
+
+static void
+print_stats (const char *name,
+             const char *unit,
+             GArray     *samples)
+{
+  if (samples->len == 0) {
+    g_print ("%-22s no samples\n", name);
+    return;
+  }
+
+  g_array_sort (samples, compare_doubles);
+
+  g_print ("%-22s n=%-4u min %8.2f  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f %s\n",
+           name, samples->len,
+           g_array_index (samples, double, 0),
+           percentile (samples, 50),
+           percentile (samples, 90),
+           percentile (samples, 99),
+           g_array_index (samples, double, samples->len - 1),
+           unit);
+}
+
+static void
+add_sample_ms (GArray *samples,
+               gint64  start_time,
+               gint64  end_time)
+{
+  double value = (end_time - start_time) / 1000.;
+
+  g_array_append_val (samples, value);
+}
+
+/* Events */
+
+static void
+child_exited_cb (GDBusConnection *connection,
+                 const char      *sender_name,
+                 const char      *object_path,
+                 const char      *interface_name,
+                 const char      *signal_name,
+                 GVariant        *parameters,
+                 gpointer         user_data)
+{
+  Bench *bench = user_data;
+  gint64 *now;
+
+  now = g_new (gint64, 1);
+  *now = g_get_monotonic_time ();
+  g_hash_table_replace (bench->exited_times, g_strdup (object_path), now);
+}
+
+static void
+interfaces_removed_cb (GDBusConnection *connection,
+                       const char      *sender_name,
+                       const char      *object_path,
+                       const char      *interface_name,
+                       const char      *signal_name,
+                       GVariant        *parameters,
+                       gpointer         user_data)
+{
+  Bench *bench = user_data;
+  const char *removed_path;
+  gint64 *now;
+
+  if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(oas)")))
+    return;
+
+  g_variant_get (parameters, "(&o@as)", &removed_path, NULL);
+
+  now = g_new (gint64, 1);
+  *now = g_get_monotonic_time ();
+  g_hash_table_replace (bench->removed_times, g_strdup (removed_path), now);
+}
+
+static gboolean
+event_timeout_cb (gboolean *timed_out)
+{
+  *timed_out = TRUE;
+  return FALSE; /* remove */
+}
+
+/* Iterates the main context until @object_path shows up in @table.
+ * Blocks in between, so as not to compete with the server for the CPU.
+ */
+static gint64
+wait_for_event (GHashTable *table,
+                const char *object_path)
+{
+  gint64 *event_time;
+  gboolean timed_out = FALSE;
+  guint timeout_id;
+
+  timeout_id = g_timeout_add (EVENT_TIMEOUT / 1000,
+                              (GSourceFunc) event_timeout_cb, &timed_out);
+
+  while ((event_time = g_hash_table_lookup (table, object_path)) == NULL &&
+         !timed_out)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (!timed_out)
+    g_source_remove (timeout_id);
+
+  return event_time ? *event_time : 0;
+}
+
+/* The server's frames and perf debug output */
+
+static void read_server_stderr (Bench *bench);
+
+/* The rest of the server's perf output, which would drown the results */
+static const char * const perf_prefixes[] = {
+  "[perf] ", "[screen ", "PTY ", "Settings migration "
+};
+
+static gboolean
+is_perf_output (const char *line)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (perf_prefixes); i++)
+    if (g_str_has_prefix (line, perf_prefixes[i]))
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+server_stderr_line_cb (GObject      *source,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  Bench *bench = user_data;
+  gs_free char *line = NULL;
+  double interval, latency;
+
+  line = g_data_input_stream_read_line_finish_utf8 (G_DATA_INPUT_STREAM (source),
+                                                    result, NULL, NULL);
+  if (line == NULL)
+    return; /* EOF, error or cancelled */
+
+  if (sscanf (line, "[frames] frame interval %lf ms", &interval) == 1)
+    g_array_append_val (bench->frame_intervals, interval);
+  else if (sscanf (line, "[screen %*s first output %lf ms", &latency) == 1)
+    g_array_append_val (bench->first_output, latency);
+  else if (g_str_has_prefix (line, "Prepared spare window "))
+    bench->n_spare_windows_prepared++;
+  else if (!is_perf_output (line))
+    g_printerr ("%s\n", line);
+
+  read_server_stderr (bench);
+}
+
+static void
+read_server_stderr (Bench *bench)
+{
+  g_data_input_stream_read_line_async (bench->server_stderr,
+                                       G_PRIORITY_DEFAULT,
+                                       bench->cancellable,
+                                       server_stderr_line_cb,
+                                       bench);
+}
+
+/* Setup */
+
+static gboolean
+start_display (Bench   *bench,
+               GError **error)
+{
+  gs_unref_object GSubprocessLauncher *launcher = NULL;
+
+  launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDOUT_SILENCE |
+                                        G_SUBPROCESS_FLAGS_STDERR_SILENCE);
+
+  if (g_strcmp0 (backend, "broadway") == 0) {
+    gs_free char *display = NULL;
+
+    display = g_strdup_printf (":%d", broadway_display);
+    bench->display_process = g_subprocess_launcher_spawn (launcher, error,
+                                                          "broadwayd", display, NULL);
+    if (bench->display_process == NULL)
+      return FALSE;
+
+    g_setenv ("GDK_BACKEND", "broadway", TRUE);
+    g_setenv ("BROADWAY_DISPLAY", display, TRUE);
+    g_unsetenv ("DISPLAY");
+    g_unsetenv ("WAYLAND_DISPLAY");
+
+    /* This is what gdk_display_get_name() returns on broadway */
+    bench->display_name = g_strdup ("Broadway");
+
+    /* broadwayd has no readiness notification; give it a moment */
+    g_usleep (G_USEC_PER_SEC / 2);
+  } else if (backend == NULL || g_strcmp0 (backend, "xvfb") == 0) {
+    int fds[2];
+    char buf[32];
+    gsize len = 0;
+
+    if (!g_unix_open_pipe (fds, FD_CLOEXEC, error))
+      return FALSE;
+
+    /* Xvfb writes the display number to fd 3 once it's ready */
+    g_subprocess_launcher_take_fd (launcher, fds[1], 3);
+    bench->display_process = g_subprocess_launcher_spawn (launcher, error,
+                                                          "Xvfb",
+                                                          "-displayfd", "3",
+                                                          "-screen", "0", "1280x1024x24",
+                                                          "-nolisten", "tcp",
+                                                          NULL);
+    /* Drop our copy of the write end so we see EOF if Xvfb fails */
+    g_clear_object (&launcher);
+    if (bench->display_process == NULL) {
+      close (fds[0]);
+      return FALSE;
+    }
+
+    while (len < sizeof (buf) - 1) {
+      ssize_t r;
+
+      r = read (fds[0], buf + len, sizeof (buf) - 1 - len);
+      if (r < 0 && errno == EINTR)
+        continue;
+      if (r <= 0)
+        break;
+
+      len += r;
+      if (memchr (buf, '\n', len) != NULL)
+        break;
+    }
+    close (fds[0]);
+
+    buf[len] = '\0';
+    g_strchomp (buf);
+    if (buf[0] == '\0') {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                           "Xvfb did not report a display number");
+      return FALSE;
+    }
+
+    bench->display_name = g_strdup_printf (":%s", buf);
+    g_setenv ("DISPLAY", bench->display_name, TRUE);
+    g_setenv ("GDK_BACKEND", "x11", TRUE);
+    g_unsetenv ("WAYLAND_DISPLAY");
+  } else {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                 "Unknown backend \"%s\"", backend);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+start_server (Bench   *bench,
+              GError **error)
+{
+  gs_unref_object GSubprocessLauncher *launcher = NULL;
+  gint64 start_time, deadline;
+
+  /* Private session bus; this sets DBUS_SESSION_BUS_ADDRESS for us */
+  bench->bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bench->bus);
+
+  bench->connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, error);
+  if (bench->connection == NULL)
+    return FALSE;
+
+  if (output_mode || spare_windows > 0) {
+    /* Collect the frame intervals or first output times from the
+     * server's debug output
+     */
+    launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDERR_PIPE);
+    g_subprocess_launcher_setenv (launcher, "GNOME_TERMINAL_DEBUG",
+                                  output_mode ? "frames" : "perf", TRUE);
+    g_subprocess_launcher_setenv (launcher, "LC_NUMERIC", "C", TRUE);
+  } else
+    launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
+
+  /* Start from the default settings, or those from write_settings(), and
+   * leave the user's alone
+   */
+  if (bench->config_dir != NULL) {
+    g_subprocess_launcher_setenv (launcher, "GSETTINGS_BACKEND", "keyfile", TRUE);
+    g_subprocess_launcher_setenv (launcher, "XDG_CONFIG_HOME", bench->config_dir, TRUE);
+  } else
+    g_subprocess_launcher_setenv (launcher, "GSETTINGS_BACKEND", "memory", TRUE);
+  g_subprocess_launcher_setenv (launcher, "NO_AT_BRIDGE", "1", TRUE);
+
+  start_time = g_get_monotonic_time ();
+
+  bench->server_process = g_subprocess_launcher_spawn (launcher, error,
+                                                       server_path ? server_path
+                                                                   : TERM_LIBEXECDIR "/gnome-terminal-server",
+                                                       "--app-id", BENCH_APP_ID,
+                                                       NULL);
+  if (bench->server_process == NULL)
+    return FALSE;
+
+  if (output_mode || spare_windows > 0) {
+    bench->cancellable = g_cancellable_new ();
+    bench->server_stderr = g_data_input_stream_new (g_subprocess_get_stderr_pipe (bench->server_process));
+    read_server_stderr (bench);
+  }
+
+  /* Wait for the server to own its name */
+  deadline = start_time + STARTUP_TIMEOUT;
+  for (;;) {
+    gs_unref_variant GVariant *reply = NULL;
+    gboolean has_owner = FALSE;
+
+    reply = g_dbus_connection_call_sync (bench->connection,
+                                         "org.freedesktop.DBus",
+                                         "/org/freedesktop/DBus",
+                                         "org.freedesktop.DBus",
+                                         "NameHasOwner",
+                                         g_variant_new ("(s)", BENCH_APP_ID),
+                                         G_VARIANT_TYPE ("(b)"),
+                                         G_DBUS_CALL_FLAGS_NONE,
+                                         -1, NULL, error);
+    if (reply == NULL)
+      return FALSE;
+
+    g_variant_get (reply, "(b)", &has_owner);
+    if (has_owner)
+      break;
+
+    if (g_get_monotonic_time () > deadline) {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                           "Timed out waiting for the server to start");
+      return FALSE;
+    }
+
+    g_usleep (10000);
+  }
+
+  g_print ("%-22s %.2f ms\n", "server startup",
+           (g_get_monotonic_time () - start_time) / 1000.);
+
+  bench->factory = terminal_factory_proxy_new_sync (bench->connection,
+                                                    G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                                    G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                                    BENCH_APP_ID,
+                                                    TERMINAL_FACTORY_OBJECT_PATH,
+                                                    NULL, error);
+  if (bench->factory == NULL)
+    return FALSE;
+
+  bench->child_exited_id =
+    g_dbus_connection_signal_subscribe (bench->connection,
+                                        BENCH_APP_ID,
+                                        TEMRINAL_RECEIVER_INTERFACE_NAME,
+                                        "ChildExited",
+                                        NULL, NULL,
+                                        G_DBUS_SIGNAL_FLAGS_NONE,
+                                        child_exited_cb, bench, NULL);
+  bench->interfaces_removed_id =
+    g_dbus_connection_signal_subscribe (bench->connection,
+                                        BENCH_APP_ID,
+                                        "org.freedesktop.DBus.ObjectManager",
+                                        "InterfacesRemoved",
+                                        TERMINAL_OBJECT_PATH_PREFIX,
+                                        NULL,
+                                        G_DBUS_SIGNAL_FLAGS_NONE,
+                                        interfaces_removed_cb, bench, NULL);
+
+  return TRUE;
+}
+
+/* Stops the server and its bus; the display stays up */
+static void
+stop_server (Bench *bench)
+{
+  if (bench->connection != NULL) {
+    if (bench->child_exited_id != 0)
+      g_dbus_connection_signal_unsubscribe (bench->connection, bench->child_exited_id);
+    if (bench->interfaces_removed_id != 0)
+      g_dbus_connection_signal_unsubscribe (bench->connection, bench->interfaces_removed_id);
+  }
+  bench->child_exited_id = bench->interfaces_removed_id = 0;
+
+  g_clear_object (&bench->factory);
+
+  if (bench->cancellable != NULL)
+    g_cancellable_cancel (bench->cancellable);
+  g_clear_object (&bench->server_stderr);
+  g_clear_object (&bench->cancellable);
+
+  if (bench->server_process != NULL) {
+    g_subprocess_send_signal (bench->server_process, SIGTERM);
+    g_subprocess_wait (bench->server_process, NULL, NULL);
+    g_clear_object (&bench->server_process);
+  }
+
+  g_clear_object (&bench->connection);
+
+  if (bench->bus != NULL) {
+    g_test_dbus_down (bench->bus);
+    g_clear_object (&bench->bus);
+  }
+
+  /* The next server reuses the object paths */
+  g_hash_table_remove_all (bench->exited_times);
+  g_hash_table_remove_all (bench->removed_times);
+  bench->n_spare_windows_prepared = 0;
+}
+
+/* Removes @path and everything below it */
+static void
+remove_tree (const char *path)
+{
+  GDir *dir;
+  const char *name;
+
+  dir = g_dir_open (path, 0, NULL);
+  while (dir != NULL && (name = g_dir_read_name (dir)) != NULL) {
+    gs_free char *child = g_build_filename (path, name, NULL);
+
+    if (g_file_test (child, G_FILE_TEST_IS_DIR) &&
+        !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+      remove_tree (child);
+    else
+      g_unlink (child);
+  }
+  if (dir != NULL)
+    g_dir_close (dir);
+  g_rmdir (path);
+}
+
+static void
+bench_shutdown (Bench *bench)
+{
+  stop_server (bench);
+
+  if (bench->display_process != NULL) {
+    g_subprocess_force_exit (bench->display_process);
+    g_subprocess_wait (bench->display_process, NULL, NULL);
+    g_clear_object (&bench->display_process);
+  }
+
+  if (bench->corpus_dir != NULL) {
+    remove_tree (bench->corpus_dir);
+    g_free (bench->corpus_dir);
+  }
+  if (bench->config_dir != NULL) {
+    remove_tree (bench->config_dir);
+    g_free (bench->config_dir);
+  }
+
+  g_free (bench->display_name);
+  g_array_unref (bench->frame_intervals);
+  g_array_unref (bench->first_output);
+  g_hash_table_destroy (bench->exited_times);
+  g_hash_table_destroy (bench->removed_times);
+}
+
+/* Driving the server */
+
+static guint
+window_id_from_object_path (const char *object_path)
+{
+  const char *p;
+  char *end = NULL;
+  guint64 value;
+
+  p = strstr (object_path, "/window/");
+  if (p == NULL)
+    return 0;
+
+  p += strlen ("/window/");
+  errno = 0;
+  value = g_ascii_strtoull (p, &end, 10);
+  if (errno != 0 || end == p || *end != '/')
+    return 0;
+
+  return (guint) value;
+}
+
+/* Opens a terminal in a new window, or in window @window_id if non-zero,
+ * and runs @argv in it. Returns the terminal's object path.
+ */
+static char *
+open_terminal (Bench              *bench,
+               guint               window_id,
+               const char * const *argv,
+               GError            **error)
+{
+  GVariantBuilder builder;
+  char *object_path = NULL;
+  gs_unref_object TerminalReceiver *receiver = NULL;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  terminal_client_append_create_instance_options (&builder,
+                                                  bench->display_name,
+                                                  NULL /* startup id */,
+                                                  NULL /* geometry */,
+                                                  NULL /* role */,
+                                                  NULL /* default profile */,
+                                                  NULL /* title */,
+                                                  TRUE /* active */,
+                                                  FALSE /* maximise */,
+                                                  FALSE /* fullscreen */);
+  if (window_id != 0)
+    g_variant_builder_add (&builder, "{sv}",
+                           "window-id", g_variant_new_uint32 (window_id));
+
+  if (!terminal_factory_call_create_instance_sync (bench->factory,
+                                                   g_variant_builder_end (&builder),
+                                                   &object_path,
+                                                   NULL, error))
+    return NULL;
+
+  receiver = terminal_receiver_proxy_new_sync (bench->connection,
+                                               G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                               G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                               BENCH_APP_ID,
+                                               object_path,
+                                               NULL, error);
+  if (receiver == NULL)
+    goto fail;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  terminal_client_append_exec_options (&builder, g_get_home_dir (),
+                                       NULL, 0, FALSE);
+
+  if (!terminal_receiver_call_exec_sync (receiver,
+                                         g_variant_builder_end (&builder),
+                                         g_variant_new_bytestring_array (argv, -1),
+                                         NULL /* infdlist */, NULL /* outfdlist */,
+                                         NULL, error))
+    goto fail;
+
+  return object_path;
+
+ fail:
+  g_free (object_path);
+  return NULL;
+}
+
+/* Records the time from the child exiting to the terminal going away */
+static gboolean
+wait_for_close (Bench      *bench,
+                const char *object_path,
+                GArray     *close_samples,
+                GError    **error)
+{
+  gint64 exited, removed;
+
+  exited = wait_for_event (bench->exited_times, object_path);
+  removed = wait_for_event (bench->removed_times, object_path);
+  if (exited == 0 || removed == 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                 "Timed out waiting for %s to close", object_path);
+    return FALSE;
+  }
+
+  add_sample_ms (close_samples, exited, removed);
+  return TRUE;
+}
+
+static const char * const true_argv[] = { "true", NULL };
+static const char * const cat_argv[] = { "cat", NULL };
+
+static gboolean
+measure_window_open (Bench   *bench,
+                     GArray  *open_samples,
+                     GArray  *close_samples,
+                     GError **error)
+{
+  int i;
+
+  for (i = 0; i < iterations; i++) {
+    gs_free char *object_path = NULL;
+    gint64 start_time;
+
+    start_time = g_get_monotonic_time ();
+    object_path = open_terminal (bench, 0, true_argv, error);
+    if (object_path == NULL)
+      return FALSE;
+    add_sample_ms (open_samples, start_time, g_get_monotonic_time ());
+
+    /* The window closes with its only tab once "true" exits */
+    if (!wait_for_close (bench, object_path, close_samples, error))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+measure_tab_open (Bench   *bench,
+                  guint    window_id,
+                  GArray  *open_samples,
+                  GArray  *close_samples,
+                  GError **error)
+{
+  int i;
+
+  for (i = 0; i < iterations; i++) {
+    gs_free char *object_path = NULL;
+    gint64 start_time;
+
+    start_time = g_get_monotonic_time ();
+    object_path = open_terminal (bench, window_id, true_argv, error);
+    if (object_path == NULL)
+      return FALSE;
+    add_sample_ms (open_samples, start_time, g_get_monotonic_time ());
+
+    if (!wait_for_close (bench, object_path, close_samples, error))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+measure_spawn_throughput (Bench   *bench,
+                          guint    window_id,
+                          GArray  *samples,
+                          GError **error)
+{
+  int round, i;
+
+  for (round = 0; round < N_SPAWN_ROUNDS; round++) {
+    gs_unref_ptrarray GPtrArray *paths = NULL;
+    gint64 start_time, end_time = 0;
+    double rate;
+
+    paths = g_ptr_array_new_with_free_func (g_free);
+
+    start_time = g_get_monotonic_time ();
+    for (i = 0; i < spawn_batch; i++) {
+      char *object_path;
+
+      object_path = open_terminal (bench, window_id, true_argv, error);
+      if (object_path == NULL)
+        return FALSE;
+      g_ptr_array_add (paths, object_path);
+    }
+
+    for (i = 0; i < (int) paths->len; i++) {
+      gint64 exited;
+
+      exited = wait_for_event (bench->exited_times, paths->pdata[i]);
+      if (exited == 0) {
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                             "Timed out waiting for children to exit");
+        return FALSE;
+      }
+      end_time = MAX (end_time, exited);
+    }
+
+    rate = spawn_batch / ((end_time - start_time) / (double) G_USEC_PER_SEC);
+    g_array_append_val (samples, rate);
+
+    /* Let the tabs close before the next round */
+    for (i = 0; i < (int) paths->len; i++)
+      wait_for_event (bench->removed_times, paths->pdata[i]);
+  }
+
+  return TRUE;
+}
+
+/* Output throughput */
+
+typedef enum {
+  CORPUS_ASCII,
+  CORPUS_SGR,
+  CORPUS_CJK,
+  CORPUS_WRAPPED,
+  N_CORPORA
+} Corpus;
+
+static const char * const corpus_names[N_CORPORA] = {
+  "ascii", "sgr", "cjk", "wrapped"
+};
+
+static void
+append_corpus_chunk (GString *str,
+                     Corpus   corpus,
+                     guint    n)
+{
+  guint i;
+
+  switch (corpus) {
+  case CORPUS_ASCII:
+    /* A line of build log */
+    g_string_append_printf (str, "[%6u] CC       src/terminal-%u.o -O2 -Wall -fstack-protector-strong\r\n", n, n % 97);
+    break;
+  case CORPUS_SGR:
+    /* Coloured words, as from ls --color or a compiler */
+    for (i = 0; i < 8; i++)
+      g_string_append_printf (str, "\033[1;38;5;%um\033[48;5;%umword%u\033[0m ",
+                              (n + i) % 256, (n * 7 + i) % 256, i);
+    g_string_append (str, "\r\n");
+    break;
+  case CORPUS_CJK:
+    /* 38 double-width characters fill most of an 80 column line */
+    for (i = 0; i < 38; i++)
+      g_string_append_unichar (str, 0x4e00 + (n * 38 + i) % 0x5000);
+    g_string_append (str, "\r\n");
+    break;
+  case CORPUS_WRAPPED:
+    /* One 2000 column line that wraps many times */
+    for (i = 0; i < 2000; i++)
+      g_string_append_c (str, 'a' + (n + i) % 26);
+    g_string_append (str, "\r\n");
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+}
+
+static char *
+write_corpus (Bench   *bench,
+              Corpus   corpus,
+              gsize    size,
+              GError **error)
+{
+  GString *str;
+  char *path;
+  guint n = 0;
+
+  str = g_string_sized_new (size + 4096);
+  while (str->len < size)
+    append_corpus_chunk (str, corpus, n++);
+
+  path = g_build_filename (bench->corpus_dir, corpus_names[corpus], NULL);
+  if (!g_file_set_contents (path, str->str, str->len, error)) {
+    g_free (path);
+    path = NULL;
+  }
+
+  g_string_free (str, TRUE);
+  return path;
+}
+
+/* Runs "cat @corpus_path" in @n_tabs new tabs of window @window_id, and
+ * records the throughput from opening the first tab until all are done.
+ */
+static gboolean
+measure_output (Bench      *bench,
+                guint       window_id,
+                const char *corpus_path,
+                int         n_tabs,
+                GArray     *samples,
+                GError    **error)
+{
+  const char * const argv[] = { "cat", corpus_path, NULL };
+  gs_unref_ptrarray GPtrArray *paths = NULL;
+  gint64 start_time, end_time = 0;
+  GStatBuf buf;
+  double rate;
+  int i;
+
+  if (g_stat (corpus_path, &buf) != 0) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                 "Failed to stat %s: %s", corpus_path, g_strerror (errno));
+    return FALSE;
+  }
+
+  paths = g_ptr_array_new_with_free_func (g_free);
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_tabs; i++) {
+    char *object_path;
+
+    object_path = open_terminal (bench, window_id, argv, error);
+    if (object_path == NULL)
+      return FALSE;
+    g_ptr_array_add (paths, object_path);
+  }
+
+  /* "cat" exits once the terminal has read nearly all of its output */
+  for (i = 0; i < (int) paths->len; i++) {
+    gint64 exited;
+
+    exited = wait_for_event (bench->exited_times, paths->pdata[i]);
+    if (exited == 0) {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                           "Timed out waiting for output to finish");
+      return FALSE;
+    }
+    end_time = MAX (end_time, exited);
+  }
+
+  rate = (double) buf.st_size * n_tabs / (1024. * 1024.) /
+         ((end_time - start_time) / (double) G_USEC_PER_SEC);
+  g_array_append_val (samples, rate);
+
+  /* Let the tabs close before the next run */
+  for (i = 0; i < (int) paths->len; i++)
+    wait_for_event (bench->removed_times, paths->pdata[i]);
+
+  return TRUE;
+}
+
+static gboolean
+run_output_benchmark (Bench   *bench,
+                      GError **error)
+{
+  static const int tab_counts[] = { 1, 10, 100 };
+  gs_free char *anchor_path = NULL;
+  guint window_id;
+  Corpus corpus;
+  guint i;
+
+  bench->corpus_dir = g_dir_make_tmp ("gnome-terminal-bench-XXXXXX", error);
+  if (bench->corpus_dir == NULL)
+    return FALSE;
+
+  /* A window that stays open to add the busy tabs to */
+  anchor_path = open_terminal (bench, 0, cat_argv, error);
+  if (anchor_path == NULL)
+    return FALSE;
+  window_id = window_id_from_object_path (anchor_path);
+
+  for (corpus = 0; corpus < N_CORPORA; corpus++) {
+    gs_free char *corpus_path = NULL;
+
+    corpus_path = write_corpus (bench, corpus, (gsize) output_size * 1024, error);
+    if (corpus_path == NULL)
+      return FALSE;
+
+    for (i = 0; i < G_N_ELEMENTS (tab_counts) && tab_counts[i] <= max_tabs; i++) {
+      gs_unref_array GArray *samples = NULL;
+      gs_free char *name = NULL;
+      int run;
+
+      samples = g_array_new (FALSE, FALSE, sizeof (double));
+      g_array_set_size (bench->frame_intervals, 0);
+
+      /* Each tab processes output_size KiB per run */
+      for (run = 0; run < N_SPAWN_ROUNDS; run++) {
+        if (!measure_output (bench, window_id, corpus_path, tab_counts[i], samples, error))
+          return FALSE;
+      }
+
+      /* Pick up the last frame intervals */
+      while (g_main_context_iteration (NULL, FALSE))
+        ;
+
+      name = g_strdup_printf ("%s x%d", corpus_names[corpus], tab_counts[i]);
+      print_stats (name, "MiB/s", samples);
+
+      g_free (name);
+      name = g_strdup_printf ("%s x%d frames", corpus_names[corpus], tab_counts[i]);
+      print_stats (name, "ms", bench->frame_intervals);
+    }
+  }
+
+  return TRUE;
+}
+
+/* Layout restore */
+
+/* Every child sleeps this long, so that the windows stay open while the
+ * layout is being built; it's subtracted from the measurements.
+ */
+#define LAYOUT_SLEEP_MS (1000)
+
+static const char * const sleep_argv[] = { "sleep", "1", NULL };
+
+/* Records the time until the last of the children at @paths was launched */
+static gboolean
+wait_for_layout (Bench     *bench,
+                 GPtrArray *paths,
+                 gint64     start_time,
+                 GArray    *samples,
+                 GError   **error)
+{
+  gint64 end_time = 0;
+  double value;
+  guint i;
+
+  for (i = 0; i < paths->len; i++) {
+    gint64 exited;
+
+    exited = wait_for_event (bench->exited_times, paths->pdata[i]);
+    if (exited == 0) {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                           "Timed out waiting for children to exit");
+      return FALSE;
+    }
+    end_time = MAX (end_time, exited);
+  }
+
+  value = (end_time - start_time) / 1000. - LAYOUT_SLEEP_MS;
+  g_array_append_val (samples, value);
+
+  /* Let the windows close before the next round */
+  for (i = 0; i < paths->len; i++)
+    wait_for_event (bench->removed_times, paths->pdata[i]);
+
+  return TRUE;
+}
+
+static gboolean
+measure_layout_serial (Bench   *bench,
+                       GArray  *samples,
+                       GError **error)
+{
+  gs_unref_ptrarray GPtrArray *paths = NULL;
+  gint64 start_time;
+  int w, t;
+
+  paths = g_ptr_array_new_with_free_func (g_free);
+
+  start_time = g_get_monotonic_time ();
+  for (w = 0; w < layout_windows; w++) {
+    guint window_id = 0;
+
+    for (t = 0; t < layout_tabs; t++) {
+      char *object_path;
+
+      object_path = open_terminal (bench, window_id, sleep_argv, error);
+      if (object_path == NULL)
+        return FALSE;
+      if (window_id == 0)
+        window_id = window_id_from_object_path (object_path);
+      g_ptr_array_add (paths, object_path);
+    }
+  }
+
+  return wait_for_layout (bench, paths, start_time, samples, error);
+}
+
+static gboolean
+measure_layout_restore (Bench   *bench,
+                        GArray  *samples,
+                        GError **error)
+{
+  gs_unref_ptrarray GPtrArray *paths = NULL;
+  gs_unref_variant GVariant *receivers = NULL;
+  GVariantBuilder builder, windows;
+  GVariantIter iter;
+  const char *object_path;
+  gint64 start_time;
+  int w, t;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&builder, "{sv}",
+                         "display", g_variant_new_bytestring (bench->display_name));
+  terminal_client_append_exec_options (&builder, NULL, NULL, 0, FALSE);
+
+  g_variant_builder_init (&windows, G_VARIANT_TYPE ("aa{sv}"));
+  for (w = 0; w < layout_windows; w++) {
+    g_variant_builder_open (&windows, G_VARIANT_TYPE ("a{sv}"));
+    g_variant_builder_open (&windows, G_VARIANT_TYPE ("{sv}"));
+    g_variant_builder_add (&windows, "s", "tabs");
+    g_variant_builder_open (&windows, G_VARIANT_TYPE ("v"));
+    g_variant_builder_open (&windows, G_VARIANT_TYPE ("aa{sv}"));
+
+    for (t = 0; t < layout_tabs; t++) {
+      g_variant_builder_open (&windows, G_VARIANT_TYPE ("a{sv}"));
+      if (t == 0)
+        g_variant_builder_add (&windows, "{sv}", "active", g_variant_new_boolean (TRUE));
+      g_variant_builder_add (&windows, "{sv}",
+                             "cwd", g_variant_new_bytestring (g_get_home_dir ()));
+      g_variant_builder_add (&windows, "{sv}",
+                             "arguments", g_variant_new_bytestring_array (sleep_argv, -1));
+      g_variant_builder_close (&windows); /* a{sv} */
+    }
+
+    g_variant_builder_close (&windows); /* aa{sv} */
+    g_variant_builder_close (&windows); /* v */
+    g_variant_builder_close (&windows); /* {sv} */
+    g_variant_builder_close (&windows); /* a{sv} */
+  }
+
+  start_time = g_get_monotonic_time ();
+  if (!terminal_factory_call_restore_layout_sync (bench->factory,
+                                                  g_variant_builder_end (&builder),
+                                                  g_variant_builder_end (&windows),
+                                                  &receivers,
+                                                  NULL /* errors */,
+                                                  NULL, error))
+    return FALSE;
+
+  paths = g_ptr_array_new_with_free_func (g_free);
+  g_variant_iter_init (&iter, receivers);
+  while (g_variant_iter_next (&iter, "&o", &object_path))
+    g_ptr_array_add (paths, g_strdup (object_path));
+
+  return wait_for_layout (bench, paths, start_time, samples, error);
+}
+
+static gboolean
+run_layout_benchmark (Bench   *bench,
+                      GError **error)
+{
+  gs_unref_array GArray *serial = NULL;
+  gs_unref_array GArray *restore = NULL;
+  gs_free char *name = NULL;
+  int round;
+
+  serial = g_array_new (FALSE, FALSE, sizeof (double));
+  restore = g_array_new (FALSE, FALSE, sizeof (double));
+
+  for (round = 0; round < N_SPAWN_ROUNDS; round++) {
+    if (!measure_layout_serial (bench, serial, error) ||
+        !measure_layout_restore (bench, restore, error))
+      return FALSE;
+  }
+
+  name = g_strdup_printf ("layout %dx%d serial", layout_windows, layout_tabs);
+  print_stats (name, "ms", serial);
+  g_free (name);
+  name = g_strdup_printf ("layout %dx%d one-pass", layout_windows, layout_tabs);
+  print_stats (name, "ms", restore);
+
+  return TRUE;
+}
+
+/* Spare windows */
+
+static const char * const echo_argv[] = { "echo", "ready", NULL };
+
+/* Prints a line like the windows do, so that its first output is reported
+ * too, and stays open so that the server keeps its spare windows.
+ */
+static const char * const anchor_argv[] = { "sh", "-c", "echo ready; exec cat", NULL };
+
+/* Writes the settings for the next server, for the keyfile backend */
+static gboolean
+write_settings (Bench   *bench,
+                guint    spare_window_pool_size,
+                GError **error)
+{
+  gs_free char *dir = NULL;
+  gs_free char *path = NULL;
+  gs_free char *contents = NULL;
+
+  if (bench->config_dir == NULL) {
+    bench->config_dir = g_dir_make_tmp ("gnome-terminal-bench-XXXXXX", error);
+    if (bench->config_dir == NULL)
+      return FALSE;
+  }
+
+  /* This is where the keyfile backend looks for them */
+  dir = g_build_filename (bench->config_dir, "glib-2.0", "settings", NULL);
+  if (g_mkdir_with_parents (dir, 0700) != 0) {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                 "Failed to create %s: %s", dir, g_strerror (errno));
+    return FALSE;
+  }
+
+  path = g_build_filename (dir, "keyfile", NULL);
+  contents = g_strdup_printf ("[org/gnome/terminal/legacy]\n"
+                              "spare-window-pool-size=%u\n",
+                              spare_window_pool_size);
+
+  return g_file_set_contents (path, contents, -1, error);
+}
+
+/* Iterates the main context until the server's debug output has brought
+ * *@counter up to @value.
+ */
+static gboolean
+wait_for_debug_output (const guint *counter,
+                       guint        value,
+                       GError     **error)
+{
+  gboolean timed_out = FALSE;
+  guint timeout_id;
+
+  timeout_id = g_timeout_add (EVENT_TIMEOUT / 1000,
+                              (GSourceFunc) event_timeout_cb, &timed_out);
+
+  while (*counter < value && !timed_out)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (timed_out) {
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                         "Timed out waiting for the server's debug output; "
+                         "was it built with --enable-debug?");
+    return FALSE;
+  }
+
+  g_source_remove (timeout_id);
+  return TRUE;
+}
+
+/* Records the time from CreateInstance to the first output of each of
+ * @iterations new windows, as the server reports it.
+ */
+static gboolean
+measure_first_output (Bench   *bench,
+                      guint    spare_window_pool_size,
+                      GError **error)
+{
+  gs_free char *anchor_path = NULL;
+  gs_free char *warmup_path = NULL;
+  gs_unref_array GArray *close_samples = NULL;
+  int i;
+
+  close_samples = g_array_new (FALSE, FALSE, sizeof (double));
+
+  /* Spare windows are only kept while a real window is open, and the pool
+   * is filled after the next request; so open one window that isn't
+   * measured before the others.
+   */
+  anchor_path = open_terminal (bench, 0, anchor_argv, error);
+  if (anchor_path == NULL)
+    return FALSE;
+  warmup_path = open_terminal (bench, 0, echo_argv, error);
+  if (warmup_path == NULL ||
+      !wait_for_close (bench, warmup_path, close_samples, error) ||
+      !wait_for_debug_output (&bench->first_output->len, 2, error))
+    return FALSE;
+  g_array_set_size (bench->first_output, 0);
+
+  for (i = 0; i < iterations; i++) {
+    gs_free char *object_path = NULL;
+
+    /* Wait for the pool to be refilled, so that every window comes from it */
+    if (!wait_for_debug_output (&bench->n_spare_windows_prepared,
+                                spare_window_pool_size > 0 ? spare_window_pool_size + i : 0,
+                                error))
+      return FALSE;
+
+    object_path = open_terminal (bench, 0, echo_argv, error);
+    if (object_path == NULL ||
+        !wait_for_close (bench, object_path, close_samples, error) ||
+        !wait_for_debug_output (&bench->first_output->len, i + 1, error))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+run_spare_windows_benchmark (Bench   *bench,
+                             GError **error)
+{
+  const guint pool_sizes[] = { 0, (guint) spare_windows };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (pool_sizes); i++) {
+    gs_free char *name = NULL;
+
+    g_array_set_size (bench->first_output, 0);
+
+    if (!write_settings (bench, pool_sizes[i], error) ||
+        !start_server (bench, error) ||
+        !measure_first_output (bench, pool_sizes[i], error))
+      return FALSE;
+
+    stop_server (bench);
+
+    name = g_strdup_printf ("first output, %u spare", pool_sizes[i]);
+    print_stats (name, "ms", bench->first_output);
+  }
+
+  return TRUE;
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+  GOptionContext *context;
+  Bench bench;
+  gs_unref_array GArray *window_open = NULL;
+  gs_unref_array GArray *tab_open = NULL;
+  gs_unref_array GArray *window_close = NULL;
+  gs_unref_array GArray *tab_close = NULL;
+  gs_unref_array GArray *spawn_rate = NULL;
+  gs_free char *anchor_path = NULL;
+  guint anchor_window_id;
+  GError *error = NULL;
+  int rv = EXIT_FAILURE;
+
+  context = g_option_context_new ("");
+  g_option_context_set_summary (context,
+                                "Measures gnome-terminal-server latencies on a private session bus "
+                                "and a virtual display. The server's GSettings schemas must be "
+                                "installed, or found through GSETTINGS_SCHEMA_DIR.");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("Error parsing arguments: %s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (context);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (context);
+
+  if (iterations < 1 || spawn_batch < 1 || output_size < 1 || max_tabs < 1 ||
+      layout_windows < 1 || layout_tabs < 1) {
+    g_printerr ("--iterations, --spawn-batch, --output-size, --max-tabs, --layout-windows "
+                "and --layout-tabs must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  /* The range of the spare-window-pool-size setting */
+  if (spare_windows < 0 || spare_windows > 4) {
+    g_printerr ("--spare-windows must be between 1 and 4\n");
+    return EXIT_FAILURE;
+  }
+
+  memset (&bench, 0, sizeof (bench));
+  bench.exited_times = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  bench.removed_times = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  bench.frame_intervals = g_array_new (FALSE, FALSE, sizeof (double));
+  bench.first_output = g_array_new (FALSE, FALSE, sizeof (double));
+
+  window_open = g_array_new (FALSE, FALSE, sizeof (double));
+  tab_open = g_array_new (FALSE, FALSE, sizeof (double));
+  window_close = g_array_new (FALSE, FALSE, sizeof (double));
+  tab_close = g_array_new (FALSE, FALSE, sizeof (double));
+  spawn_rate = g_array_new (FALSE, FALSE, sizeof (double));
+
+  if (!start_display (&bench, &error))
+    goto out;
+
+  if (spare_windows > 0) {
+    if (run_spare_windows_benchmark (&bench, &error))
+      rv = EXIT_SUCCESS;
+    goto out;
+  }
+
+  if (!start_server (&bench, &error))
+    goto out;
+
+  if (output_mode) {
+    if (run_output_benchmark (&bench, &error))
+      rv = EXIT_SUCCESS;
+    goto out;
+  }
+
+  if (layout_mode) {
+    if (run_layout_benchmark (&bench, &error))
+      rv = EXIT_SUCCESS;
+    goto out;
+  }
+
+  if (!measure_window_open (&bench, window_open, window_close, &error))
+    goto out;
+
+  /* A window that stays open to add the tabs to */
+  anchor_path = open_terminal (&bench, 0, cat_argv, &error);
+  if (anchor_path == NULL)
+    goto out;
+  anchor_window_id = window_id_from_object_path (anchor_path);
+
+  if (!measure_tab_open (&bench, anchor_window_id, tab_open, tab_close, &error) ||
+      !measure_spawn_throughput (&bench, anchor_window_id, spawn_rate, &error))
+    goto out;
+
+  print_stats ("window open", "ms", window_open);
+  print_stats ("tab open", "ms", tab_open);
+  print_stats ("window close", "ms", window_close);
+  print_stats ("tab close", "ms", tab_close);
+  print_stats ("spawn throughput", "spawns/s", spawn_rate);
+
+  rv = EXIT_SUCCESS;
+
+ out:
+  if (error != NULL) {
+    g_dbus_error_strip_remote_error (error);
+    g_printerr ("Error: %s\n", error->message);
+    g_error_free (error);
+  }
+
+  bench_shutdown (&bench);
+
+  return rv;
+}
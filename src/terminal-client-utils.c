@@ -154,26 +154,14 @@ terminal_client_append_exec_options (GVariantBuilder *builder,
   }
 }
 
-/**
- * terminal_client_get_fallback_startup_id:
- *
- * Returns: a fallback startup ID, or %NULL
- */
-char *
-terminal_client_get_fallback_startup_id  (void)
-{
 #if defined(TERMINAL_COMPILATION) && defined(GDK_WINDOWING_X11)
-  GdkDisplay *display;
-  Display *xdisplay;
+
+static char *
+get_startup_id_for_xdisplay (Display *xdisplay)
+{
   Window xwindow;
   XEvent event;
 
-  display = gdk_display_get_default ();
-  if (!GDK_IS_X11_DISPLAY (display))
-    goto out;
-
-  xdisplay = GDK_DISPLAY_XDISPLAY (display);
-
   {
     XSetWindowAttributes attrs;
     Atom atom_name;
@@ -214,7 +202,112 @@ terminal_client_get_fallback_startup_id  (void)
   XDestroyWindow(xdisplay, xwindow);
 
   return g_strdup_printf ("_TIME%lu", event.xproperty.time);
-out:
+}
+
+#endif /* TERMINAL_COMPILATION && GDK_WINDOWING_X11 */
+
+/**
+ * terminal_client_get_fallback_startup_id:
+ *
+ * Returns: a fallback startup ID, or %NULL
+ */
+char *
+terminal_client_get_fallback_startup_id  (void)
+{
+#if defined(TERMINAL_COMPILATION) && defined(GDK_WINDOWING_X11)
+  GdkDisplay *display;
+
+  display = gdk_display_get_default ();
+  if (!GDK_IS_X11_DISPLAY (display))
+    return NULL;
+
+  return get_startup_id_for_xdisplay (GDK_DISPLAY_XDISPLAY (display));
+#else
+  return NULL;
 #endif
+}
+
+/**
+ * terminal_client_get_fallback_startup_id_for_display:
+ * @display_name: the name of an X11 display
+ *
+ * Like terminal_client_get_fallback_startup_id(), but talks to the
+ * X server directly instead of going through GDK, so that it can be
+ * used before (or instead of) initialising GDK.
+ *
+ * Returns: a fallback startup ID, or %NULL
+ */
+char *
+terminal_client_get_fallback_startup_id_for_display (const char *display_name)
+{
+#if defined(TERMINAL_COMPILATION) && defined(GDK_WINDOWING_X11)
+  Display *xdisplay;
+  char *startup_id;
+
+  xdisplay = XOpenDisplay (display_name);
+  if (xdisplay == NULL)
+    return NULL;
+
+  startup_id = get_startup_id_for_xdisplay (xdisplay);
+  XCloseDisplay (xdisplay);
+
+  return startup_id;
+#else
+  return NULL;
+#endif
+}
+
+/**
+ * terminal_client_get_display_name_from_environment:
+ * @is_x11: (out): location to store whether the display is an X11 display
+ *
+ * Determines the name of the display GDK would open by default from
+ * the environment alone, without initialising GDK.
+ *
+ * Returns: (transfer full): the display name, or %NULL if it cannot
+ *   reliably be determined this way
+ */
+char *
+terminal_client_get_display_name_from_environment (gboolean *is_x11)
+{
+  const char *backend, *display;
+  gboolean try_wayland = TRUE, try_x11 = TRUE;
+
+  *is_x11 = FALSE;
+
+  /* Only handle the simple cases; anything else is left to GDK */
+  backend = g_getenv ("GDK_BACKEND");
+  if (backend != NULL && backend[0] != '\0' && strcmp (backend, "*") != 0) {
+    if (strcmp (backend, "wayland") == 0)
+      try_x11 = FALSE;
+    else if (strcmp (backend, "x11") == 0)
+      try_wayland = FALSE;
+    else
+      return NULL;
+  }
+
+  /* GDK prefers wayland over x11 */
+  if (try_wayland) {
+    display = g_getenv ("WAYLAND_DISPLAY");
+    if (display != NULL && display[0] != '\0')
+      return g_strdup (display);
+    if (display == NULL) {
+      gs_free char *path;
+
+      /* libwayland-client falls back to "wayland-0" */
+      path = g_build_filename (g_get_user_runtime_dir (), "wayland-0", NULL);
+      if (g_file_test (path, G_FILE_TEST_EXISTS))
+        return g_strdup ("wayland-0");
+    }
+  }
+
+  if (try_x11) {
+    display = g_getenv ("DISPLAY");
+    if (display != NULL && display[0] != '\0') {
+      *is_x11 = TRUE;
+      return g_strdup (display);
+    }
+  }
+
   return NULL;
 }
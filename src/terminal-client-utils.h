@@ -47,6 +47,10 @@ void terminal_client_append_exec_options            (GVariantBuilder *builder,
 
 char * terminal_client_get_fallback_startup_id      (void);
 
+char * terminal_client_get_fallback_startup_id_for_display (const char *display_name);
+
+char * terminal_client_get_display_name_from_environment (gboolean *is_x11);
+
 G_END_DECLS
 
 #endif /* TERMINAL_UTIL_UTILS_H */
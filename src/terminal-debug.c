@@ -17,12 +17,87 @@
 
 #include <config.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <glib.h>
 
+#ifdef WITH_SYSPROF_CAPTURE
+#include <unistd.h>
+#include <sysprof-capture.h>
+#endif
+
 #include "terminal-debug.h"
+#include "terminal-libgsystem.h"
 
 TerminalDebugFlags _terminal_debug_flags;
 
+#ifdef ENABLE_DEBUG
+
+#define TRACE_BUFFER_SIZE (4096)
+#define MAX_SPAN_DEPTH    (32)
+
+#define DEFAULT_STALL_THRESHOLD (200) /* ms */
+#define N_STALL_BUCKETS         (6)
+
+typedef enum {
+  TRACE_EVENT_SPAN,
+  TRACE_EVENT_COUNTER,
+  TRACE_EVENT_STALL
+} TraceEventType;
+
+typedef struct {
+  TraceEventType type;
+  const char *name; /* stall: the span it is attributed to */
+  gint64 time;  /* span, stall: begin time; counter: time of the change */
+  gint64 value; /* span, stall: duration in µs; counter: new total */
+  gint64 delta; /* counter only */
+  guint depth;  /* span only */
+} TraceEvent;
+
+typedef struct {
+  guint count;
+  guint buckets[N_STALL_BUCKETS];
+  gint64 max; /* µs */
+} StallStats;
+
+static gint64 start_time;
+
+/* The trace buffer is a ring; trace_n_events counts all events ever
+ * recorded, so the oldest one is at trace_n_events % TRACE_BUFFER_SIZE
+ * once it has wrapped.
+ */
+static GMutex trace_lock;
+static TraceEvent trace_buffer[TRACE_BUFFER_SIZE];
+static guint64 trace_n_events;
+static GHashTable *trace_counters; /* name → gint64 total */
+
+/* Only spans on the main thread nest. The watchdog thread reads the
+ * innermost name, so the depth is accessed atomically.
+ */
+static GThread *main_thread;
+static const char *span_names[MAX_SPAN_DEPTH];
+static volatile gint span_depth;
+
+/* Main loop stall detection. The main thread updates last_heartbeat;
+ * the watchdog thread notices when it gets too old, and remembers the
+ * span that was active then.
+ */
+static GMutex watchdog_lock;
+static gint64 stall_threshold; /* µs */
+static gint64 last_heartbeat;
+static gboolean stalled;
+static const char *stall_span;
+static GHashTable *stall_stats; /* span name → StallStats */
+
+/* Upper bounds of the stall histogram buckets, in ms; the last one is open */
+static const guint stall_bucket_bounds[N_STALL_BUCKETS - 1] = { 250, 500, 1000, 2500, 5000 };
+
+#ifdef WITH_SYSPROF_CAPTURE
+static SysprofCaptureWriter *capture_writer;
+#endif
+#endif /* ENABLE_DEBUG */
+
 void
 _terminal_debug_init(void)
 {
@@ -38,10 +113,421 @@ _terminal_debug_init(void)
     { "settings-list", TERMINAL_DEBUG_SETTINGS_LIST },
     { "appmenu",       TERMINAL_DEBUG_APPMENU       },
     { "search",        TERMINAL_DEBUG_SEARCH        },
+    { "perf",          TERMINAL_DEBUG_PERF          },
+    { "trace",         TERMINAL_DEBUG_TRACE         },
+    { "stalls",        TERMINAL_DEBUG_STALLS        },
+    { "frames",        TERMINAL_DEBUG_FRAMES        },
   };
 
   _terminal_debug_flags = g_parse_debug_string (g_getenv ("GNOME_TERMINAL_DEBUG"),
                                                 keys, G_N_ELEMENTS (keys));
+
+  start_time = g_get_monotonic_time ();
+  main_thread = g_thread_self ();
+
+#ifdef WITH_SYSPROF_CAPTURE
+  /* Also record the spans as marks in a capture file that sysprof can open */
+  if (_terminal_debug_on (TERMINAL_DEBUG_PERF)) {
+    const char *filename;
+
+    filename = g_getenv ("GNOME_TERMINAL_PERF_CAPTURE");
+    if (filename != NULL && filename[0] != '\0') {
+      capture_writer = sysprof_capture_writer_new (filename, 0);
+      if (capture_writer == NULL)
+        g_printerr ("Failed to create capture file \"%s\"\n", filename);
+    }
+  }
+#endif /* WITH_SYSPROF_CAPTURE */
 #endif /* ENABLE_DEBUG */
 }
 
+#ifdef ENABLE_DEBUG
+
+static void
+trace_record (const TraceEvent *event)
+{
+  g_mutex_lock (&trace_lock);
+  trace_buffer[trace_n_events % TRACE_BUFFER_SIZE] = *event;
+  trace_n_events++;
+  g_mutex_unlock (&trace_lock);
+}
+
+/**
+ * _terminal_debug_span_push:
+ * @name: the name of the span
+ *
+ * Use _terminal_debug_span_begin() instead.
+ *
+ * Returns: the begin time of the span
+ */
+gint64
+_terminal_debug_span_push (const char *name)
+{
+  if (g_thread_self () == main_thread) {
+    gint depth = g_atomic_int_get (&span_depth);
+
+    if (depth < MAX_SPAN_DEPTH)
+      g_atomic_pointer_set (&span_names[depth], name);
+    g_atomic_int_inc (&span_depth);
+  }
+
+  return g_get_monotonic_time ();
+}
+
+/* Returns the innermost active span on the main thread, or %NULL.
+ * May be called from any thread.
+ */
+static const char *
+get_active_span (void)
+{
+  gint depth = g_atomic_int_get (&span_depth);
+
+  if (depth <= 0)
+    return NULL;
+
+  return g_atomic_pointer_get (&span_names[MIN (depth, MAX_SPAN_DEPTH) - 1]);
+}
+
+/**
+ * _terminal_debug_span_end:
+ * @begin_time: the value returned by _terminal_debug_span_begin()
+ * @name: the name of the span
+ *
+ * Reports the time since @begin_time under the "perf" category, together
+ * with when the span started relative to _terminal_debug_init(), and
+ * records the span in the trace buffer under the "trace" category.
+ */
+void
+_terminal_debug_span_end (gint64 begin_time,
+                          const char *name)
+{
+  gint64 end_time;
+  guint depth = 0;
+
+  if (begin_time == 0)
+    return;
+
+  end_time = g_get_monotonic_time ();
+
+  if (g_thread_self () == main_thread && g_atomic_int_get (&span_depth) > 0) {
+    g_atomic_int_add (&span_depth, -1);
+    depth = g_atomic_int_get (&span_depth);
+  }
+
+  if (_terminal_debug_on (TERMINAL_DEBUG_PERF))
+    g_printerr ("[perf] %s: %.3f ms (started at +%.3f ms)\n",
+                name,
+                (end_time - begin_time) / 1000.,
+                (begin_time - start_time) / 1000.);
+
+  if (_terminal_debug_on (TERMINAL_DEBUG_TRACE)) {
+    TraceEvent event = { TRACE_EVENT_SPAN, name, begin_time, end_time - begin_time, 0, depth };
+
+    trace_record (&event);
+  }
+
+#ifdef WITH_SYSPROF_CAPTURE
+  if (capture_writer != NULL) {
+    /* Both use CLOCK_MONOTONIC; sysprof wants nanoseconds */
+    sysprof_capture_writer_add_mark (capture_writer,
+                                     begin_time * 1000,
+                                     -1 /* any CPU */,
+                                     getpid (),
+                                     (end_time - begin_time) * 1000,
+                                     "gnome-terminal",
+                                     name,
+                                     "");
+    sysprof_capture_writer_flush (capture_writer);
+  }
+#endif /* WITH_SYSPROF_CAPTURE */
+}
+
+/**
+ * _terminal_debug_counter_add_real:
+ * @name: the name of the counter
+ * @delta: the amount to add
+ *
+ * Use _terminal_debug_counter_add() instead.
+ */
+void
+_terminal_debug_counter_add_real (const char *name,
+                                  gint64 delta)
+{
+  TraceEvent event = { TRACE_EVENT_COUNTER, name, 0, 0, delta, 0 };
+  gint64 *total;
+
+  event.time = g_get_monotonic_time ();
+
+  g_mutex_lock (&trace_lock);
+  if (trace_counters == NULL)
+    trace_counters = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+  total = g_hash_table_lookup (trace_counters, name);
+  if (total == NULL) {
+    total = g_new0 (gint64, 1);
+    g_hash_table_insert (trace_counters, (gpointer) name, total);
+  }
+  *total += delta;
+  event.value = *total;
+  g_mutex_unlock (&trace_lock);
+
+  trace_record (&event);
+}
+
+static void append_trace (GString *string);
+static void append_stall_stats (GString *string);
+
+static int
+compare_counter_names (gconstpointer a,
+                       gconstpointer b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+/**
+ * _terminal_debug_trace_dump:
+ *
+ * Formats the events in the trace buffer, oldest first, followed by the
+ * totals of all counters, and the main loop stalls by span.
+ *
+ * Returns: (transfer full): the trace as text
+ */
+char *
+_terminal_debug_trace_dump (void)
+{
+  GString *string;
+
+  string = g_string_new (NULL);
+
+  if (!_terminal_debug_on (TERMINAL_DEBUG_TRACE) &&
+      !_terminal_debug_on (TERMINAL_DEBUG_STALLS)) {
+    g_string_append (string, "Tracing is off; run with GNOME_TERMINAL_DEBUG=trace,stalls\n");
+    return g_string_free (string, FALSE);
+  }
+
+  if (_terminal_debug_on (TERMINAL_DEBUG_TRACE))
+    append_trace (string);
+  if (_terminal_debug_on (TERMINAL_DEBUG_STALLS))
+    append_stall_stats (string);
+
+  return g_string_free (string, FALSE);
+}
+
+static void
+append_trace (GString *string)
+{
+  guint64 i, first;
+  gs_free const char **names = NULL;
+  guint n_names = 0;
+
+  g_mutex_lock (&trace_lock);
+
+  first = trace_n_events > TRACE_BUFFER_SIZE ? trace_n_events - TRACE_BUFFER_SIZE : 0;
+  g_string_append_printf (string, "Trace: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " events\n",
+                          trace_n_events - first, trace_n_events);
+
+  for (i = first; i < trace_n_events; i++) {
+    const TraceEvent *event = &trace_buffer[i % TRACE_BUFFER_SIZE];
+
+    switch (event->type) {
+    case TRACE_EVENT_SPAN:
+      g_string_append_printf (string, "%+12.3f ms  span     %*s%s: %.3f ms\n",
+                              (event->time - start_time) / 1000.,
+                              (int) MIN (event->depth, MAX_SPAN_DEPTH) * 2, "",
+                              event->name,
+                              event->value / 1000.);
+      break;
+    case TRACE_EVENT_COUNTER:
+      g_string_append_printf (string, "%+12.3f ms  counter  %s = %" G_GINT64_FORMAT " (%+" G_GINT64_FORMAT ")\n",
+                              (event->time - start_time) / 1000.,
+                              event->name,
+                              event->value,
+                              event->delta);
+      break;
+    case TRACE_EVENT_STALL:
+      g_string_append_printf (string, "%+12.3f ms  stall    %.3f ms in %s\n",
+                              (event->time - start_time) / 1000.,
+                              event->value / 1000.,
+                              event->name);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+  }
+
+  if (trace_counters != NULL)
+    names = (const char **) g_hash_table_get_keys_as_array (trace_counters, &n_names);
+  if (n_names > 0) {
+    qsort (names, n_names, sizeof (char *), compare_counter_names);
+
+    g_string_append (string, "Counters:\n");
+    for (i = 0; i < n_names; i++)
+      g_string_append_printf (string, "  %s = %" G_GINT64_FORMAT "\n",
+                              names[i],
+                              *(gint64 *) g_hash_table_lookup (trace_counters, names[i]));
+  }
+
+  g_mutex_unlock (&trace_lock);
+}
+
+static void
+append_stall_stats (GString *string)
+{
+  gs_free const char **names = NULL;
+  guint n_names = 0;
+  guint i, j;
+
+  g_mutex_lock (&watchdog_lock);
+
+  g_string_append_printf (string, "Main loop stalls over %" G_GINT64_FORMAT " ms:\n",
+                          stall_threshold / 1000);
+
+  if (stall_stats != NULL)
+    names = (const char **) g_hash_table_get_keys_as_array (stall_stats, &n_names);
+  if (n_names > 0)
+    qsort (names, n_names, sizeof (char *), compare_counter_names);
+
+  for (i = 0; i < n_names; i++) {
+    StallStats *stats = g_hash_table_lookup (stall_stats, names[i]);
+
+    g_string_append_printf (string, "  %s: %u, max %.0f ms\n   ",
+                            names[i], stats->count, stats->max / 1000.);
+    for (j = 0; j < N_STALL_BUCKETS; j++) {
+      if (j < N_STALL_BUCKETS - 1)
+        g_string_append_printf (string, " <%u ms: %u", stall_bucket_bounds[j], stats->buckets[j]);
+      else
+        g_string_append_printf (string, " ≥%u ms: %u\n", stall_bucket_bounds[j - 1], stats->buckets[j]);
+    }
+  }
+
+  g_mutex_unlock (&watchdog_lock);
+}
+
+/* Called on the main thread once it iterates again after a stall */
+static void
+record_stall (const char *span,
+              gint64 begin_time,
+              gint64 duration)
+{
+  StallStats *stats;
+  guint bucket;
+
+  g_printerr ("[stalls] main loop stalled for %.0f ms in %s\n", duration / 1000., span);
+
+  for (bucket = 0; bucket < N_STALL_BUCKETS - 1; bucket++)
+    if (duration < stall_bucket_bounds[bucket] * (gint64) 1000)
+      break;
+
+  g_mutex_lock (&watchdog_lock);
+  if (stall_stats == NULL)
+    stall_stats = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+  stats = g_hash_table_lookup (stall_stats, span);
+  if (stats == NULL) {
+    stats = g_new0 (StallStats, 1);
+    g_hash_table_insert (stall_stats, (gpointer) span, stats);
+  }
+  stats->count++;
+  stats->buckets[bucket]++;
+  stats->max = MAX (stats->max, duration);
+  g_mutex_unlock (&watchdog_lock);
+
+  if (_terminal_debug_on (TERMINAL_DEBUG_TRACE)) {
+    TraceEvent event = { TRACE_EVENT_STALL, span, begin_time, duration, 0, 0 };
+
+    trace_record (&event);
+  }
+}
+
+static gboolean
+heartbeat_cb (gpointer user_data)
+{
+  gint64 now, previous;
+  const char *span = NULL;
+  gboolean was_stalled;
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&watchdog_lock);
+  previous = last_heartbeat;
+  last_heartbeat = now;
+  was_stalled = stalled;
+  if (was_stalled)
+    span = stall_span;
+  stalled = FALSE;
+  stall_span = NULL;
+  g_mutex_unlock (&watchdog_lock);
+
+  if (was_stalled)
+    record_stall (span, previous, now - previous);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+watchdog_thread_func (gpointer data)
+{
+  gulong interval = stall_threshold / 4;
+
+  for (;;) {
+    gint64 now;
+    const char *span;
+
+    g_usleep (interval);
+
+    now = g_get_monotonic_time ();
+    span = get_active_span ();
+
+    g_mutex_lock (&watchdog_lock);
+    if (!stalled && now - last_heartbeat > stall_threshold) {
+      stalled = TRUE;
+      stall_span = span != NULL ? span : "(no span)";
+
+      /* Say so right away, in case the main loop never recovers */
+      g_printerr ("[stalls] main loop has not iterated for %.0f ms, in %s\n",
+                  (now - last_heartbeat) / 1000., stall_span);
+    } else if (stalled && span != NULL && g_str_equal (stall_span, "(no span)")) {
+      stall_span = span;
+    }
+    g_mutex_unlock (&watchdog_lock);
+  }
+
+  return NULL;
+}
+
+/**
+ * _terminal_debug_watchdog_start:
+ *
+ * Under the "stalls" category, starts a thread that reports when the
+ * default main context has not iterated for longer than
+ * $GNOME_TERMINAL_STALL_THRESHOLD milliseconds (200 by default), and
+ * attributes each stall to the innermost span that was active during it.
+ * Must be called on the main thread.
+ */
+void
+_terminal_debug_watchdog_start (void)
+{
+  const char *threshold;
+  GThread *thread;
+
+  if (!_terminal_debug_on (TERMINAL_DEBUG_STALLS))
+    return;
+
+  stall_threshold = DEFAULT_STALL_THRESHOLD;
+  threshold = g_getenv ("GNOME_TERMINAL_STALL_THRESHOLD");
+  if (threshold != NULL) {
+    gint64 value = g_ascii_strtoll (threshold, NULL, 10);
+
+    if (value >= 10)
+      stall_threshold = value;
+  }
+  stall_threshold *= 1000;
+
+  last_heartbeat = g_get_monotonic_time ();
+  g_timeout_add (stall_threshold / 4000, heartbeat_cb, NULL);
+
+  thread = g_thread_new ("stall watchdog", watchdog_thread_func, NULL);
+  g_thread_unref (thread);
+}
+
+#endif /* ENABLE_DEBUG */
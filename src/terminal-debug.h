@@ -34,7 +34,11 @@ typedef enum {
   TERMINAL_DEBUG_PROFILE       = 1 << 6,
   TERMINAL_DEBUG_SETTINGS_LIST = 1 << 7,
   TERMINAL_DEBUG_APPMENU       = 1 << 8,
-  TERMINAL_DEBUG_SEARCH        = 1 << 9
+  TERMINAL_DEBUG_SEARCH        = 1 << 9,
+  TERMINAL_DEBUG_PERF          = 1 << 10,
+  TERMINAL_DEBUG_TRACE         = 1 << 11,
+  TERMINAL_DEBUG_STALLS        = 1 << 12,
+  TERMINAL_DEBUG_FRAMES        = 1 << 13
 } TerminalDebugFlags;
 
 void _terminal_debug_init(void);
@@ -54,6 +58,49 @@ _terminal_debug_on (TerminalDebugFlags flags)
 #define _TERMINAL_DEBUG_IF(flags) if (0)
 #endif
 
+/* Timed spans, printed under the "perf" category and recorded in the
+ * trace buffer under the "trace" category:
+ *
+ *   gint64 span = _terminal_debug_span_begin ("name");
+ *   ...
+ *   _terminal_debug_span_end (span, "name");
+ *
+ * Spans on the main thread nest; every begin must be matched by an end.
+ * The names must be static strings.
+ *
+ * Counters keep a running total of @delta, recorded in the trace buffer
+ * under the "trace" category.
+ *
+ * Under the "stalls" category, a watchdog thread reports when the main
+ * loop has not iterated for a while, together with the innermost span
+ * that was active at the time; see _terminal_debug_watchdog_start().
+ */
+#ifdef ENABLE_DEBUG
+#define _terminal_debug_span_begin(name) \
+  ((_terminal_debug_flags & (TERMINAL_DEBUG_PERF | TERMINAL_DEBUG_TRACE | TERMINAL_DEBUG_STALLS)) ? \
+   _terminal_debug_span_push (name) : 0)
+gint64 _terminal_debug_span_push (const char *name);
+void _terminal_debug_span_end (gint64 begin_time,
+                               const char *name);
+
+#define _terminal_debug_counter_add(name, delta) \
+  G_STMT_START { \
+    _TERMINAL_DEBUG_IF (TERMINAL_DEBUG_TRACE) _terminal_debug_counter_add_real (name, delta); \
+  } G_STMT_END
+void _terminal_debug_counter_add_real (const char *name,
+                                       gint64 delta);
+
+char *_terminal_debug_trace_dump (void);
+
+void _terminal_debug_watchdog_start (void);
+#else
+#define _terminal_debug_span_begin(name) ((gint64) 0)
+#define _terminal_debug_span_end(begin_time, name) \
+  G_STMT_START { (void) (begin_time); (void) (name); } G_STMT_END
+#define _terminal_debug_counter_add(name, delta) \
+  G_STMT_START { } G_STMT_END
+#endif
+
 #if defined(__GNUC__) && G_HAVE_GNUC_VARARGS
 #define _terminal_debug_print(flags, fmt, ...) \
   G_STMT_START { _TERMINAL_DEBUG_IF(flags) g_printerr(fmt, ##__VA_ARGS__); } G_STMT_END
@@ -18,17 +18,24 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <string.h>
 
+#ifdef __GLIBC__
+#include <gnu/libc-version.h>
+#endif
+
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
 #include "terminal-app.h"
 #include "terminal-debug.h"
+#include "terminal-defines.h"
 #include "terminal-encoding.h"
 #include "terminal-schemas.h"
 #include "terminal-util.h"
+#include "terminal-libgsystem.h"
 
 /* Overview
  *
@@ -43,8 +50,17 @@
  * If the setting list contains an encoding not in the
  * predetermined table, then that encoding is
  * labeled "user defined" but still appears in the menu.
+ *
+ * Checking whether iconv supports an encoding is slow, so the results
+ * are cached on disk, keyed by the C library version; encodings that are
+ * not in the cache are checked on a worker thread.
  */
 
+#define VALIDITY_CACHE_FILENAME       "encodings"
+#define VALIDITY_CACHE_GROUP          "Cache"
+#define VALIDITY_CACHE_VERSION_KEY    "Version"
+#define VALIDITY_CACHE_VALID_GROUP    "Valid"
+
 static const struct {
   const char *charset;
   const char *name;
@@ -175,41 +191,40 @@ terminal_encoding_get_charset (TerminalEncoding *encoding)
   return encoding->charset;
 }
 
-gboolean
-terminal_encoding_is_valid (TerminalEncoding *encoding)
+/* Thread-safe; only touches @charset */
+static gboolean
+charset_is_valid (const char *charset)
 {
   /* All of the printing ASCII characters from space (32) to the tilde (126) */
   static const char ascii_sample[] =
       " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
   char *converted;
   gsize bytes_read = 0, bytes_written = 0;
+  gboolean valid;
   GError *error = NULL;
 
-  if (encoding->validity_checked)
-    return encoding->valid;
-
   /* Test that the encoding is a proper superset of ASCII (which naive
    * apps are going to use anyway) by attempting to validate the text
    * using the current encoding.  This also flushes out any encodings
    * which the underlying GIConv implementation can't support.
    */
   converted = g_convert (ascii_sample, sizeof (ascii_sample) - 1,
-                         terminal_encoding_get_charset (encoding), "UTF-8",
+                         charset, "UTF-8",
                          &bytes_read, &bytes_written, &error);
 
   /* The encoding is only valid if ASCII passes through cleanly. */
-  encoding->valid = (bytes_read == (sizeof (ascii_sample) - 1)) &&
-                    (converted != NULL) &&
-                    (strcmp (converted, ascii_sample) == 0);
+  valid = (bytes_read == (sizeof (ascii_sample) - 1)) &&
+          (converted != NULL) &&
+          (strcmp (converted, ascii_sample) == 0);
 
 #ifdef ENABLE_DEBUG
   _TERMINAL_DEBUG_IF (TERMINAL_DEBUG_ENCODINGS)
   {
-    if (!encoding->valid)
+    if (!valid)
       {
         _terminal_debug_print (TERMINAL_DEBUG_ENCODINGS,
                                "Rejecting encoding %s as invalid:\n",
-                               terminal_encoding_get_charset (encoding));
+                               charset);
         _terminal_debug_print (TERMINAL_DEBUG_ENCODINGS,
                                " input  \"%s\"\n",
                                ascii_sample);
@@ -224,13 +239,23 @@ terminal_encoding_is_valid (TerminalEncoding *encoding)
     else
         _terminal_debug_print (TERMINAL_DEBUG_ENCODINGS,
                                "Encoding %s is valid\n\n",
-                               terminal_encoding_get_charset (encoding));
+                               charset);
   }
 #endif
 
   g_clear_error (&error);
   g_free (converted);
 
+  return valid;
+}
+
+gboolean
+terminal_encoding_is_valid (TerminalEncoding *encoding)
+{
+  if (encoding->validity_checked)
+    return encoding->valid;
+
+  encoding->valid = charset_is_valid (terminal_encoding_get_charset (encoding));
   encoding->validity_checked = TRUE;
   return encoding->valid;
 }
@@ -263,3 +288,258 @@ terminal_encodings_get_builtins (void)
 
   return encodings_hashtable;
 }
+
+/* Validity cache */
+
+static const char *
+get_validity_cache_version (void)
+{
+#ifdef __GLIBC__
+  return gnu_get_libc_version ();
+#else
+  /* Can't tell when iconv changes; don't persist anything */
+  return NULL;
+#endif
+}
+
+static char *
+get_validity_cache_filename (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           TERMINAL_APPLICATION_ID,
+                           VALIDITY_CACHE_FILENAME,
+                           NULL);
+}
+
+/**
+ * terminal_encodings_load_validity_cache:
+ * @encodings: a hash table of #TerminalEncoding from terminal_encodings_get_builtins()
+ *
+ * Marks the encodings in @encodings whose validity is known from the
+ * on-disk cache as checked, so that terminal_encoding_is_valid() won't
+ * have to check them again.
+ */
+void
+terminal_encodings_load_validity_cache (GHashTable *encodings)
+{
+  gs_free char *filename = NULL;
+  gs_free char *version = NULL;
+  GKeyFile *key_file;
+  GHashTableIter iter;
+  gpointer value;
+  guint n_loaded = 0;
+
+  if (get_validity_cache_version () == NULL)
+    return;
+
+  filename = get_validity_cache_filename ();
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, NULL))
+    goto out;
+
+  version = g_key_file_get_string (key_file, VALIDITY_CACHE_GROUP, VALIDITY_CACHE_VERSION_KEY, NULL);
+  if (g_strcmp0 (version, get_validity_cache_version ()) != 0) {
+    _terminal_debug_print (TERMINAL_DEBUG_ENCODINGS,
+                           "Ignoring encoding validity cache for C library version %s\n",
+                           version ? version : "(null)");
+    goto out;
+  }
+
+  g_hash_table_iter_init (&iter, encodings);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    TerminalEncoding *encoding = value;
+    gboolean valid;
+    GError *error = NULL;
+
+    if (encoding->validity_checked || encoding->is_custom)
+      continue;
+
+    valid = g_key_file_get_boolean (key_file, VALIDITY_CACHE_VALID_GROUP,
+                                    terminal_encoding_get_charset (encoding), &error);
+    if (error != NULL) {
+      g_error_free (error);
+      continue;
+    }
+
+    encoding->valid = valid != FALSE;
+    encoding->validity_checked = TRUE;
+    n_loaded++;
+  }
+
+  _terminal_debug_print (TERMINAL_DEBUG_ENCODINGS,
+                         "Loaded validity of %u encodings from the cache\n",
+                         n_loaded);
+
+ out:
+  g_key_file_unref (key_file);
+}
+
+static void
+save_validity_cache (GHashTable *encodings)
+{
+  gs_free char *filename = NULL;
+  gs_free char *dirname = NULL;
+  gs_free char *data = NULL;
+  gsize len;
+  GKeyFile *key_file;
+  GHashTableIter iter;
+  gpointer value;
+  GError *error = NULL;
+
+  if (get_validity_cache_version () == NULL)
+    return;
+
+  key_file = g_key_file_new ();
+  g_key_file_set_string (key_file, VALIDITY_CACHE_GROUP, VALIDITY_CACHE_VERSION_KEY,
+                         get_validity_cache_version ());
+
+  g_hash_table_iter_init (&iter, encodings);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    TerminalEncoding *encoding = value;
+
+    if (!encoding->validity_checked || encoding->is_custom)
+      continue;
+
+    g_key_file_set_boolean (key_file, VALIDITY_CACHE_VALID_GROUP,
+                            terminal_encoding_get_charset (encoding),
+                            encoding->valid);
+  }
+
+  data = g_key_file_to_data (key_file, &len, NULL);
+  g_key_file_unref (key_file);
+
+  filename = get_validity_cache_filename ();
+  dirname = g_path_get_dirname (filename);
+  if (g_mkdir_with_parents (dirname, 0700) != 0 ||
+      !g_file_set_contents (filename, data, len, &error)) {
+    _terminal_debug_print (TERMINAL_DEBUG_ENCODINGS,
+                           "Failed to save the encoding validity cache: %s\n",
+                           error ? error->message : g_strerror (errno));
+    g_clear_error (&error);
+  }
+}
+
+typedef struct {
+  const char **charsets; /* interned */
+  gboolean *valid;
+  guint n_charsets;
+} ValidateData;
+
+static void
+validate_data_free (ValidateData *data)
+{
+  g_free (data->charsets);
+  g_free (data->valid);
+  g_slice_free (ValidateData, data);
+}
+
+static void
+validate_thread (GTask        *task,
+                 gpointer      source_object,
+                 gpointer      task_data,
+                 GCancellable *cancellable)
+{
+  ValidateData *data = task_data;
+  guint i;
+
+  for (i = 0; i < data->n_charsets; i++) {
+    if (g_task_return_error_if_cancelled (task))
+      return;
+
+    data->valid[i] = charset_is_valid (data->charsets[i]);
+  }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * terminal_encodings_validate_async:
+ * @encodings: a hash table of #TerminalEncoding
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: the callback to call when done
+ * @user_data: data to pass to @callback
+ *
+ * Checks the validity of all encodings in @encodings that haven't been
+ * checked yet on a worker thread. Call terminal_encodings_validate_finish()
+ * from @callback to store the results in @encodings.
+ */
+void
+terminal_encodings_validate_async (GHashTable         *encodings,
+                                   GCancellable       *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer            user_data)
+{
+  GTask *task;
+  ValidateData *data;
+  GHashTableIter iter;
+  gpointer value;
+
+  data = g_slice_new0 (ValidateData);
+  data->charsets = g_new (const char *, g_hash_table_size (encodings));
+  data->valid = g_new0 (gboolean, g_hash_table_size (encodings));
+
+  g_hash_table_iter_init (&iter, encodings);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    TerminalEncoding *encoding = value;
+
+    if (!encoding->validity_checked)
+      data->charsets[data->n_charsets++] = terminal_encoding_get_charset (encoding);
+  }
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, terminal_encodings_validate_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) validate_data_free);
+
+  if (data->n_charsets == 0)
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_run_in_thread (task, validate_thread);
+
+  g_object_unref (task);
+}
+
+/**
+ * terminal_encodings_validate_finish:
+ * @encodings: the hash table passed to terminal_encodings_validate_async()
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Stores the results of terminal_encodings_validate_async() in
+ * @encodings, and updates the on-disk cache.
+ *
+ * Returns: %TRUE if any encoding was checked, or %FALSE if none needed to
+ *   be or there was an error
+ */
+gboolean
+terminal_encodings_validate_finish (GHashTable   *encodings,
+                                    GAsyncResult *result,
+                                    GError      **error)
+{
+  ValidateData *data;
+  guint i;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+  if (!g_task_propagate_boolean (G_TASK (result), error))
+    return FALSE;
+
+  data = g_task_get_task_data (G_TASK (result));
+  if (data->n_charsets == 0)
+    return FALSE;
+
+  for (i = 0; i < data->n_charsets; i++) {
+    TerminalEncoding *encoding;
+
+    /* The encoding may have been checked meanwhile on the main thread */
+    encoding = g_hash_table_lookup (encodings, data->charsets[i]);
+    if (encoding == NULL || encoding->validity_checked)
+      continue;
+
+    encoding->valid = data->valid[i] != FALSE;
+    encoding->validity_checked = TRUE;
+  }
+
+  save_validity_cache (encodings);
+
+  return TRUE;
+}
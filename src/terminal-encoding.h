@@ -52,4 +52,15 @@ const char *terminal_encoding_get_charset (TerminalEncoding *encoding);
 
 GHashTable *terminal_encodings_get_builtins (void);
 
+void terminal_encodings_load_validity_cache (GHashTable *encodings);
+
+void terminal_encodings_validate_async (GHashTable         *encodings,
+                                        GCancellable       *cancellable,
+                                        GAsyncReadyCallback callback,
+                                        gpointer            user_data);
+
+gboolean terminal_encodings_validate_finish (GHashTable   *encodings,
+                                             GAsyncResult *result,
+                                             GError      **error);
+
 #endif /* TERMINAL_ENCODING_H */
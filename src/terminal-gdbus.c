@@ -97,6 +97,28 @@ terminal_receiver_impl_set_screen (TerminalReceiverImpl *impl,
 
 /* Class implementation */
 
+typedef struct {
+  TerminalReceiver *receiver;
+  GDBusMethodInvocation *invocation;
+} ExecData;
+
+static void
+exec_done_cb (GObject *source_object,
+              GAsyncResult *result,
+              gpointer user_data)
+{
+  ExecData *data = user_data;
+  GError *error = NULL;
+
+  if (!terminal_screen_exec_finish (TERMINAL_SCREEN (source_object), result, &error))
+    g_dbus_method_invocation_take_error (data->invocation, error);
+  else
+    terminal_receiver_complete_exec (data->receiver, data->invocation, NULL /* outfdlist */);
+
+  g_object_unref (data->receiver);
+  g_slice_free (ExecData, data);
+}
+
 static gboolean 
 terminal_receiver_impl_exec (TerminalReceiver *receiver,
                              GDBusMethodInvocation *invocation,
@@ -111,7 +133,7 @@ terminal_receiver_impl_exec (TerminalReceiver *receiver,
   char **exec_argv, **envv;
   gsize exec_argc;
   GVariant *fd_array;
-  GError *error;
+  ExecData *data;
 
   if (priv->screen == NULL) {
     g_dbus_method_invocation_return_error_literal (invocation,
@@ -176,18 +198,19 @@ terminal_receiver_impl_exec (TerminalReceiver *receiver,
 
   exec_argv = (char **) g_variant_get_bytestring_array (arguments, &exec_argc);
 
-  error = NULL;
-  if (!terminal_screen_exec (priv->screen,
-                             exec_argc > 0 ? exec_argv : NULL,
-                             envv,
-                             shell,
-                             working_directory,
-                             fd_list, fd_array,
-                             &error)) {
-    g_dbus_method_invocation_take_error (invocation, error);
-  } else {
-    terminal_receiver_complete_exec (receiver, invocation, NULL /* outfdlist */);
-  }
+  /* Only reply once the child is running; launching it may wait for the
+   * scrollback to be restored.
+   */
+  data = g_slice_new (ExecData);
+  data->receiver = g_object_ref (receiver);
+  data->invocation = invocation;
+  terminal_screen_exec_async (priv->screen,
+                              exec_argc > 0 ? exec_argv : NULL,
+                              envv,
+                              shell,
+                              working_directory,
+                              fd_list, fd_array,
+                              exec_done_cb, data);
 
   g_free (exec_argv);
   g_free (envv);
@@ -354,6 +377,201 @@ screen_destroy_cb (GObject *screen,
   g_object_set_data (screen, RECEIVER_IMPL_SKELETON_DATA_KEY, NULL);
 }
 
+static GdkScreen *
+get_screen_for_options (GVariant *options,
+                        GError **error)
+{
+  const char *display_name;
+  int screen_number;
+  GdkScreen *gdk_screen;
+
+  if (!g_variant_lookup (options, "display", "^&ay", &display_name)) {
+    g_set_error_literal (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                         "No display specified");
+    return NULL;
+  }
+
+  screen_number = 0;
+  gdk_screen = terminal_util_get_screen_by_display_name (display_name, screen_number);
+  if (gdk_screen == NULL) {
+    g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                 "No screen %d on display \"%s\"",
+                 screen_number, display_name);
+    return NULL;
+  }
+
+  return gdk_screen;
+}
+
+/* Clients only resolve profile UUIDs themselves; names are looked up here,
+ * where the profiles list keeps its name index alive.
+ */
+static GSettings *
+ref_profile_for_options (TerminalSettingsList *profiles_list,
+                         GVariant *options,
+                         GError **error)
+{
+  const char *uuid_or_name;
+  gboolean fallback;
+  GSettings *profile;
+  GError *err = NULL;
+
+  if (!g_variant_lookup (options, "profile", "&s", &uuid_or_name))
+    uuid_or_name = NULL;
+  if (!g_variant_lookup (options, "profile-fallback", "b", &fallback))
+    fallback = FALSE;
+
+  profile = terminal_profiles_list_ref_profile_by_uuid_or_name (profiles_list, uuid_or_name, &err);
+  if (profile == NULL && fallback && uuid_or_name != NULL) {
+    g_printerr ("Profile '%s' specified but not found. Attempting to fall back "
+                "to the default profile.\n", uuid_or_name);
+    g_clear_error (&err);
+    profile = terminal_profiles_list_ref_profile_by_uuid (profiles_list, NULL, &err);
+  }
+
+  if (profile == NULL)
+    g_propagate_error (error, err);
+
+  return profile;
+}
+
+/* Applies the options for a newly created window */
+static void
+apply_window_options (TerminalWindow *window,
+                      GVariant *options)
+{
+  const char *startup_id, *role;
+  gboolean show_menubar, start_maximized, start_fullscreen;
+
+  if (g_variant_lookup (options, "desktop-startup-id", "^&ay", &startup_id))
+    gtk_window_set_startup_id (GTK_WINDOW (window), startup_id);
+
+  /* Overwrite the default, unique window role set in terminal_window_init */
+  if (g_variant_lookup (options, "role", "&s", &role))
+    gtk_window_set_role (GTK_WINDOW (window), role);
+
+  if (g_variant_lookup (options, "show-menubar", "b", &show_menubar))
+    terminal_window_set_menubar_visible (window, show_menubar);
+
+  if (g_variant_lookup (options, "fullscreen-window", "b", &start_fullscreen) &&
+      start_fullscreen) {
+    gtk_window_fullscreen (GTK_WINDOW (window));
+  }
+  if (g_variant_lookup (options, "maximize-window", "b", &start_maximized) &&
+      start_maximized) {
+    gtk_window_maximize (GTK_WINDOW (window));
+  }
+}
+
+static void
+apply_geometry_option (TerminalWindow *window,
+                       GVariant *options)
+{
+  const char *geometry;
+
+  if (g_variant_lookup (options, "geometry", "&s", &geometry) &&
+      !terminal_window_parse_geometry (window, geometry))
+    _terminal_debug_print (TERMINAL_DEBUG_GEOMETRY,
+                           "Invalid geometry string \"%s\"", geometry);
+}
+
+/* Exports a Receiver for @screen, and returns its object path */
+static char *
+export_screen (TerminalApp *app,
+               TerminalWindow *window,
+               TerminalScreen *screen)
+{
+  GDBusObjectManagerServer *object_manager;
+  TerminalReceiverImpl *impl;
+  TerminalObjectSkeleton *skeleton;
+  char *object_path;
+
+  object_path = get_object_path_for_screen (window, screen);
+  g_assert (g_variant_is_object_path (object_path));
+
+  skeleton = terminal_object_skeleton_new (object_path);
+  impl = terminal_receiver_impl_new (screen);
+  terminal_object_skeleton_set_receiver (skeleton, TERMINAL_RECEIVER (impl));
+  g_object_unref (impl);
+
+  object_manager = terminal_app_get_object_manager (app);
+  g_dbus_object_manager_server_export (object_manager, G_DBUS_OBJECT_SKELETON (skeleton));
+  g_object_set_data_full (G_OBJECT (screen), RECEIVER_IMPL_SKELETON_DATA_KEY,
+                          skeleton, (GDestroyNotify) g_object_unref);
+  g_signal_connect (screen, "destroy",
+                    G_CALLBACK (screen_destroy_cb), app);
+
+  return object_path;
+}
+
+static void
+restore_scrollback_option (TerminalScreen *screen,
+                           GVariant *options)
+{
+  const char *scrollback_file;
+  GFile *file;
+
+  if (!g_variant_lookup (options, "scrollback-file", "^&ay", &scrollback_file))
+    return;
+
+  file = g_file_new_for_path (scrollback_file);
+  terminal_screen_restore_scrollback (screen, file);
+  g_object_unref (file);
+}
+
+static gboolean
+terminal_factory_impl_create_instance (TerminalFactory *factory,
+                                       GDBusMethodInvocation *invocation,
+                                       GVariant *options);
+
+static gboolean
+terminal_factory_impl_restore_layout (TerminalFactory *factory,
+                                      GDBusMethodInvocation *invocation,
+                                      GVariant *options,
+                                      GVariant *windows);
+
+typedef struct {
+  TerminalFactory *factory;
+  GDBusMethodInvocation *invocation;
+  GVariant *options;
+  GVariant *windows; /* RestoreLayout only */
+} DeferredCreateInstance;
+
+static void
+deferred_create_instance_cb (TerminalApp *app,
+                             gpointer     user_data)
+{
+  DeferredCreateInstance *data = user_data;
+
+  if (data->windows != NULL) {
+    terminal_factory_impl_restore_layout (data->factory, data->invocation, data->options, data->windows);
+    g_variant_unref (data->windows);
+  } else
+    terminal_factory_impl_create_instance (data->factory, data->invocation, data->options);
+
+  g_object_unref (data->factory);
+  g_object_unref (data->invocation);
+  g_variant_unref (data->options);
+  g_slice_free (DeferredCreateInstance, data);
+}
+
+static void
+defer_until_migrated (TerminalApp *app,
+                      TerminalFactory *factory,
+                      GDBusMethodInvocation *invocation,
+                      GVariant *options,
+                      GVariant *windows)
+{
+  DeferredCreateInstance *data;
+
+  data = g_slice_new (DeferredCreateInstance);
+  data->factory = g_object_ref (factory);
+  data->invocation = g_object_ref (invocation);
+  data->options = g_variant_ref (options);
+  data->windows = windows ? g_variant_ref (windows) : NULL;
+  terminal_app_defer_until_migrated (app, deferred_create_instance_cb, data);
+}
+
 static gboolean
 terminal_factory_impl_create_instance (TerminalFactory *factory,
                                        GDBusMethodInvocation *invocation,
@@ -361,28 +579,37 @@ terminal_factory_impl_create_instance (TerminalFactory *factory,
 {
   TerminalApp *app = terminal_app_get ();
   TerminalSettingsList *profiles_list;
-  GDBusObjectManagerServer *object_manager;
   TerminalWindow *window;
-  TerminalScreen *screen;
-  TerminalReceiverImpl *impl;
-  TerminalObjectSkeleton *skeleton;
+  TerminalScreen *screen = NULL;
   char *object_path;
   GSettings *profile = NULL;
-  const char *profile_uuid;
   gboolean zoom_set = FALSE;
   gdouble zoom = 1.0;
   guint window_id;
-  gboolean show_menubar;
   gboolean active;
   gboolean have_new_window, present_window, present_window_set;
+  gint64 request_time;
+  gboolean pooled;
+  static gboolean first_instance = TRUE;
+  const char *span_name;
+  gint64 span;
   GError *err = NULL;
 
-  /* Look up the profile */
-  if (!g_variant_lookup (options, "profile", "&s", &profile_uuid))
-    profile_uuid = NULL;
+  /* The profiles may not exist yet while the settings are being migrated */
+  if (terminal_app_is_migrating_settings (app)) {
+    defer_until_migrated (app, factory, invocation, options, NULL);
+    return TRUE; /* handled */
+  }
 
+  span_name = first_instance ? "first window" : "CreateInstance";
+  span = _terminal_debug_span_begin (span_name);
+
+  request_time = g_get_monotonic_time ();
+  terminal_app_note_launch (app);
+
+  /* Look up the profile */
   profiles_list = terminal_app_get_profiles_list (app);
-  profile = terminal_profiles_list_ref_profile_by_uuid (profiles_list, profile_uuid, &err);
+  profile = ref_profile_for_options (profiles_list, options, &err);
   if (profile == NULL)
     {
       g_dbus_method_invocation_return_gerror (invocation, err);
@@ -390,12 +617,16 @@ terminal_factory_impl_create_instance (TerminalFactory *factory,
       goto out;
     }
 
+  if (g_variant_lookup (options, "zoom", "d", &zoom))
+    zoom_set = TRUE;
+
   if (g_variant_lookup (options, "window-id", "u", &window_id)) {
     GtkWindow *win;
 
     win = gtk_application_get_window_by_id (GTK_APPLICATION (app), window_id);
 
-    if (!TERMINAL_IS_WINDOW (win)) {
+    if (!TERMINAL_IS_WINDOW (win) ||
+        terminal_app_is_spare_window (app, win)) {
       g_dbus_method_invocation_return_error (invocation,
                                              G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
                                              "Nonexisting window %u referenced",
@@ -406,77 +637,52 @@ terminal_factory_impl_create_instance (TerminalFactory *factory,
     window = TERMINAL_WINDOW (win);
     have_new_window = FALSE;
   } else {
-    const char *startup_id, *display_name, *role;
-    gboolean start_maximized, start_fullscreen;
-    int screen_number;
     GdkScreen *gdk_screen;
 
     /* Create a new window */
 
-    if (!g_variant_lookup (options, "display", "^&ay", &display_name)) {
-      g_dbus_method_invocation_return_error_literal (invocation, 
-                                                     G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
-                                                     "No display specified");
-      goto out;
-    }
-
-    screen_number = 0;
-    gdk_screen = terminal_util_get_screen_by_display_name (display_name, screen_number);
+    gdk_screen = get_screen_for_options (options, &err);
     if (gdk_screen == NULL) {
-      g_dbus_method_invocation_return_error (invocation, 
-                                             G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
-                                             "No screen %d on display \"%s\"",
-                                             screen_number, display_name);
+      g_dbus_method_invocation_take_error (invocation, err);
       goto out;
     }
 
-    window = terminal_app_new_window (app, gdk_screen);
-
-    if (g_variant_lookup (options, "desktop-startup-id", "^&ay", &startup_id))
-      gtk_window_set_startup_id (GTK_WINDOW (window), startup_id);
-
-    /* Overwrite the default, unique window role set in terminal_window_init */
-    if (g_variant_lookup (options, "role", "&s", &role))
-      gtk_window_set_role (GTK_WINDOW (window), role);
+    window = terminal_app_take_spare_window (app, gdk_screen, profile,
+                                             zoom_set ? zoom : 1.0,
+                                             &screen);
+    if (window == NULL)
+      window = terminal_app_new_window (app, gdk_screen);
 
-    if (g_variant_lookup (options, "show-menubar", "b", &show_menubar))
-      terminal_window_set_menubar_visible (window, show_menubar);
-
-    if (g_variant_lookup (options, "fullscreen-window", "b", &start_fullscreen) &&
-        start_fullscreen) {
-      gtk_window_fullscreen (GTK_WINDOW (window));
-    }
-    if (g_variant_lookup (options, "maximize-window", "b", &start_maximized) &&
-        start_maximized) {
-      gtk_window_maximize (GTK_WINDOW (window));
-    }
+    apply_window_options (window, options);
 
     have_new_window = TRUE;
   }
 
   g_assert (window != NULL);
 
-  if (g_variant_lookup (options, "zoom", "d", &zoom))
-    zoom_set = TRUE;
-
-  screen = terminal_screen_new (profile, NULL, NULL, NULL,
-                                zoom_set ? zoom : 1.0);
-  terminal_window_add_screen (window, screen, -1);
-
-  object_path = get_object_path_for_screen (window, screen);
-  g_assert (g_variant_is_object_path (object_path));
+  if (screen == NULL) {
+    screen = terminal_screen_new (profile, NULL, NULL, NULL,
+                                  zoom_set ? zoom : 1.0);
+    terminal_window_add_screen (window, screen, -1);
+    pooled = FALSE;
+  } else
+    pooled = TRUE;
+
+  /* Reports the new-window-to-first-prompt latency, with and without
+   * the spare window pool; see terminal_app_take_spare_window().
+   */
+  _TERMINAL_DEBUG_IF (TERMINAL_DEBUG_PERF) {
+    _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                           "[screen %p] ready %.3f ms after the request (%s window)\n",
+                           screen,
+                           (g_get_monotonic_time () - request_time) / 1000.,
+                           pooled ? "spare" : "new");
+    _terminal_screen_track_first_output (screen, request_time, pooled);
+  }
 
-  skeleton = terminal_object_skeleton_new (object_path);
-  impl = terminal_receiver_impl_new (screen);
-  terminal_object_skeleton_set_receiver (skeleton, TERMINAL_RECEIVER (impl));
-  g_object_unref (impl);
+  object_path = export_screen (app, window, screen);
 
-  object_manager = terminal_app_get_object_manager (app);
-  g_dbus_object_manager_server_export (object_manager, G_DBUS_OBJECT_SKELETON (skeleton));
-  g_object_set_data_full (G_OBJECT (screen), RECEIVER_IMPL_SKELETON_DATA_KEY,
-                          skeleton, (GDestroyNotify) g_object_unref);
-  g_signal_connect (screen, "destroy",
-                    G_CALLBACK (screen_destroy_cb), app);
+  restore_scrollback_option (screen, options);
 
   if (g_variant_lookup (options, "active", "b", &active) &&
       active) {
@@ -489,26 +695,341 @@ terminal_factory_impl_create_instance (TerminalFactory *factory,
   else
     present_window_set = FALSE;
 
-  if (have_new_window) {
-    const char *geometry;
-
-    if (g_variant_lookup (options, "geometry", "&s", &geometry) &&
-        !terminal_window_parse_geometry (window, geometry))
-      _terminal_debug_print (TERMINAL_DEBUG_GEOMETRY,
-                             "Invalid geometry string \"%s\"", geometry);
-  }
+  if (have_new_window)
+    apply_geometry_option (window, options);
 
   if (have_new_window || (present_window_set && present_window))
     gtk_window_present (GTK_WINDOW (window));
 
   terminal_factory_complete_create_instance (factory, invocation, object_path);
 
+  first_instance = FALSE;
+
   g_free (object_path);
 
 out:
   if (profile)
     g_object_unref (profile);
 
+  _terminal_debug_span_end (span, span_name);
+
+  return TRUE; /* handled */
+}
+
+/* Restoring a layout
+ *
+ * RestoreLayout builds all windows and tabs of a layout in one pass, then
+ * launches the children from idles, the active tab of each window first,
+ * presenting each window as soon as its active tab's child is running.
+ * That way the first windows appear while the other children are still
+ * being launched, and no window is drawn more than once while being
+ * filled.
+ */
+
+typedef struct {
+  TerminalWindow *window;
+  TerminalScreen *screen;
+  GVariant *options; /* the tab's */
+  gboolean show_window; /* the window's active tab */
+  gboolean present_window;
+} LayoutTab;
+
+typedef struct {
+  GPtrArray *tabs; /* of LayoutTab, active ones first */
+  guint next;
+  char **envv;
+  gint64 start_time;
+} LayoutRestore;
+
+static void
+layout_tab_free (LayoutTab *tab)
+{
+  g_object_unref (tab->window);
+  g_object_unref (tab->screen);
+  g_variant_unref (tab->options);
+  g_slice_free (LayoutTab, tab);
+}
+
+static void
+layout_restore_free (LayoutRestore *restore)
+{
+  g_ptr_array_free (restore->tabs, TRUE);
+  g_strfreev (restore->envv);
+  g_slice_free (LayoutRestore, restore);
+}
+
+static void
+layout_tab_show_window (LayoutTab *tab)
+{
+  /* The window may have been closed in the meantime */
+  if (!tab->show_window ||
+      gtk_window_get_application (GTK_WINDOW (tab->window)) == NULL)
+    return;
+
+  /* Restored windows shouldn't demand attention; see bug #586308. */
+  if (tab->present_window)
+    gtk_window_present (GTK_WINDOW (tab->window));
+  else
+    gtk_widget_show (GTK_WIDGET (tab->window));
+}
+
+static void
+layout_restore_exec_done_cb (GObject *source_object,
+                             GAsyncResult *result,
+                             gpointer user_data)
+{
+  GError *error = NULL;
+
+  if (!terminal_screen_exec_finish (TERMINAL_SCREEN (source_object), result, &error)) {
+    /* The screen shows the error */
+    _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                           "Failed to launch the child of restored screen %p: %s\n",
+                           source_object, error->message);
+    g_error_free (error);
+  }
+}
+
+static gboolean
+layout_restore_launch_cb (LayoutRestore *restore)
+{
+  LayoutTab *tab;
+  const char *cwd;
+  char **argv;
+  gsize argc;
+  gboolean shell;
+
+  if (restore->next == restore->tabs->len) {
+    _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                           "Launched the %u children of the layout in %.3f ms\n",
+                           restore->tabs->len,
+                           (g_get_monotonic_time () - restore->start_time) / 1000.);
+    return FALSE; /* done */
+  }
+
+  tab = g_ptr_array_index (restore->tabs, restore->next++);
+
+  /* The tab may have been closed in the meantime, but its window is
+   * still waiting to be shown.
+   */
+  if (gtk_widget_get_parent (GTK_WIDGET (tab->screen)) == NULL) {
+    layout_tab_show_window (tab);
+    return TRUE; /* run again */
+  }
+
+  if (!g_variant_lookup (tab->options, "cwd", "^&ay", &cwd))
+    cwd = NULL;
+  if (!g_variant_lookup (tab->options, "shell", "b", &shell))
+    shell = FALSE;
+  if (!g_variant_lookup (tab->options, "arguments", "^a&ay", &argv))
+    argv = NULL;
+  argc = argv ? g_strv_length (argv) : 0;
+
+  terminal_screen_exec_async (tab->screen,
+                              argc > 0 ? argv : NULL,
+                              restore->envv,
+                              shell,
+                              cwd,
+                              NULL, NULL,
+                              layout_restore_exec_done_cb, NULL);
+  g_free (argv);
+
+  layout_tab_show_window (tab);
+
+  return TRUE; /* run again */
+}
+
+static gboolean
+terminal_factory_impl_restore_layout (TerminalFactory *factory,
+                                      GDBusMethodInvocation *invocation,
+                                      GVariant *options,
+                                      GVariant *windows)
+{
+  TerminalApp *app = terminal_app_get ();
+  TerminalSettingsList *profiles_list;
+  LayoutRestore *restore;
+  GPtrArray *inactive_tabs;
+  GVariantBuilder receivers, errors;
+  GVariantIter window_iter;
+  GVariant *window_options;
+  GdkScreen *gdk_screen;
+  const char *startup_id;
+  guint i;
+  gint64 span;
+  GError *err = NULL;
+
+  if (terminal_app_is_migrating_settings (app)) {
+    defer_until_migrated (app, factory, invocation, options, windows);
+    return TRUE; /* handled */
+  }
+
+  gdk_screen = get_screen_for_options (options, &err);
+  if (gdk_screen == NULL) {
+    g_dbus_method_invocation_take_error (invocation, err);
+    return TRUE; /* handled */
+  }
+
+  span = _terminal_debug_span_begin ("RestoreLayout");
+
+  terminal_app_note_launch (app);
+
+  restore = g_slice_new0 (LayoutRestore);
+  restore->tabs = g_ptr_array_new_with_free_func ((GDestroyNotify) layout_tab_free);
+  restore->start_time = g_get_monotonic_time ();
+  if (!g_variant_lookup (options, "environ", "^aay", &restore->envv))
+    restore->envv = NULL;
+  inactive_tabs = g_ptr_array_new ();
+
+  profiles_list = terminal_app_get_profiles_list (app);
+  g_variant_builder_init (&receivers, G_VARIANT_TYPE ("ao"));
+  g_variant_builder_init (&errors, G_VARIANT_TYPE ("as"));
+
+  /* The startup ID is for the first window only */
+  if (!g_variant_lookup (options, "desktop-startup-id", "^&ay", &startup_id))
+    startup_id = NULL;
+
+  /* First pass: build all windows and tabs */
+  g_variant_iter_init (&window_iter, windows);
+  while ((window_options = g_variant_iter_next_value (&window_iter)) != NULL) {
+    TerminalWindow *window;
+    TerminalScreen *active_screen;
+    GVariantIter tab_iter;
+    GVariant *tabs, *tab_options;
+    gboolean present_window;
+    guint first_tab = inactive_tabs->len;
+
+    window = terminal_app_new_window (app, gdk_screen);
+    apply_window_options (window, window_options);
+
+    if (!g_variant_lookup (window_options, "present-window", "b", &present_window))
+      present_window = TRUE;
+
+    if (!g_variant_lookup (window_options, "tabs", "@aa{sv}", &tabs))
+      tabs = g_variant_new ("aa{sv}", NULL);
+
+    g_variant_iter_init (&tab_iter, tabs);
+    while ((tab_options = g_variant_iter_next_value (&tab_iter)) != NULL) {
+      gs_unref_object GSettings *profile = NULL;
+      TerminalScreen *screen;
+      LayoutTab *tab;
+      char *object_path;
+      gboolean active;
+      gdouble zoom;
+
+      if (!g_variant_lookup (tab_options, "zoom", "d", &zoom))
+        zoom = 1.0;
+
+      profile = ref_profile_for_options (profiles_list, tab_options, &err);
+      if (profile == NULL) {
+        /* Skip this tab, but restore the rest */
+        g_variant_builder_add (&errors, "s", err->message);
+        g_clear_error (&err);
+        g_variant_unref (tab_options);
+        continue;
+      }
+
+      screen = terminal_screen_new (profile, NULL, NULL, NULL, zoom);
+      terminal_window_add_screen (window, screen, -1);
+      restore_scrollback_option (screen, tab_options);
+
+      if (g_variant_lookup (tab_options, "active", "b", &active) && active)
+        terminal_window_switch_screen (window, screen);
+
+      object_path = export_screen (app, window, screen);
+      g_variant_builder_add (&receivers, "o", object_path);
+      g_free (object_path);
+
+      tab = g_slice_new0 (LayoutTab);
+      tab->window = g_object_ref (window);
+      tab->screen = g_object_ref (screen);
+      tab->options = tab_options; /* adopts */
+      g_ptr_array_add (inactive_tabs, tab);
+    }
+    g_variant_unref (tabs);
+
+    if (inactive_tabs->len == first_tab) {
+      /* No tabs could be restored */
+      gtk_widget_destroy (GTK_WIDGET (window));
+      g_variant_unref (window_options);
+      continue;
+    }
+
+    if (startup_id != NULL) {
+      gtk_window_set_startup_id (GTK_WINDOW (window), startup_id);
+      startup_id = NULL;
+    }
+
+    apply_geometry_option (window, window_options);
+    g_variant_unref (window_options);
+
+    /* Move the window's active tab to the front of the launch queue */
+    active_screen = terminal_window_get_active (window);
+    for (i = first_tab; i < inactive_tabs->len; i++) {
+      LayoutTab *tab = g_ptr_array_index (inactive_tabs, i);
+
+      if (tab->screen != active_screen)
+        continue;
+
+      tab->show_window = TRUE;
+      tab->present_window = present_window;
+      gtk_widget_grab_focus (GTK_WIDGET (tab->screen));
+      g_ptr_array_add (restore->tabs, tab);
+      g_ptr_array_remove_index (inactive_tabs, i);
+      break;
+    }
+  }
+
+  for (i = 0; i < inactive_tabs->len; i++)
+    g_ptr_array_add (restore->tabs, g_ptr_array_index (inactive_tabs, i));
+  g_ptr_array_free (inactive_tabs, TRUE);
+
+  _terminal_debug_counter_add ("layout tabs restored", restore->tabs->len);
+
+  /* Second pass: launch the children */
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                   (GSourceFunc) layout_restore_launch_cb,
+                   restore,
+                   (GDestroyNotify) layout_restore_free);
+
+  terminal_factory_complete_restore_layout (factory, invocation,
+                                            g_variant_builder_end (&receivers),
+                                            g_variant_builder_end (&errors));
+
+  _terminal_debug_span_end (span, "RestoreLayout");
+
+  return TRUE; /* handled */
+}
+
+static void
+save_config_done_cb (GObject *source_object,
+                     GAsyncResult *result,
+                     gpointer user_data)
+{
+  GDBusMethodInvocation *invocation = user_data;
+  GError *error = NULL;
+
+  if (!terminal_app_save_config_finish (TERMINAL_APP (source_object), result, &error))
+    g_dbus_method_invocation_take_error (invocation, error);
+  else
+    g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static gboolean
+terminal_factory_impl_save_config (TerminalFactory *factory,
+                                   GDBusMethodInvocation *invocation,
+                                   const char *path)
+{
+  if (!g_path_is_absolute (path)) {
+    g_dbus_method_invocation_return_error (invocation,
+                                           G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                                           "Path \"%s\" is not absolute",
+                                           path);
+    return TRUE; /* handled */
+  }
+
+  /* The scrollback is written in the background, so reply once it's done */
+  terminal_app_save_config_async (terminal_app_get (), path, NULL,
+                                  save_config_done_cb, invocation);
+
   return TRUE; /* handled */
 }
 
@@ -516,6 +1037,8 @@ static void
 terminal_factory_impl_iface_init (TerminalFactoryIface *iface)
 {
   iface->handle_create_instance = terminal_factory_impl_create_instance;
+  iface->handle_restore_layout = terminal_factory_impl_restore_layout;
+  iface->handle_save_config = terminal_factory_impl_save_config;
 }
 
 G_DEFINE_TYPE_WITH_CODE (TerminalFactoryImpl, terminal_factory_impl, TERMINAL_TYPE_FACTORY_SKELETON,
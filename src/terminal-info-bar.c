@@ -27,6 +27,7 @@
 struct _TerminalInfoBarPrivate
 {
   GtkWidget *content_box;
+  GtkWidget *progress_bar;
 };
 
 G_DEFINE_TYPE (TerminalInfoBar, terminal_info_bar, GTK_TYPE_INFO_BAR)
@@ -116,3 +117,30 @@ terminal_info_bar_format_text (TerminalInfoBar *bar,
   gtk_box_pack_start (GTK_BOX (priv->content_box), label, FALSE, FALSE, 0);
   gtk_widget_show_all (priv->content_box);
 }
+
+/**
+ * terminal_info_bar_set_fraction:
+ * @bar: a #TerminalInfoBar
+ * @fraction: the fraction of the task that's been completed
+ *
+ * Shows a progress bar below the text, and sets it to @fraction.
+ */
+void
+terminal_info_bar_set_fraction (TerminalInfoBar *bar,
+                                double fraction)
+{
+  TerminalInfoBarPrivate *priv;
+
+  g_return_if_fail (TERMINAL_IS_INFO_BAR (bar));
+
+  priv = bar->priv;
+
+  if (priv->progress_bar == NULL) {
+    priv->progress_bar = gtk_progress_bar_new ();
+    gtk_box_pack_end (GTK_BOX (priv->content_box), priv->progress_bar, FALSE, FALSE, 0);
+    gtk_widget_show (priv->progress_bar);
+  }
+
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 CLAMP (fraction, 0.0, 1.0));
+}
@@ -0,0 +1,469 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* gnome-terminal-microbench: times the string helpers that run on every
+ * pointer motion, popup, drop and search request, over small corpora of
+ * what they see in practice, and prints the time and the number of heap
+ * allocations per call. It needs no display and no session bus.
+ */
+
+#include "config.h"
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "terminal-regex.h"
+#include "terminal-text-utils.h"
+#include "terminal-libgsystem.h"
+
+static int time_budget = 200;
+static int rounds = 5;
+static char *filter = NULL;
+
+static const GOptionEntry options[] = {
+  { "time", 't', 0, G_OPTION_ARG_INT, &time_budget,
+    "Minimum duration of each round, in milliseconds", "MS" },
+  { "rounds", 'n', 0, G_OPTION_ARG_INT, &rounds,
+    "Number of rounds for each benchmark", "N" },
+  { "filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+    "Only run the benchmarks whose name contains this string", "STRING" },
+  { NULL }
+};
+
+/* Allocation counting
+ *
+ * With glibc, interpose the allocator and count the calls that return new
+ * blocks. g_mem_set_vtable() would be the GLib way, but it has been a no-op
+ * since GLib 2.46.
+ */
+
+static guint64 n_allocations = 0;
+
+#ifdef __GLIBC__
+
+#define HAVE_ALLOCATION_COUNTS 1
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+void *
+malloc (size_t size)
+{
+  n_allocations++;
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb,
+        size_t size)
+{
+  n_allocations++;
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr,
+         size_t size)
+{
+  n_allocations++;
+  return __libc_realloc (ptr, size);
+}
+
+#endif /* __GLIBC__ */
+
+/* Corpora */
+
+/* What the number regex picks up from compiler output, hexdumps and
+ * ls -l, including some that are too large or too small to get info for.
+ */
+static const char * const numbers[] = {
+  "42",
+  "1024",
+  "4096",
+  "65536",
+  "1000000",
+  "123456789",
+  "2147483647",
+  "18446744073709551615",
+  "99999999999999999999999",
+  "0x10",
+  "0x7fffffff",
+  "0xDEADBEEF",
+  "0x00007f3a2c1e4000",
+  "0XFFFFFFFFFFFFFFFF",
+  "7",
+};
+
+/* Window titles, current directories, process names and command lines,
+ * as the search provider sees them.
+ */
+static const char * const search_strings[] = {
+  "user@workstation: ~/src/gnome-terminal",
+  "file:///home/user/src/gnome-terminal/src",
+  "vim terminal-screen.c",
+  "bash",
+  "make -j8 V=1",
+  "ssh build.example.org",
+  "htop",
+  "journalctl -f -u NetworkManager.service",
+  "file:///home/user/D%C3%A9veloppement/Projets",
+  "Résumé — cargo build --release",
+  "Ελληνικά: less README",
+  "日本語のファイル.txt - nano",
+  "git log --oneline --graph --decorate",
+  "python3 -m http.server 8000",
+};
+
+/* Lines of terminal output, as the URL and number regexes see them */
+static const char * const output_lines[] = {
+  "drwxr-xr-x.  5 user user   4096 Mar  2 10:14 Documents",
+  "-rw-r--r--.  1 user user 183742 Feb 27 18:03 terminal-screen.c",
+  "terminal-screen.c:2190:23: warning: unused variable 'i' [-Wunused-variable]",
+  "commit 3f9c2b1e8a7d6c5b4a3f2e1d0c9b8a7f6e5d4c3b",
+  "Author: Jane Doe <jane.doe@example.org>",
+  "Date:   Tue Mar 3 14:22:01 2015 +0100",
+  "    See https://bugzilla.gnome.org/show_bug.cgi?id=697024 for the details.",
+  "    Reviewed-by: John Smith <jsmith@lists.example.com>",
+  "Cloning into 'vte'... from git://git.gnome.org/vte",
+  "Downloading https://download.gnome.org/sources/gnome-terminal/3.18/gnome-terminal-3.18.0.tar.xz",
+  "Resolving www.example.com (www.example.com)... 93.184.216.34",
+  "Connecting to ftp.gnu.org:21... connected.",
+  "See man:bash(1) and info:coreutils for more information.",
+  "  Call sip:alice@voip.example.net or callto:bob@example.com",
+  "0000a0f0: 4c8b 0424 4889 c748 8b40 0848 85c0 7405  L..$H..H.@.H..t.",
+  "[  12.345678] usb 1-1.2: new high-speed USB device number 5 using ehci-pci",
+  "Mem:          15904        6213        1840         812        7850        8544",
+  "The quick brown fox jumps over the lazy dog, again and again and again.",
+  "",
+  "file:///home/user/Pictures/2015/IMG_0042.jpg",
+};
+
+typedef struct {
+  const char *pattern;
+  gboolean caseless;
+} RegexPattern;
+
+/* Keep in sync with url_regex_patterns in terminal-screen.c */
+static const RegexPattern url_patterns[] = {
+  { REGEX_URL_AS_IS, TRUE },
+  { REGEX_URL_HTTP, TRUE },
+  { REGEX_URL_VOIP, TRUE },
+  { REGEX_EMAIL, TRUE },
+  { REGEX_NEWS_MAN, TRUE },
+};
+
+/* Benchmarks */
+
+typedef struct {
+  const char *name;
+  /* Runs the benchmark once, and returns the number of operations */
+  guint (* run) (gpointer data);
+  gpointer data;
+} Benchmark;
+
+static guint
+run_number_info (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (numbers); i++)
+    g_free (terminal_util_number_info (numbers[i]));
+
+  return G_N_ELEMENTS (numbers);
+}
+
+static guint
+run_add_separators (gpointer data)
+{
+  static const char * const digits[] = {
+    "1", "12", "123", "1234", "65536", "4294967295", "18446744073709551615",
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (digits); i++) {
+    g_free (terminal_util_add_separators (digits[i], " ", 3));
+    g_free (terminal_util_add_separators (digits[i], "\xe2\x80\xaf", 4));
+  }
+
+  return 2 * G_N_ELEMENTS (digits);
+}
+
+static guint
+run_normalize (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (search_strings); i++)
+    g_free (terminal_util_normalize_casefold_and_unaccent (search_strings[i]));
+
+  return G_N_ELEMENTS (search_strings);
+}
+
+static guint
+run_match_terms (gpointer data)
+{
+  const char * const *terms = data;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (search_strings); i++)
+    terminal_util_match_terms (search_strings[i], terms);
+
+  return G_N_ELEMENTS (search_strings);
+}
+
+static guint
+run_concat_uris (gpointer data)
+{
+  char **uris = data;
+
+  g_free (terminal_util_concat_uris (uris, NULL));
+
+  return 1;
+}
+
+static guint
+run_url_regexes (gpointer data)
+{
+  GRegex **regexes = data;
+  guint i, j;
+
+  /* What terminal_screen_check_match() does for each line under the
+   * pointer: try each regex in turn, and take the first match.
+   */
+  for (i = 0; i < G_N_ELEMENTS (output_lines); i++) {
+    for (j = 0; j < G_N_ELEMENTS (url_patterns); j++) {
+      GMatchInfo *match_info;
+      gboolean found;
+
+      found = g_regex_match (regexes[j], output_lines[i], 0, &match_info);
+      if (found)
+        g_free (g_match_info_fetch (match_info, 0));
+      g_match_info_free (match_info);
+      if (found)
+        break;
+    }
+  }
+
+  return G_N_ELEMENTS (output_lines);
+}
+
+static guint
+run_number_regex (gpointer data)
+{
+  GRegex *regex = data;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (output_lines); i++) {
+    GMatchInfo *match_info;
+
+    if (g_regex_match (regex, output_lines[i], 0, &match_info))
+      g_free (g_match_info_fetch (match_info, 0));
+    g_match_info_free (match_info);
+  }
+
+  return G_N_ELEMENTS (output_lines);
+}
+
+static guint
+run_compile_url_regexes (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (url_patterns); i++) {
+    GRegex *regex;
+
+    regex = g_regex_new (url_patterns[i].pattern,
+                         G_REGEX_OPTIMIZE | G_REGEX_MULTILINE |
+                         (url_patterns[i].caseless ? G_REGEX_CASELESS : 0),
+                         0, NULL);
+    g_regex_unref (regex);
+  }
+
+  return G_N_ELEMENTS (url_patterns);
+}
+
+static GRegex *
+compile_regex (const char *pattern,
+               gboolean    caseless)
+{
+  GRegex *regex;
+  GError *error = NULL;
+
+  /* Same flags as precompile_regexes() in terminal-screen.c without PCRE2 */
+  regex = g_regex_new (pattern,
+                       G_REGEX_OPTIMIZE | G_REGEX_MULTILINE |
+                       (caseless ? G_REGEX_CASELESS : 0),
+                       0, &error);
+  g_assert_no_error (error);
+
+  return regex;
+}
+
+static char **
+make_uris (guint n)
+{
+  char **uris;
+  guint i;
+
+  uris = g_new (char *, n + 1);
+  for (i = 0; i < n; i++)
+    uris[i] = g_strdup_printf ("'/home/user/Pictures/2015/Holidays in the Alps/IMG_%04u.jpg'", i);
+  uris[n] = NULL;
+
+  return uris;
+}
+
+/* Statistics */
+
+static int
+compare_doubles (gconstpointer a,
+                 gconstpointer b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void
+run_benchmark (const Benchmark *benchmark)
+{
+  gs_unref_array GArray *samples = NULL;
+  gint64 budget, begin, elapsed;
+  guint64 ops, ops_per_run, allocations;
+  int round;
+
+  if (filter != NULL && strstr (benchmark->name, filter) == NULL)
+    return;
+
+  samples = g_array_sized_new (FALSE, FALSE, sizeof (double), rounds);
+  budget = (gint64) time_budget * 1000;
+
+  /* Warm up caches, and count the allocations of a single run */
+  benchmark->run (benchmark->data);
+  allocations = n_allocations;
+  ops_per_run = benchmark->run (benchmark->data);
+  allocations = n_allocations - allocations;
+
+  for (round = 0; round < rounds; round++) {
+    double ns_per_op;
+
+    ops = 0;
+    begin = g_get_monotonic_time ();
+    do {
+      ops += benchmark->run (benchmark->data);
+      elapsed = g_get_monotonic_time () - begin;
+    } while (elapsed < budget);
+
+    ns_per_op = (double) elapsed * 1000. / (double) ops;
+    g_array_append_val (samples, ns_per_op);
+  }
+
+  g_array_sort (samples, compare_doubles);
+
+  g_print ("%-32s %10.1f ns/op (min %10.1f)",
+           benchmark->name,
+           g_array_index (samples, double, samples->len / 2),
+           g_array_index (samples, double, 0));
+#ifdef HAVE_ALLOCATION_COUNTS
+  g_print (" %8.2f allocs/op", (double) allocations / (double) ops_per_run);
+#else
+  (void) allocations;
+  (void) ops_per_run;
+#endif
+  g_print ("\n");
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+  GOptionContext *context;
+  gs_strfreev char **terms = NULL;
+  gs_strfreev char **uris_1 = NULL;
+  gs_strfreev char **uris_10 = NULL;
+  gs_strfreev char **uris_100 = NULL;
+  GRegex *url_regexes[G_N_ELEMENTS (url_patterns)];
+  GRegex *number_regex;
+  GError *error = NULL;
+  guint i;
+
+  /* Like the server; terminal_util_number_info() uses the thousands separator */
+  setlocale (LC_ALL, "");
+
+  context = g_option_context_new ("");
+  g_option_context_set_summary (context,
+                                "Measures the time and the heap allocations per call of the "
+                                "string helpers on gnome-terminal's per-event paths.");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("Error parsing arguments: %s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (context);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (context);
+
+  if (time_budget < 1 || rounds < 1) {
+    g_printerr ("--time and --rounds must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  {
+    static const char * const raw_terms[] = { "Term", "SRC", NULL };
+
+    terms = terminal_util_normalize_casefold_and_unaccent_terms (raw_terms);
+  }
+
+  uris_1 = make_uris (1);
+  uris_10 = make_uris (10);
+  uris_100 = make_uris (100);
+
+  for (i = 0; i < G_N_ELEMENTS (url_patterns); i++)
+    url_regexes[i] = compile_regex (url_patterns[i].pattern, url_patterns[i].caseless);
+  number_regex = compile_regex (REGEX_NUMBER, FALSE);
+
+  {
+    const Benchmark benchmarks[] = {
+      { "number_info", run_number_info, NULL },
+      { "add_separators", run_add_separators, NULL },
+      { "normalize_casefold_and_unaccent", run_normalize, NULL },
+      { "match_terms", run_match_terms, terms },
+      { "concat_uris (1 uri)", run_concat_uris, uris_1 },
+      { "concat_uris (10 uris)", run_concat_uris, uris_10 },
+      { "concat_uris (100 uris)", run_concat_uris, uris_100 },
+      { "url regexes (per line)", run_url_regexes, url_regexes },
+      { "number regex (per line)", run_number_regex, number_regex },
+      { "compile url regexes", run_compile_url_regexes, NULL },
+    };
+
+#ifndef HAVE_ALLOCATION_COUNTS
+    g_print ("Allocation counts are only available with glibc\n");
+#endif
+
+    for (i = 0; i < G_N_ELEMENTS (benchmarks); i++)
+      run_benchmark (&benchmarks[i]);
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (url_patterns); i++)
+    g_regex_unref (url_regexes[i]);
+  g_regex_unref (number_regex);
+
+  return EXIT_SUCCESS;
+}
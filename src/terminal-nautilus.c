@@ -54,6 +54,13 @@ struct _TerminalNautilus {
 
         GSettings *lockdown_prefs;
         gboolean have_mc;
+
+        TerminalFactory *factory; /* cached across activations */
+
+        gboolean locked_down;
+        GVolumeMonitor *volume_monitor;
+        GQueue uri_cache; /* of UriCacheEntry, most recently used first */
+        char **mount_roots; /* root URIs of the current mounts, or NULL */
 };
 
 struct _TerminalNautilusClass {
@@ -295,8 +302,7 @@ mc_argv (int *argcp)
 static gboolean
 terminal_locked_down (TerminalNautilus *nautilus)
 {
-  return g_settings_get_boolean (nautilus->lockdown_prefs,
-                                 "disable-command-line");
+  return nautilus->locked_down;
 }
 
 /* used to determine for remote URIs whether GVFS is capable of mapping them to ~/.gvfs */
@@ -318,6 +324,136 @@ uri_has_local_path (const char *uri)
   return ret;
 }
 
+/* Classifying a URI may need a GVfs round trip (to find the FUSE path),
+ * so cache the result per mount; all URIs on the same mount classify
+ * the same way.
+ */
+
+#define URI_CACHE_SIZE (16)
+
+typedef struct {
+  char *key;
+  TerminalFileInfo info;
+  gboolean has_local_path;
+} UriCacheEntry;
+
+static void
+uri_cache_entry_free (UriCacheEntry *entry)
+{
+  g_free (entry->key);
+  g_slice_free (UriCacheEntry, entry);
+}
+
+static void
+uri_cache_clear (TerminalNautilus *nautilus)
+{
+  g_queue_foreach (&nautilus->uri_cache, (GFunc) uri_cache_entry_free, NULL);
+  g_queue_clear (&nautilus->uri_cache);
+
+  g_strfreev (nautilus->mount_roots);
+  nautilus->mount_roots = NULL;
+}
+
+static char **
+get_mount_roots (TerminalNautilus *nautilus)
+{
+  GList *mounts, *l;
+  GPtrArray *roots;
+
+  if (nautilus->mount_roots != NULL)
+    return nautilus->mount_roots;
+
+  roots = g_ptr_array_new ();
+  mounts = g_volume_monitor_get_mounts (nautilus->volume_monitor);
+  for (l = mounts; l != NULL; l = l->next) {
+    GFile *root;
+
+    root = g_mount_get_root (l->data);
+    g_ptr_array_add (roots, g_file_get_uri (root));
+    g_object_unref (root);
+  }
+  g_list_free_full (mounts, g_object_unref);
+  g_ptr_array_add (roots, NULL);
+
+  /* Cleared by mounts_changed_cb() */
+  nautilus->mount_roots = (char **) g_ptr_array_free (roots, FALSE);
+  return nautilus->mount_roots;
+}
+
+/* Returns the root URI of the mount @uri is on, or %NULL if it is on
+ * no known mount
+ */
+static char *
+get_uri_mount_key (TerminalNautilus *nautilus,
+                   const char *uri)
+{
+  char **roots;
+  const char *best = NULL;
+  gsize best_len = 0;
+  guint i;
+
+  roots = get_mount_roots (nautilus);
+  for (i = 0; roots[i] != NULL; i++) {
+    gsize len = strlen (roots[i]);
+
+    if (len <= best_len || strncmp (uri, roots[i], len) != 0)
+      continue;
+
+    /* Don't match smb://host/share against smb://host/shareB */
+    if (roots[i][len - 1] != '/' && uri[len] != '\0' && uri[len] != '/')
+      continue;
+
+    best = roots[i];
+    best_len = len;
+  }
+
+  return g_strdup (best);
+}
+
+static void
+classify_uri (TerminalNautilus *nautilus,
+              const char *uri,
+              TerminalFileInfo *info,
+              gboolean *has_local_path)
+{
+  UriCacheEntry *entry;
+  GList *l;
+  char *key;
+
+  key = get_uri_mount_key (nautilus, uri);
+  if (key == NULL) {
+    *info = get_terminal_file_info_from_uri (uri);
+    *has_local_path = uri_has_local_path (uri);
+    return;
+  }
+
+  for (l = nautilus->uri_cache.head; l != NULL; l = l->next) {
+    entry = l->data;
+    if (strcmp (entry->key, key) != 0)
+      continue;
+
+    g_queue_unlink (&nautilus->uri_cache, l);
+    g_queue_push_head_link (&nautilus->uri_cache, l);
+
+    *info = entry->info;
+    *has_local_path = entry->has_local_path;
+    g_free (key);
+    return;
+  }
+
+  entry = g_slice_new (UriCacheEntry);
+  entry->key = key; /* adopts */
+  entry->info = get_terminal_file_info_from_uri (uri);
+  entry->has_local_path = uri_has_local_path (uri);
+  g_queue_push_head (&nautilus->uri_cache, entry);
+
+  if (g_queue_get_length (&nautilus->uri_cache) > URI_CACHE_SIZE)
+    uri_cache_entry_free (g_queue_pop_tail (&nautilus->uri_cache));
+
+  *info = entry->info;
+  *has_local_path = entry->has_local_path;
+}
+
 /* Nautilus menu item class */
 
 typedef struct {
@@ -342,85 +478,47 @@ exec_data_free (ExecData *data)
   g_free (data);
 }
 
-/* FIXME: make this async */
-static gboolean
-create_terminal (ExecData *data /* transfer full */)
+static void
+exec_done_cb (GObject *source,
+              GAsyncResult *result,
+              gpointer user_data)
 {
-  TerminalFactory *factory;
-  TerminalReceiver *receiver;
+  ExecData *data = user_data;
   GError *error = NULL;
-  GVariantBuilder builder;
-  char *object_path;
-  char startup_id[32];
-  char **argv;
-  int argc;
 
-  factory = terminal_factory_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                     G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
-                                                     G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
-                                                     TERMINAL_APPLICATION_ID,
-                                                     TERMINAL_FACTORY_OBJECT_PATH,
-                                                     NULL /* cancellable */,
-                                                     &error);
-  if (factory == NULL) {
+  if (!terminal_receiver_call_exec_finish (TERMINAL_RECEIVER (source),
+                                           NULL /* out FD list */,
+                                           result,
+                                           &error)) {
     g_dbus_error_strip_remote_error (error);
-    g_printerr ("Error constructing proxy for %s:%s: %s\n",
-                TERMINAL_APPLICATION_ID, TERMINAL_FACTORY_OBJECT_PATH,
-                error->message);
+    g_printerr ("Error: %s\n", error->message);
     g_error_free (error);
-    exec_data_free (data);
-    return FALSE;
   }
 
-  g_snprintf (startup_id, sizeof (startup_id), "_TIME%u", data->timestamp);
-
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
-
-  terminal_client_append_create_instance_options (&builder,
-                                                  data->display,
-                                                  startup_id,
-                                                  NULL /* geometry */,
-                                                  NULL /* role */,
-                                                  NULL /* use default profile */,
-                                                  NULL /* title */,
-                                                  TRUE, /* active */
-                                                  FALSE /* maximised */,
-                                                  FALSE /* fullscreen */);
-
-  if (!terminal_factory_call_create_instance_sync
-         (factory,
-          g_variant_builder_end (&builder),
-          &object_path,
-          NULL /* cancellable */,
-          &error)) {
-    g_dbus_error_strip_remote_error (error);
-    g_printerr ("Error creating terminal: %s\n", error->message);
-    g_error_free (error);
-    g_object_unref (factory);
-    exec_data_free (data);
-    return FALSE;
-  }
+  exec_data_free (data);
+}
 
-  g_object_unref (factory);
+static void
+receiver_proxy_new_cb (GObject *source,
+                       GAsyncResult *result,
+                       gpointer user_data)
+{
+  ExecData *data = user_data;
+  TerminalReceiver *receiver;
+  GError *error = NULL;
+  GVariantBuilder builder;
+  char **argv;
+  int argc;
 
-  receiver = terminal_receiver_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                       G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
-                                                       G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
-                                                       TERMINAL_APPLICATION_ID,
-                                                       object_path,
-                                                       NULL /* cancellable */,
-                                                       &error);
+  receiver = terminal_receiver_proxy_new_for_bus_finish (result, &error);
   if (receiver == NULL) {
     g_dbus_error_strip_remote_error (error);
     g_printerr ("Failed to create proxy for terminal: %s\n", error->message);
     g_error_free (error);
-    g_free (object_path);
     exec_data_free (data);
-    return FALSE;
+    return;
   }
 
-  g_free (object_path);
-
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
 
   terminal_client_append_exec_options (&builder,
@@ -437,29 +535,131 @@ create_terminal (ExecData *data /* transfer full */)
     argv = NULL; argc = 0;
   }
 
-  if (!terminal_receiver_call_exec_sync (receiver,
+  terminal_receiver_call_exec (receiver,
+                               g_variant_builder_end (&builder),
+                               g_variant_new_bytestring_array ((const char * const *) argv, argc),
+                               NULL /* in FD list */,
+                               NULL /* cancellable */,
+                               exec_done_cb,
+                               data);
+
+  g_strfreev (argv);
+  g_object_unref (receiver);
+}
+
+static void
+create_instance_cb (GObject *source,
+                    GAsyncResult *result,
+                    gpointer user_data)
+{
+  ExecData *data = user_data;
+  GError *error = NULL;
+  char *object_path;
+
+  if (!terminal_factory_call_create_instance_finish (TERMINAL_FACTORY (source),
+                                                     &object_path,
+                                                     result,
+                                                     &error)) {
+    g_dbus_error_strip_remote_error (error);
+    g_printerr ("Error creating terminal: %s\n", error->message);
+    g_error_free (error);
+
+    /* Don't keep a possibly broken proxy around */
+    if (data->nautilus->factory == (TerminalFactory *) source)
+      g_clear_object (&data->nautilus->factory);
+
+    exec_data_free (data);
+    return;
+  }
+
+  terminal_receiver_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                                       G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                       G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                       TERMINAL_APPLICATION_ID,
+                                       object_path,
+                                       NULL /* cancellable */,
+                                       receiver_proxy_new_cb,
+                                       data);
+
+  g_free (object_path);
+}
+
+static void
+create_instance (ExecData *data)
+{
+  GVariantBuilder builder;
+  char startup_id[32];
+
+  g_snprintf (startup_id, sizeof (startup_id), "_TIME%u", data->timestamp);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+  terminal_client_append_create_instance_options (&builder,
+                                                  data->display,
+                                                  startup_id,
+                                                  NULL /* geometry */,
+                                                  NULL /* role */,
+                                                  NULL /* use default profile */,
+                                                  NULL /* title */,
+                                                  TRUE, /* active */
+                                                  FALSE /* maximised */,
+                                                  FALSE /* fullscreen */);
+
+  terminal_factory_call_create_instance (data->nautilus->factory,
                                          g_variant_builder_end (&builder),
-                                         g_variant_new_bytestring_array ((const char * const *) argv, argc),
-                                         NULL /* in FD list */,
-                                         NULL /* out FD list */,
                                          NULL /* cancellable */,
-                                         &error)) {
+                                         create_instance_cb,
+                                         data);
+}
+
+static void
+factory_proxy_new_cb (GObject *source,
+                      GAsyncResult *result,
+                      gpointer user_data)
+{
+  ExecData *data = user_data;
+  TerminalFactory *factory;
+  GError *error = NULL;
+
+  factory = terminal_factory_proxy_new_for_bus_finish (result, &error);
+  if (factory == NULL) {
     g_dbus_error_strip_remote_error (error);
-    g_printerr ("Error: %s\n", error->message);
+    g_printerr ("Error constructing proxy for %s:%s: %s\n",
+                TERMINAL_APPLICATION_ID, TERMINAL_FACTORY_OBJECT_PATH,
+                error->message);
     g_error_free (error);
-    g_strfreev (argv);
-    g_object_unref (receiver);
     exec_data_free (data);
-    return FALSE;
+    return;
   }
 
-  g_strfreev (argv);
+  /* Another activation may have raced us to it */
+  if (data->nautilus->factory == NULL)
+    data->nautilus->factory = factory;
+  else
+    g_object_unref (factory);
 
-  exec_data_free (data);
+  create_instance (data);
+}
 
-  g_object_unref (receiver);
+/* Creates the terminal asynchronously, so that the file manager isn't
+ * blocked while the terminal server is starting up.
+ */
+static void
+create_terminal (ExecData *data /* transfer full */)
+{
+  if (data->nautilus->factory != NULL) {
+    create_instance (data);
+    return;
+  }
 
-  return TRUE;
+  terminal_factory_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                                      G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                      G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                      TERMINAL_APPLICATION_ID,
+                                      TERMINAL_FACTORY_OBJECT_PATH,
+                                      NULL /* cancellable */,
+                                      factory_proxy_new_cb,
+                                      data);
 }
 
 static void
@@ -694,6 +894,7 @@ terminal_nautilus_get_background_items (NautilusMenuProvider *provider,
   GList *items;
   NautilusMenuItem *item;
   TerminalFileInfo terminal_file_info;
+  gboolean has_local_path;
 
   if (terminal_locked_down (nautilus))
     return NULL;
@@ -704,11 +905,11 @@ terminal_nautilus_get_background_items (NautilusMenuProvider *provider,
 
   items = NULL;
 
-  terminal_file_info = get_terminal_file_info_from_uri (uri);
+  classify_uri (nautilus, uri, &terminal_file_info, &has_local_path);
 
   if (terminal_file_info == FILE_INFO_SFTP ||
       terminal_file_info == FILE_INFO_DESKTOP ||
-      uri_has_local_path (uri)) {
+      has_local_path) {
     /* local locations or SSH */
     item = terminal_nautilus_menu_item_new (nautilus,
                                             file_info, 
@@ -722,7 +923,7 @@ terminal_nautilus_get_background_items (NautilusMenuProvider *provider,
 
   if ((terminal_file_info == FILE_INFO_SFTP ||
         terminal_file_info == FILE_INFO_OTHER) &&
-      uri_has_local_path (uri)) {
+      has_local_path) {
     /* remote locations that offer local back-mapping */
     item = terminal_nautilus_menu_item_new (nautilus,
                                             file_info, 
@@ -738,7 +939,7 @@ terminal_nautilus_get_background_items (NautilusMenuProvider *provider,
       nautilus->have_mc &&
       ((terminal_file_info == FILE_INFO_DESKTOP &&
        (desktop_is_home_dir (nautilus) || desktop_opens_home_dir (nautilus))) ||
-       uri_has_local_path (uri))) {
+       has_local_path)) {
     item = terminal_nautilus_menu_item_new (nautilus,
                                             file_info, 
                                             terminal_file_info, 
@@ -766,6 +967,7 @@ terminal_nautilus_get_file_items (NautilusMenuProvider *provider,
   NautilusFileInfo *file_info;
   GFileType file_type;
   TerminalFileInfo terminal_file_info;
+  gboolean has_local_path;
 
   if (terminal_locked_down (nautilus))
     return NULL;
@@ -787,14 +989,14 @@ terminal_nautilus_get_file_items (NautilusMenuProvider *provider,
 
   items = NULL;
 
-  terminal_file_info = get_terminal_file_info_from_uri (uri);
+  classify_uri (nautilus, uri, &terminal_file_info, &has_local_path);
 
   switch (terminal_file_info) {
     case FILE_INFO_LOCAL:
     case FILE_INFO_SFTP:
     case FILE_INFO_OTHER:
       if (terminal_file_info == FILE_INFO_SFTP || 
-          uri_has_local_path (uri)) {
+          has_local_path) {
         item = terminal_nautilus_menu_item_new (nautilus,
                                                 file_info,
                                                 terminal_file_info, 
@@ -806,7 +1008,7 @@ terminal_nautilus_get_file_items (NautilusMenuProvider *provider,
       }
 
       if (terminal_file_info == FILE_INFO_SFTP &&
-          uri_has_local_path (uri)) {
+          has_local_path) {
         item = terminal_nautilus_menu_item_new (nautilus,
                                                 file_info, 
                                                 terminal_file_info, 
@@ -819,7 +1021,7 @@ terminal_nautilus_get_file_items (NautilusMenuProvider *provider,
 
       if (display_mc_item (nautilus) &&
           nautilus->have_mc &&
-          uri_has_local_path (uri)) {
+          has_local_path) {
         item = terminal_nautilus_menu_item_new (nautilus,
                                                 file_info, 
                                                 terminal_file_info, 
@@ -854,12 +1056,40 @@ G_DEFINE_DYNAMIC_TYPE_EXTENDED (TerminalNautilus, terminal_nautilus, G_TYPE_OBJE
                                 G_IMPLEMENT_INTERFACE_DYNAMIC (NAUTILUS_TYPE_MENU_PROVIDER,
                                                                terminal_nautilus_menu_provider_iface_init))
 
+static void
+lockdown_prefs_changed_cb (GSettings *settings,
+                           const char *key,
+                           TerminalNautilus *nautilus)
+{
+  nautilus->locked_down = g_settings_get_boolean (settings, "disable-command-line");
+}
+
+static void
+mounts_changed_cb (GVolumeMonitor *monitor,
+                   GMount *mount,
+                   TerminalNautilus *nautilus)
+{
+  uri_cache_clear (nautilus);
+}
+
 static void 
 terminal_nautilus_init (TerminalNautilus *nautilus)
 {
   char *path;
 
   nautilus->lockdown_prefs = g_settings_new (GNOME_DESKTOP_LOCKDOWN_SETTINGS_SCHEMA);
+  g_signal_connect (nautilus->lockdown_prefs, "changed::disable-command-line",
+                    G_CALLBACK (lockdown_prefs_changed_cb), nautilus);
+  lockdown_prefs_changed_cb (nautilus->lockdown_prefs, "disable-command-line", nautilus);
+
+  g_queue_init (&nautilus->uri_cache);
+  nautilus->volume_monitor = g_volume_monitor_get ();
+  g_signal_connect (nautilus->volume_monitor, "mount-added",
+                    G_CALLBACK (mounts_changed_cb), nautilus);
+  g_signal_connect (nautilus->volume_monitor, "mount-changed",
+                    G_CALLBACK (mounts_changed_cb), nautilus);
+  g_signal_connect (nautilus->volume_monitor, "mount-removed",
+                    G_CALLBACK (mounts_changed_cb), nautilus);
 
   path = g_find_program_in_path ("mc");
   nautilus->have_mc = (path != NULL);
@@ -871,7 +1101,20 @@ terminal_nautilus_dispose (GObject *object)
 {
   TerminalNautilus *nautilus = TERMINAL_NAUTILUS (object);
 
+  if (nautilus->lockdown_prefs != NULL)
+    g_signal_handlers_disconnect_by_func (nautilus->lockdown_prefs,
+                                          G_CALLBACK (lockdown_prefs_changed_cb),
+                                          nautilus);
   g_clear_object (&nautilus->lockdown_prefs);
+  g_clear_object (&nautilus->factory);
+
+  if (nautilus->volume_monitor != NULL) {
+    g_signal_handlers_disconnect_by_func (nautilus->volume_monitor,
+                                          G_CALLBACK (mounts_changed_cb),
+                                          nautilus);
+    g_clear_object (&nautilus->volume_monitor);
+  }
+  uri_cache_clear (nautilus);
 
   G_OBJECT_CLASS (terminal_nautilus_parent_class)->dispose (object);
 }
@@ -45,6 +45,22 @@ terminal_options_ensure_profiles_list (TerminalOptions *options)
   return options->profiles_list;
 }
 
+/* Only UUIDs are resolved here. Anything else is passed on as a profile
+ * name and resolved by the server, which keeps an index of the names; a
+ * short-lived client would have to read every profile to find it.
+ */
+static char *
+terminal_options_dup_profile (TerminalOptions *options,
+                              const char *uuid_or_name,
+                              GError **error)
+{
+  if (uuid_or_name != NULL && !terminal_settings_list_valid_uuid (uuid_or_name))
+    return g_strdup (uuid_or_name);
+
+  return terminal_profiles_list_dup_uuid (terminal_options_ensure_profiles_list (options),
+                                          uuid_or_name, error);
+}
+
 static char *
 terminal_util_key_file_get_string_unescape (GKeyFile *key_file,
                                             const char *group,
@@ -97,9 +113,13 @@ initial_tab_new (char *profile /* adopts */)
   it->profile = profile;
   it->exec_argv = NULL;
   it->working_dir = NULL;
+  it->scrollback_file = NULL;
+  it->width = 0;
+  it->height = 0;
   it->zoom = 1.0;
   it->zoom_set = FALSE;
   it->active = FALSE;
+  it->profile_fallback = FALSE;
 
   return it;
 }
@@ -110,6 +130,7 @@ initial_tab_free (InitialTab *it)
   g_free (it->profile);
   g_strfreev (it->exec_argv);
   g_free (it->working_dir);
+  g_free (it->scrollback_file);
   g_slice_free (InitialTab, it);
 }
 
@@ -316,15 +337,13 @@ option_profile_cb (const gchar *option_name,
   TerminalOptions *options = data;
   char *profile;
 
-  profile = terminal_profiles_list_dup_uuid_or_name (terminal_options_ensure_profiles_list (options),
-                                                     value, error);
+  profile = terminal_options_dup_profile (options, value, error);
   if (profile == NULL)
   {
       g_printerr ("Profile '%s' specified but not found. Attempting to fall back "
                   "to the default profile.\n", value);
       g_clear_error (error);
-      profile = terminal_profiles_list_dup_uuid_or_name (terminal_options_ensure_profiles_list (options),
-                                                         NULL, error);
+      profile = terminal_options_dup_profile (options, NULL, error);
   }
 
   if (profile == NULL)
@@ -336,11 +355,13 @@ option_profile_cb (const gchar *option_name,
 
       g_free (it->profile);
       it->profile = profile;
+      it->profile_fallback = TRUE;
     }
   else
     {
       g_free (options->default_profile);
       options->default_profile = profile;
+      options->default_profile_fallback = TRUE;
     }
 
   return TRUE;
@@ -366,11 +387,13 @@ option_profile_id_cb (const gchar *option_name,
 
       g_free (it->profile);
       it->profile = profile;
+      it->profile_fallback = FALSE;
     }
   else
     {
       g_free (options->default_profile);
       options->default_profile = profile;
+      options->default_profile_fallback = FALSE;
     }
 
   return TRUE;
@@ -384,24 +407,26 @@ option_window_callback (const gchar *option_name,
                         GError     **error)
 {
   TerminalOptions *options = data;
+  InitialWindow *iw;
+  InitialTab *it;
   char *profile;
 
-  profile = terminal_profiles_list_dup_uuid_or_name (terminal_options_ensure_profiles_list (options),
-                                                     value, error);
+  profile = terminal_options_dup_profile (options, value, error);
 
   if (value && profile == NULL)
   {
       g_printerr ("Profile '%s' specified but not found. Attempting to fall back "
                   "to the default profile.\n", value);
       g_clear_error (error);
-      profile = terminal_profiles_list_dup_uuid_or_name (terminal_options_ensure_profiles_list (options),
-                                                         NULL, error);
+      profile = terminal_options_dup_profile (options, NULL, error);
   }
 
   if (profile == NULL)
     return FALSE;
 
-  add_new_window (options, profile /* adopts */);
+  iw = add_new_window (options, profile /* adopts */);
+  it = iw->tabs->data;
+  it->profile_fallback = TRUE;
 
   return TRUE;
 }
@@ -415,8 +440,7 @@ option_tab_callback (const gchar *option_name,
   TerminalOptions *options = data;
   char *profile;
 
-  profile = terminal_profiles_list_dup_uuid_or_name (terminal_options_ensure_profiles_list (options),
-                                                     value, error);
+  profile = terminal_options_dup_profile (options, value, error);
   if (profile == NULL)
     return FALSE;
 
@@ -613,9 +637,30 @@ option_load_config_cb (const gchar *option_name,
   g_key_file_free (key_file);
   g_free (config_file);
 
+  if (result)
+    options->loaded_config = TRUE;
+
   return result;
 }
 
+static gboolean
+option_save_config_cb (const gchar *option_name,
+                       const gchar *value,
+                       gpointer     data,
+                       GError     **error)
+{
+  TerminalOptions *options = data;
+  GFile *file;
+
+  /* The server writes the file, so it needs an absolute path */
+  file = g_file_new_for_commandline_arg (value);
+  g_free (options->save_config_file);
+  options->save_config_file = g_file_get_path (file);
+  g_object_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 option_working_directory_callback (const gchar *option_name,
                                    const gchar *value,
@@ -745,6 +790,52 @@ digest_options_callback (GOptionContext *context,
   return TRUE;
 }
 
+/* Returns whether any of the arguments needs the GTK+ option group,
+ * which initialises GDK and opens the display while parsing.
+ *
+ * Arguments meant for the child are not ours: scanning stops at the
+ * command separator, and the value of -e/--command is skipped.
+ */
+static gboolean
+need_gtk_option_group (int argc,
+                       char **argv)
+{
+  static const char *const prefixes[] = {
+    "--display",
+    "--class",
+    "--name",
+    "--gtk-",
+    "--gdk-",
+    "--g-fatal-warnings",
+    "--help",
+    "-h",
+    "-?",
+  };
+  int i;
+  guint j;
+
+  for (i = 1; i < argc; ++i)
+    {
+      if (strcmp (argv[i], "--") == 0 ||
+          strcmp (argv[i], "-x") == 0 ||
+          strcmp (argv[i], "--execute") == 0)
+        break;
+
+      if (strcmp (argv[i], "-e") == 0 ||
+          strcmp (argv[i], "--command") == 0)
+        {
+          ++i;
+          continue;
+        }
+
+      for (j = 0; j < G_N_ELEMENTS (prefixes); ++j)
+        if (g_str_has_prefix (argv[i], prefixes[j]))
+          return TRUE;
+    }
+
+  return FALSE;
+}
+
 /**
  * terminal_options_parse:
  * @working_directory: the default working directory
@@ -825,6 +916,11 @@ terminal_options_parse (const char *working_directory,
       break;
     }
 
+  /* Only initialise GDK while parsing if we have to; otherwise the
+   * caller can determine the display from the environment.
+   */
+  options->gdk_initialized = need_gtk_option_group (*argcp, *argvp);
+
   context = get_goption_context (options);
   retval = g_option_context_parse (context, argcp, argvp, error);
   g_option_context_free (context);
@@ -926,9 +1022,21 @@ terminal_options_merge_config (TerminalOptions *options,
           if (g_strcmp0 (active_terminal, tab_group) == 0)
             it->active = TRUE;
 
-/*          it->width = g_key_file_get_integer (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_WIDTH, NULL);
-          it->height = g_key_file_get_integer (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_HEIGHT, NULL);*/
+          it->width = g_key_file_get_integer (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_WIDTH, NULL);
+          it->height = g_key_file_get_integer (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_HEIGHT, NULL);
+          if (g_key_file_has_key (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_ZOOM, NULL))
+            {
+              it->zoom = g_key_file_get_double (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_ZOOM, NULL);
+              it->zoom_set = it->zoom > 0.0;
+            }
           it->working_dir = terminal_util_key_file_get_string_unescape (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_WORKING_DIRECTORY, NULL);
+          it->scrollback_file = terminal_util_key_file_get_string_unescape (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_SCROLLBACK, NULL);
+
+          /* All tabs of a window have the same size; the window is sized
+           * to fit its active tab.
+           */
+          if (iw->geometry == NULL && it->active && it->width > 0 && it->height > 0)
+            iw->geometry = g_strdup_printf ("%dx%d", it->width, it->height);
 
           if (g_key_file_has_key (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_COMMAND, NULL) &&
               !(it->exec_argv = terminal_util_key_file_get_argv (key_file, tab_group, TERMINAL_CONFIG_TERMINAL_PROP_COMMAND, NULL, error)))
@@ -996,6 +1104,7 @@ terminal_options_free (TerminalOptions *options)
 
   g_free (options->sm_client_id);
   g_free (options->sm_config_prefix);
+  g_free (options->save_config_file);
 
   g_clear_object (&options->profiles_list);
 
@@ -1036,10 +1145,11 @@ get_goption_context (TerminalOptions *options)
     {
       "save-config",
       0,
-      G_OPTION_FLAG_FILENAME | G_OPTION_FLAG_HIDDEN,
+      G_OPTION_FLAG_FILENAME,
       G_OPTION_ARG_CALLBACK,
-      unsupported_option_callback,
-      NULL, NULL
+      option_save_config_cb,
+      N_("Save the open windows and terminals, including their scrollback, to a terminal configuration file"),
+      N_("FILE")
     },
     { "version", 0, G_OPTION_FLAG_NO_ARG | G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_CALLBACK, option_version_cb, NULL, NULL },
     { NULL, 0, 0, 0, NULL, NULL, NULL }
@@ -1268,7 +1378,8 @@ get_goption_context (TerminalOptions *options)
   g_option_context_set_description (context, N_("GNOME Terminal Emulator"));
   g_option_context_set_ignore_unknown_options (context, FALSE);
 
-  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (options->gdk_initialized)
+    g_option_context_add_group (context, gtk_get_option_group (TRUE));
 
   group = g_option_group_new ("gnome-terminal",
                               N_("GNOME Terminal Emulator"),
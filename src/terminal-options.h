@@ -28,7 +28,7 @@
 
 G_BEGIN_DECLS
 
-#define TERMINAL_CONFIG_VERSION             (1) /* Bump this for any changes */
+#define TERMINAL_CONFIG_VERSION             (2) /* Bump this for any changes */
 #define TERMINAL_CONFIG_COMPAT_VERSION      (1) /* Bump this for incompatible changes */
 
 #define TERMINAL_CONFIG_GROUP               "GNOME Terminal Configuration"
@@ -47,6 +47,7 @@ G_BEGIN_DECLS
 #define TERMINAL_CONFIG_TERMINAL_PROP_HEIGHT             "Height"
 #define TERMINAL_CONFIG_TERMINAL_PROP_COMMAND            "Command"
 #define TERMINAL_CONFIG_TERMINAL_PROP_PROFILE_ID         "ProfileID"
+#define TERMINAL_CONFIG_TERMINAL_PROP_SCROLLBACK         "Scrollback"
 #define TERMINAL_CONFIG_TERMINAL_PROP_TITLE              "Title"
 #define TERMINAL_CONFIG_TERMINAL_PROP_WIDTH              "Width"
 #define TERMINAL_CONFIG_TERMINAL_PROP_WORKING_DIRECTORY  "WorkingDirectory"
@@ -67,6 +68,7 @@ typedef struct
   char    *startup_id;
   char    *display_name;
   int      screen_number;
+  gboolean gdk_initialized;
   GList   *initial_windows;
   gboolean default_window_menubar_forced;
   gboolean default_window_menubar_state;
@@ -78,6 +80,7 @@ typedef struct
   char   **exec_argv;
   char    *default_profile;
   gboolean default_profile_is_id;
+  gboolean default_profile_fallback;
 
   gboolean  execute;
   double    zoom;
@@ -86,6 +89,9 @@ typedef struct
   char *sm_client_id;
   char *sm_config_prefix;
 
+  char *save_config_file;
+  gboolean loaded_config;
+
   guint zoom_set : 1;
 } TerminalOptions;
 
@@ -95,9 +101,13 @@ typedef struct
   gboolean profile_is_id;
   char **exec_argv;
   char *working_dir;
+  char *scrollback_file;
+  int width;
+  int height;
   double zoom;
   guint zoom_set : 1;
   guint active : 1;
+  guint profile_fallback : 1;
 } InitialTab;
 
 typedef struct
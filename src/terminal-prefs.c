@@ -177,27 +177,6 @@ profile_combo_box_ref_selected (GtkComboBox *combo)
   return profile;
 }
 
-static void
-profile_combo_box_refill (PrefData *data)
-{
-  GtkComboBox *combo = GTK_COMBO_BOX (data->profiles_default_combo);
-  GtkTreeIter iter;
-  gboolean iter_set;
-  gs_unref_object GSettings *selected_profile;
-  gs_unref_object GtkTreeModel *model;
-
-  selected_profile = profile_combo_box_ref_selected (combo);
-
-  model = profile_liststore_new (data,
-                                 selected_profile,
-                                 &iter,
-                                 &iter_set);
-  gtk_combo_box_set_model (combo, model);
-
-  if (iter_set)
-    gtk_combo_box_set_active_iter (combo, &iter);
-}
-
 static GtkWidget*
 profile_combo_box_new (PrefData *data)
 {
@@ -288,6 +267,82 @@ profile_list_treeview_refill (PrefData *data)
     gtk_tree_selection_select_iter (gtk_tree_view_get_selection (tree_view), &iter);
 }
 
+static gboolean
+strv_has (char **strv,
+          const char *str)
+{
+  for ( ; *strv; strv++)
+    if (g_str_equal (*strv, str))
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+profile_liststore_update (PrefData *data,
+                          GtkListStore *store,
+                          char **added,
+                          char **removed)
+{
+  GtkTreeModel *model = GTK_TREE_MODEL (store);
+  GtkTreeIter iter;
+  gboolean valid;
+  guint i;
+
+  if (removed[0] != NULL) {
+    valid = gtk_tree_model_get_iter_first (model, &iter);
+    while (valid) {
+      gs_unref_object GSettings *profile;
+      gs_free char *uuid;
+
+      gtk_tree_model_get (model, &iter, (int) COL_PROFILE, &profile, (int) -1);
+      uuid = terminal_settings_list_dup_uuid_from_child (data->profiles_list, profile);
+
+      if (uuid != NULL && strv_has (removed, uuid))
+        valid = gtk_list_store_remove (store, &iter);
+      else
+        valid = gtk_tree_model_iter_next (model, &iter);
+    }
+  }
+
+  /* The store is sorted, so the new rows end up in the right place */
+  for (i = 0; added[i] != NULL; i++) {
+    gs_unref_object GSettings *profile;
+
+    profile = terminal_settings_list_ref_child (data->profiles_list, added[i]);
+    if (profile == NULL)
+      continue;
+
+    gtk_list_store_insert_with_values (store, NULL, 0,
+                                       (int) COL_PROFILE, profile,
+                                       (int) -1);
+  }
+}
+
+static void
+profile_list_children_changed_cb (TerminalSettingsList *list,
+                                  char **added,
+                                  char **removed,
+                                  PrefData *data)
+{
+  GtkTreeSelection *selection;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+
+  profile_liststore_update (data,
+                            GTK_LIST_STORE (gtk_tree_view_get_model (data->manage_profiles_list)),
+                            added, removed);
+  profile_liststore_update (data,
+                            GTK_LIST_STORE (gtk_combo_box_get_model (GTK_COMBO_BOX (data->profiles_default_combo))),
+                            added, removed);
+
+  /* If the selected profile went away, select the first one instead */
+  selection = gtk_tree_view_get_selection (data->manage_profiles_list);
+  if (!gtk_tree_selection_get_selected (selection, &model, &iter) &&
+      gtk_tree_model_get_iter_first (model, &iter))
+    gtk_tree_selection_select_iter (selection, &iter);
+}
+
 static void
 profile_list_row_activated_cb (GtkTreeView *tree_view,
                                GtkTreePath *path,
@@ -540,8 +595,7 @@ prefs_dialog_destroy_cb (GtkWidget *widget,
 {
   TerminalApp *app = terminal_app_get ();
 
-  g_signal_handlers_disconnect_by_func (data->profiles_list, G_CALLBACK (profile_combo_box_refill), data);
-  g_signal_handlers_disconnect_by_func (data->profiles_list, G_CALLBACK (profile_list_treeview_refill), data);
+  g_signal_handlers_disconnect_by_func (data->profiles_list, G_CALLBACK (profile_list_children_changed_cb), data);
 
   g_signal_handlers_disconnect_by_func (app, G_CALLBACK (encodings_list_changed_cb), data);
 
@@ -664,8 +718,6 @@ terminal_prefs_show_preferences (GtkWindow *transient_parent,
   g_signal_connect (selection, "changed", G_CALLBACK (profile_list_selection_changed_cb), data);
 
   profile_list_treeview_refill (data);
-  g_signal_connect_swapped (data->profiles_list, "children-changed",
-                            G_CALLBACK (profile_list_treeview_refill), data);
 
   gtk_container_add (GTK_CONTAINER (tree_view_container), GTK_WIDGET (data->manage_profiles_list));
   gtk_widget_show (GTK_WIDGET (data->manage_profiles_list));
@@ -684,8 +736,8 @@ terminal_prefs_show_preferences (GtkWindow *transient_parent,
                     data);
 
   data->profiles_default_combo = profile_combo_box_new (data);
-  g_signal_connect_swapped (data->profiles_list, "children-changed",
-                            G_CALLBACK (profile_combo_box_refill), data);
+  g_signal_connect (data->profiles_list, "children-changed",
+                    G_CALLBACK (profile_list_children_changed_cb), data);
   g_signal_connect (data->profiles_default_combo, "changed",
                     G_CALLBACK (profile_combo_box_changed_cb), data);
 
@@ -28,29 +28,6 @@
 #include <string.h>
 #include <uuid.h>
 
-/* Counts occurrences of @str in @strv */
-static guint
-strv_contains (char **strv,
-               const char *str,
-               guint *idx)
-{
-  guint n, i;
-
-  if (strv == NULL)
-    return 0;
-
-  n = 0;
-  for (i = 0; strv[i]; i++) {
-    if (strcmp (strv[i], str) == 0) {
-      n++;
-      if (idx)
-        *idx = i;
-    }
-  }
-
-  return n;
-}
-
 static gboolean
 valid_uuid (const char *str,
             GError **error)
@@ -77,26 +54,230 @@ terminal_profiles_list_new (void)
                                      TERMINAL_SETTINGS_LIST_FLAG_HAS_DEFAULT);
 }
 
+/* Name index
+ *
+ * Resolving a profile by name used to read every profile's visible name from
+ * GSettings. Instead, keep a map from name to the profiles using that name,
+ * built on first use and kept up to date from the profiles' change
+ * notifications and the list's "children-changed" signal.
+ *
+ * The index also keeps the profiles sorted by the collation key of their
+ * name, so the menus don't need to read and collate every name on each
+ * rebuild.
+ *
+ * Building the index costs more than a single scan, so only the server,
+ * which keeps it alive, resolves names; clients send names as they are.
+ */
+
+#define PROFILE_NAME_INDEX_DATA_KEY "terminal-profiles-list-name-index"
+#define PROFILE_NAME_ENTRY_DATA_KEY "terminal-profiles-list-name-entry"
+
+typedef struct _ProfileNameIndex ProfileNameIndex;
+
+typedef struct {
+  ProfileNameIndex *index;
+  char *uuid;
+  char *name;
+  char *collate_key;
+  GSettings *profile;
+  GSequenceIter *sorted_iter;
+} ProfileNameEntry;
+
+struct _ProfileNameIndex {
+  TerminalSettingsList *list; /* unowned */
+  GHashTable *entries; /* UUID -> ProfileNameEntry */
+  GHashTable *names;   /* name -> GSList of ProfileNameEntry */
+  GSequence *sorted;   /* ProfileNameEntry, by collate_key then UUID */
+};
+
+static int
+profile_name_entry_compare (gconstpointer pa,
+                            gconstpointer pb,
+                            gpointer user_data)
+{
+  const ProfileNameEntry *a = pa;
+  const ProfileNameEntry *b = pb;
+  int result;
+
+  result = strcmp (a->collate_key, b->collate_key);
+  if (result != 0)
+    return result;
+
+  /* Same order as comparing the paths, see terminal_profiles_compare() */
+  return strcmp (a->uuid, b->uuid);
+}
+
 static void
-get_profile_names (TerminalSettingsList *list,
-                   char ***profilesp,
-                   char ***namesp)
+profile_name_entry_set_name (ProfileNameEntry *entry,
+                             char *name /* adopted */)
 {
-  char **profiles, **names;
-  guint i, n;
+  g_free (entry->name);
+  g_free (entry->collate_key);
+  entry->name = name;
+  entry->collate_key = g_utf8_collate_key (name, -1);
+}
 
-  *profilesp = profiles = terminal_settings_list_dupv_children (list);
+static void
+profile_name_index_link (ProfileNameIndex *index,
+                         ProfileNameEntry *entry)
+{
+  GSList *l;
 
-  n = g_strv_length (profiles);
-  *namesp = names = g_new0 (char *, n + 1);
-  for (i = 0; i < n; i++) {
-    gs_unref_object GSettings *profile;
+  l = g_hash_table_lookup (index->names, entry->name);
+  l = g_slist_prepend (l, entry);
+  g_hash_table_insert (index->names, g_strdup (entry->name), l);
+}
 
-    profile = terminal_settings_list_ref_child (list, profiles[i]);
-    names[i] = g_settings_get_string (profile, TERMINAL_PROFILE_VISIBLE_NAME_KEY);
-  }
+static void
+profile_name_index_unlink (ProfileNameIndex *index,
+                           ProfileNameEntry *entry)
+{
+  GSList *l;
+
+  l = g_hash_table_lookup (index->names, entry->name);
+  l = g_slist_remove (l, entry);
+  if (l == NULL)
+    g_hash_table_remove (index->names, entry->name);
+  else
+    g_hash_table_insert (index->names, g_strdup (entry->name), l);
+}
 
-  names[n] = NULL;
+static void
+profile_name_entry_visible_name_changed_cb (GSettings *profile,
+                                            const char *key,
+                                            ProfileNameEntry *entry)
+{
+  profile_name_index_unlink (entry->index, entry);
+  profile_name_entry_set_name (entry, g_settings_get_string (profile, TERMINAL_PROFILE_VISIBLE_NAME_KEY));
+  profile_name_index_link (entry->index, entry);
+
+  g_sequence_sort_changed (entry->sorted_iter, profile_name_entry_compare, NULL);
+}
+
+static void
+profile_name_entry_free (ProfileNameEntry *entry)
+{
+  g_signal_handlers_disconnect_by_func (entry->profile,
+                                        G_CALLBACK (profile_name_entry_visible_name_changed_cb),
+                                        entry);
+  g_object_set_data (G_OBJECT (entry->profile), PROFILE_NAME_ENTRY_DATA_KEY, NULL);
+  g_object_unref (entry->profile);
+  g_free (entry->uuid);
+  g_free (entry->name);
+  g_free (entry->collate_key);
+  g_slice_free (ProfileNameEntry, entry);
+}
+
+static void
+profile_name_index_add (ProfileNameIndex *index,
+                        const char *uuid)
+{
+  ProfileNameEntry *entry;
+  GSettings *profile;
+
+  if (g_hash_table_lookup (index->entries, uuid) != NULL)
+    return;
+
+  profile = terminal_settings_list_ref_child (index->list, uuid);
+  if (profile == NULL)
+    return;
+
+  entry = g_slice_new0 (ProfileNameEntry);
+  entry->index = index;
+  entry->uuid = g_strdup (uuid);
+  entry->profile = profile; /* adopted */
+  profile_name_entry_set_name (entry, g_settings_get_string (profile, TERMINAL_PROFILE_VISIBLE_NAME_KEY));
+
+  g_signal_connect (profile, "changed::" TERMINAL_PROFILE_VISIBLE_NAME_KEY,
+                    G_CALLBACK (profile_name_entry_visible_name_changed_cb), entry);
+  g_object_set_data (G_OBJECT (profile), PROFILE_NAME_ENTRY_DATA_KEY, entry);
+
+  g_hash_table_insert (index->entries, entry->uuid, entry);
+  profile_name_index_link (index, entry);
+  entry->sorted_iter = g_sequence_insert_sorted (index->sorted, entry,
+                                                 profile_name_entry_compare, NULL);
+}
+
+static void
+profile_name_index_remove (ProfileNameIndex *index,
+                           const char *uuid)
+{
+  ProfileNameEntry *entry;
+
+  entry = g_hash_table_lookup (index->entries, uuid);
+  if (entry == NULL)
+    return;
+
+  profile_name_index_unlink (index, entry);
+  g_sequence_remove (entry->sorted_iter);
+  g_hash_table_remove (index->entries, uuid);
+}
+
+static void
+profile_name_index_children_changed_cb (TerminalSettingsList *list,
+                                        char **added,
+                                        char **removed,
+                                        ProfileNameIndex *index)
+{
+  guint i;
+
+  for (i = 0; removed[i] != NULL; i++)
+    profile_name_index_remove (index, removed[i]);
+  for (i = 0; added[i] != NULL; i++)
+    profile_name_index_add (index, added[i]);
+}
+
+static void
+profile_name_index_free (ProfileNameIndex *index)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_signal_handlers_disconnect_by_func (index->list,
+                                        G_CALLBACK (profile_name_index_children_changed_cb),
+                                        index);
+
+  g_hash_table_iter_init (&iter, index->names);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_slist_free (value);
+  g_hash_table_unref (index->names);
+  g_sequence_free (index->sorted);
+  g_hash_table_unref (index->entries);
+
+  g_slice_free (ProfileNameIndex, index);
+}
+
+static ProfileNameIndex *
+profile_name_index_ensure (TerminalSettingsList *list)
+{
+  ProfileNameIndex *index;
+  gs_strfreev char **uuids = NULL;
+  guint i;
+
+  index = g_object_get_data (G_OBJECT (list), PROFILE_NAME_INDEX_DATA_KEY);
+  if (index != NULL)
+    return index;
+
+  index = g_slice_new (ProfileNameIndex);
+  index->list = list;
+  index->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          NULL /* owned by the entry */,
+                                          (GDestroyNotify) profile_name_entry_free);
+  index->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        (GDestroyNotify) g_free,
+                                        NULL);
+  index->sorted = g_sequence_new (NULL);
+
+  uuids = terminal_settings_list_dupv_children (list);
+  for (i = 0; uuids != NULL && uuids[i] != NULL; i++)
+    profile_name_index_add (index, uuids[i]);
+
+  g_signal_connect (list, "children-changed",
+                    G_CALLBACK (profile_name_index_children_changed_cb), index);
+  g_object_set_data_full (G_OBJECT (list), PROFILE_NAME_INDEX_DATA_KEY,
+                          index, (GDestroyNotify) profile_name_index_free);
+
+  return index;
 }
 
 /**
@@ -108,8 +289,23 @@ get_profile_names (TerminalSettingsList *list,
 GList *
 terminal_profiles_list_ref_children_sorted (TerminalSettingsList *list)
 {
-  return g_list_sort (terminal_settings_list_ref_children (list),
-                      terminal_profiles_compare);
+  ProfileNameIndex *index;
+  GSequenceIter *iter;
+  GList *l;
+
+  index = profile_name_index_ensure (list);
+
+  l = NULL;
+  iter = g_sequence_get_end_iter (index->sorted);
+  while (!g_sequence_iter_is_begin (iter)) {
+    ProfileNameEntry *entry;
+
+    iter = g_sequence_iter_prev (iter);
+    entry = g_sequence_get (iter);
+    l = g_list_prepend (l, g_object_ref (entry->profile));
+  }
+
+  return l;
 }
 
 /**
@@ -182,34 +378,36 @@ terminal_profiles_list_dup_uuid_or_name (TerminalSettingsList *list,
                                          const char *uuid_or_name,
                                          GError **error)
 {
-  char **profiles, **profile_names;
+  ProfileNameIndex *index;
+  GSList *l;
   char *rv;
-  guint n, i;
 
   rv = terminal_profiles_list_dup_uuid (list, uuid_or_name, NULL);
   if (rv != NULL)
     return rv;
 
+  if (uuid_or_name == NULL) {
+    g_set_error_literal (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                         "No default profile exists");
+    return NULL;
+  }
+
   /* Not found as UUID; try finding a profile with this string as 'visible-name' */
-  get_profile_names (list, &profiles, &profile_names);
-  n = strv_contains (profile_names, uuid_or_name, &i);
+  index = profile_name_index_ensure (list);
+  l = g_hash_table_lookup (index->names, uuid_or_name);
 
-  if (n == 0) {
+  if (l == NULL) {
     g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
                  "No profile with UUID or name \"%s\" exists", uuid_or_name);
-    rv = NULL;
-  } else if (n != 1) {
+    return NULL;
+  }
+  if (l->next != NULL) {
     g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
                  "No profile with UUID \"%s\" found and name is ambiguous", uuid_or_name);
-    rv = NULL;
-  } else {
-    rv = g_strdup (profiles[i]);
+    return NULL;
   }
 
-  g_strfreev (profiles);
-  g_strfreev (profile_names);
-
-  return rv;
+  return g_strdup (((ProfileNameEntry *) l->data)->uuid);
 }
 
 /**
@@ -243,6 +441,7 @@ terminal_profiles_compare (gconstpointer pa,
 {
   GSettings *a = (GSettings *) pa;
   GSettings *b = (GSettings *) pb;
+  ProfileNameEntry *ea, *eb;
   gs_free char *na = NULL;
   gs_free char *nb = NULL;
   gs_free char *patha = NULL;
@@ -256,6 +455,12 @@ terminal_profiles_compare (gconstpointer pa,
   if (pb == NULL)
     return -1;
 
+  /* Use the cached collation keys when both profiles are in a name index */
+  ea = g_object_get_data (G_OBJECT (a), PROFILE_NAME_ENTRY_DATA_KEY);
+  eb = g_object_get_data (G_OBJECT (b), PROFILE_NAME_ENTRY_DATA_KEY);
+  if (ea != NULL && eb != NULL)
+    return profile_name_entry_compare (ea, eb, NULL);
+
   na = g_settings_get_string (a, TERMINAL_PROFILE_VISIBLE_NAME_KEY);
   nb = g_settings_get_string (b, TERMINAL_PROFILE_VISIBLE_NAME_KEY);
   result =  g_utf8_collate (na, nb);
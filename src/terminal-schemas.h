@@ -73,8 +73,13 @@ G_BEGIN_DECLS
 #define TERMINAL_SETTING_ENABLE_SHORTCUTS_KEY           "shortcuts-enabled"
 #define TERMINAL_SETTING_ENCODINGS_KEY                  "encodings"
 #define TERMINAL_SETTING_NEW_TERMINAL_MODE_KEY          "new-terminal-mode"
+#define TERMINAL_SETTING_PTY_POOL_SIZE_KEY              "pty-pool-size"
 #define TERMINAL_SETTING_SCHEMA_VERSION                 "schema-version"
+#define TERMINAL_SETTING_SCROLLBACK_BUDGET_KEY          "scrollback-budget"
+#define TERMINAL_SETTING_SCROLLBACK_BUDGET_FLOOR_KEY    "scrollback-budget-floor"
+#define TERMINAL_SETTING_SERVER_KEEP_ALIVE_MAX_KEY      "server-keep-alive-max"
 #define TERMINAL_SETTING_SHELL_INTEGRATION_KEY          "shell-integration-enabled"
+#define TERMINAL_SETTING_SPARE_WINDOW_POOL_SIZE_KEY     "spare-window-pool-size"
 #define TERMINAL_SETTING_TAB_POLICY_KEY                 "tab-policy"
 #define TERMINAL_SETTING_TAB_POSITION_KEY               "tab-position"
 #define TERMINAL_SETTING_THEME_VARIANT_KEY              "theme-variant"
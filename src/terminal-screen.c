@@ -54,6 +54,8 @@
 #include "terminal-enums.h"
 #include "terminal-intl.h"
 #include "terminal-marshal.h"
+#include "terminal-options.h"
+#include "terminal-regex.h"
 #include "terminal-schemas.h"
 #include "terminal-screen-container.h"
 #include "terminal-util.h"
@@ -92,6 +94,13 @@ struct _TerminalScreenPrivate
   int child_pid;
   GSList *match_tags;
   guint launch_child_source_id;
+  VtePty *spare_pty; /* opened in advance, not yet used by any child */
+  gint64 request_time;
+  gboolean request_pooled;
+  gint64 last_viewed_time;
+  GCancellable *restore_cancellable; /* non-NULL while restoring the scrollback */
+  GInputStream *restore_stream;
+  GTask *exec_task; /* launch the child once the scrollback is restored */
 };
 
 enum
@@ -165,18 +174,6 @@ static void terminal_screen_set_override_command (TerminalScreen  *screen,
 
 static guint signals[LAST_SIGNAL];
 
-#define USERCHARS "-[:alnum:]"
-#define USERCHARS_CLASS "[" USERCHARS "]"
-#define PASSCHARS_CLASS "[-[:alnum:]\\Q,?;.:/!%$^*&~\"#'\\E]"
-#define HOSTCHARS_CLASS "[-[:alnum:]]"
-#define HOST HOSTCHARS_CLASS "+(\\." HOSTCHARS_CLASS "+)*"
-#define PORT "(?:\\:[[:digit:]]{1,5})?"
-#define PATHCHARS_CLASS "[-[:alnum:]\\Q_$.+!*,:;@&=?/~#%\\E]"
-#define PATHTERM_CLASS "[^\\Q]'.:}>) \t\r\n,\"\\E]"
-#define SCHEME "(?:news:|telnet:|nntp:|file:\\/|https?:|ftps?:|sftp:|webcal:)"
-#define USERPASS USERCHARS_CLASS "+(?:" PASSCHARS_CLASS "+)?"
-#define URLPATH   "(?:(/"PATHCHARS_CLASS"+(?:[(]"PATHCHARS_CLASS"*[)])*"PATHCHARS_CLASS"*)*"PATHTERM_CLASS")?"
-
 typedef struct {
   const char *pattern;
   TerminalURLFlavor flavor;
@@ -184,15 +181,15 @@ typedef struct {
 } TerminalRegexPattern;
 
 static const TerminalRegexPattern url_regex_patterns[] = {
-  { SCHEME "//(?:" USERPASS "\\@)?" HOST PORT URLPATH, FLAVOR_AS_IS, TRUE },
-  { "(?:www|ftp)" HOSTCHARS_CLASS "*\\." HOST PORT URLPATH , FLAVOR_DEFAULT_TO_HTTP, TRUE  },
-  { "(?:callto:|h323:|sip:)" USERCHARS_CLASS "[" USERCHARS ".]*(?:" PORT "/[a-z0-9]+)?\\@" HOST, FLAVOR_VOIP_CALL, TRUE },
-  { "(?:mailto:)?" USERCHARS_CLASS "[" USERCHARS ".]*\\@" HOSTCHARS_CLASS "+\\." HOST, FLAVOR_EMAIL, TRUE },
-  { "(?:news:|man:|info:)[-[:alnum:]\\Q^_{|}~!\"#$%&'()*+,./;:=?`\\E]+", FLAVOR_AS_IS, TRUE },
+  { REGEX_URL_AS_IS, FLAVOR_AS_IS, TRUE },
+  { REGEX_URL_HTTP, FLAVOR_DEFAULT_TO_HTTP, TRUE },
+  { REGEX_URL_VOIP, FLAVOR_VOIP_CALL, TRUE },
+  { REGEX_EMAIL, FLAVOR_EMAIL, TRUE },
+  { REGEX_NEWS_MAN, FLAVOR_AS_IS, TRUE },
 };
 
 static const TerminalRegexPattern extra_regex_patterns[] = {
-  { "(0[Xx][[:xdigit:]]+|[[:digit:]]+)", FLAVOR_NUMBER, FALSE },
+  { REGEX_NUMBER, FLAVOR_NUMBER, FALSE },
 };
 
 #ifdef WITH_PCRE2
@@ -279,6 +276,45 @@ precompile_regexes (const TerminalRegexPattern *regex_patterns,
     }
 }
 
+static void
+free_regexes (guint n_regexes,
+#ifdef WITH_PCRE2
+              VteRegex ***regexes,
+#else
+              GRegex ***regexes,
+#endif
+              TerminalURLFlavor **regex_flavors)
+{
+  guint i;
+
+  if (*regexes == NULL)
+    return;
+
+  for (i = 0; i < n_regexes; ++i)
+#ifdef WITH_PCRE2
+    vte_regex_unref ((*regexes)[i]);
+#else
+    g_regex_unref ((*regexes)[i]);
+#endif
+
+  g_free (*regexes);
+  *regexes = NULL;
+  g_free (*regex_flavors);
+  *regex_flavors = NULL;
+}
+
+static void
+ensure_regexes (void)
+{
+  if (url_regexes != NULL)
+    return;
+
+  n_url_regexes = G_N_ELEMENTS (url_regex_patterns);
+  precompile_regexes (url_regex_patterns, n_url_regexes, &url_regexes, &url_regex_flavors);
+  n_extra_regexes = G_N_ELEMENTS (extra_regex_patterns);
+  precompile_regexes (extra_regex_patterns, n_extra_regexes, &extra_regexes, &extra_regex_flavors);
+}
+
 static void
 terminal_screen_class_enable_menu_bar_accel_notify_cb (GSettings *settings,
                                                        const char *key,
@@ -326,6 +362,26 @@ terminal_screen_realize (GtkWidget *widget)
   terminal_screen_set_font (screen);
 }
 
+static void
+terminal_screen_map (GtkWidget *widget)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (widget);
+
+  GTK_WIDGET_CLASS (terminal_screen_parent_class)->map (widget);
+
+  screen->priv->last_viewed_time = g_get_monotonic_time ();
+}
+
+static void
+terminal_screen_unmap (GtkWidget *widget)
+{
+  TerminalScreen *screen = TERMINAL_SCREEN (widget);
+
+  screen->priv->last_viewed_time = g_get_monotonic_time ();
+
+  GTK_WIDGET_CLASS (terminal_screen_parent_class)->unmap (widget);
+}
+
 static void
 terminal_screen_update_style (TerminalScreen *screen)
 {
@@ -392,6 +448,9 @@ terminal_screen_init (TerminalScreen *screen)
   vte_terminal_set_mouse_autohide (terminal, TRUE);
 
   priv->child_pid = -1;
+  priv->last_viewed_time = g_get_monotonic_time ();
+
+  ensure_regexes ();
 
   for (i = 0; i < n_url_regexes; ++i)
     {
@@ -519,6 +578,8 @@ terminal_screen_class_init (TerminalScreenClass *klass)
   object_class->set_property = terminal_screen_set_property;
 
   widget_class->realize = terminal_screen_realize;
+  widget_class->map = terminal_screen_map;
+  widget_class->unmap = terminal_screen_unmap;
   widget_class->style_updated = terminal_screen_style_updated;
   widget_class->drag_data_received = terminal_screen_drag_data_received;
   widget_class->button_press_event = terminal_screen_button_press;
@@ -604,10 +665,7 @@ terminal_screen_class_init (TerminalScreenClass *klass)
 
   g_type_class_add_private (object_class, sizeof (TerminalScreenPrivate));
 
-  n_url_regexes = G_N_ELEMENTS (url_regex_patterns);
-  precompile_regexes (url_regex_patterns, n_url_regexes, &url_regexes, &url_regex_flavors);
-  n_extra_regexes = G_N_ELEMENTS (extra_regex_patterns);
-  precompile_regexes (extra_regex_patterns, n_extra_regexes, &extra_regexes, &extra_regex_flavors);
+  ensure_regexes ();
 
   /* This fixes bug #329827 */
   settings = terminal_app_get_global_settings (terminal_app_get ());
@@ -646,6 +704,11 @@ terminal_screen_dispose (GObject *object)
       priv->launch_child_source_id = 0;
     }
 
+  g_clear_object (&priv->spare_pty);
+
+  if (priv->restore_cancellable != NULL)
+    g_cancellable_cancel (priv->restore_cancellable);
+
   G_OBJECT_CLASS (terminal_screen_parent_class)->dispose (object);
 }
 
@@ -713,23 +776,48 @@ terminal_screen_new (GSettings       *profile,
   return screen;
 }
 
-gboolean 
-terminal_screen_exec (TerminalScreen *screen,
-                      char          **argv,
-                      char          **envv,
-                      gboolean        shell,
-                      const char     *cwd,
-                      GUnixFDList    *fd_list,
-                      GVariant       *fd_array,
-                      GError        **error)
+/**
+ * terminal_screen_exec_async:
+ * @screen: a #TerminalScreen
+ * @argv: (allow-none): the command to run, or %NULL for the profile's
+ * @envv: (allow-none): the environment for the child
+ * @shell: whether to run @argv through the user's shell
+ * @cwd: (allow-none): the working directory for the child
+ * @fd_list: (allow-none): FDs to pass to the child
+ * @fd_array: (allow-none): where in the child to put the FDs of @fd_list
+ * @callback: called once the child process has been launched, or failed to
+ * @user_data: data for @callback
+ *
+ * Launches the child process of @screen. While the scrollback is being
+ * restored, this waits until that is done, so that the restored text
+ * stays above the child's output.
+ */
+void
+terminal_screen_exec_async (TerminalScreen     *screen,
+                            char              **argv,
+                            char              **envv,
+                            gboolean            shell,
+                            const char         *cwd,
+                            GUnixFDList        *fd_list,
+                            GVariant           *fd_array,
+                            GAsyncReadyCallback callback,
+                            gpointer            user_data)
 {
   TerminalScreenPrivate *priv;
+  gs_unref_object GTask *task = NULL;
   FDSetupData *data;
+  GError *error = NULL;
 
-  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), FALSE);
-  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
 
   priv = screen->priv;
+  task = g_task_new (screen, NULL, callback, user_data);
+
+  if (priv->exec_task != NULL) {
+    g_task_return_new_error (task, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                             "Cannot launch a new child process while the terminal is still waiting to launch another child process");
+    return;
+  }
 
   terminal_screen_set_initial_environment (screen, envv);
   terminal_screen_set_override_command (screen, argv, shell);
@@ -747,7 +835,40 @@ terminal_screen_exec (TerminalScreen *screen,
   } else
     data = NULL;
 
-  return terminal_screen_do_exec (screen, data, error);
+  /* Keep the restored scrollback above the new child's output. We cannot
+   * hold on to passed FDs, so those are launched right away.
+   */
+  if (priv->restore_cancellable != NULL && data == NULL) {
+    _terminal_debug_print (TERMINAL_DEBUG_PROCESSES,
+                           "[screen %p] deferring launching the child process until the scrollback is restored\n",
+                           screen);
+    priv->exec_task = g_object_ref (task);
+    return;
+  }
+
+  if (terminal_screen_do_exec (screen, data, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+}
+
+/**
+ * terminal_screen_exec_finish:
+ * @screen: a #TerminalScreen
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError to fill in
+ *
+ * Returns: %TRUE if the child process was launched, or %FALSE with @error
+ *   filled in
+ */
+gboolean
+terminal_screen_exec_finish (TerminalScreen *screen,
+                             GAsyncResult   *result,
+                             GError        **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, screen), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 const char*
@@ -777,6 +898,9 @@ terminal_screen_profile_changed_cb (GSettings     *profile,
   GObject *object = G_OBJECT (screen);
   VteTerminal *vte_terminal = VTE_TERMINAL (screen);
   TerminalWindow *window;
+  gint64 span;
+
+  span = _terminal_debug_span_begin ("terminal_screen_profile_changed_cb");
 
   g_object_freeze_notify (object);
 
@@ -879,6 +1003,8 @@ terminal_screen_profile_changed_cb (GSettings     *profile,
     }
 
   g_object_thaw_notify (object);
+
+  _terminal_debug_span_end (span, "terminal_screen_profile_changed_cb");
 }
 
 static void
@@ -1141,6 +1267,9 @@ get_child_command (TerminalScreen *screen,
   return TRUE;
 }
 
+/* What VTE sets TERM to; it doesn't export it */
+#define TERMINAL_DEFAULT_TERM "xterm-256color"
+
 static char**
 get_child_environment (TerminalScreen *screen,
                        const char *cwd,
@@ -1196,6 +1325,17 @@ get_child_environment (TerminalScreen *screen,
    */
   g_hash_table_replace (env_table, g_strdup ("PWD"), g_strdup (cwd));
 
+  /* VTE sets these up for the PTYs it opens itself, but not for our spare
+   * ones; set them here, so that the child gets the same environment
+   * whether or not it's launched on a spare PTY.
+   */
+  g_hash_table_replace (env_table, g_strdup ("TERM"), g_strdup (TERMINAL_DEFAULT_TERM));
+  g_hash_table_replace (env_table, g_strdup ("VTE_VERSION"),
+                        g_strdup_printf ("%u",
+                                         vte_get_major_version () * 10000 +
+                                         vte_get_minor_version () * 100 +
+                                         vte_get_micro_version ()));
+
   terminal_util_add_proxy_env (env_table);
 
   retval = g_ptr_array_sized_new (g_hash_table_size (env_table));
@@ -1326,6 +1466,87 @@ terminal_screen_child_setup (FDSetupData *data)
   }
 }
 
+typedef struct {
+  VtePty *pty;
+  FDSetupData *data;
+} SparePtySetupData;
+
+static void
+spare_pty_child_setup (SparePtySetupData *setup)
+{
+  vte_pty_child_setup (setup->pty);
+
+  if (setup->data != NULL)
+    terminal_screen_child_setup (setup->data);
+}
+
+static VtePtyFlags
+spare_pty_get_flags (VtePty *pty)
+{
+  VtePtyFlags flags;
+
+  g_object_get (pty, "flags", &flags, NULL);
+  return flags;
+}
+
+/*
+ * spawn_with_spare_pty:
+ *
+ * Like vte_terminal_spawn_sync(), but uses a PTY that was opened in
+ * advance, by _terminal_screen_prepare_pty() or from the #TerminalApp
+ * PTY pool, instead of opening a new one.
+ * The spare PTY is consumed whether or not spawning succeeds, since a
+ * PTY must never be handed to a second child.
+ *
+ * The VTE we build against has no way to spawn on an existing #VtePty.
+ * The environment VTE would add is already in @env, from
+ * get_child_environment(), and the spare PTY must have been opened with
+ * @pty_flags. This is only used when the PTY pool or the spare windows
+ * are enabled, both of which are off by default.
+ */
+static gboolean
+spawn_with_spare_pty (TerminalScreen *screen,
+                      VtePtyFlags     pty_flags,
+                      const char     *working_dir,
+                      char          **argv,
+                      char          **env,
+                      GSpawnFlags     spawn_flags,
+                      FDSetupData    *data,
+                      GPid           *pid,
+                      GError        **error)
+{
+  TerminalScreenPrivate *priv = screen->priv;
+  VteTerminal *terminal = VTE_TERMINAL (screen);
+  SparePtySetupData setup;
+  gs_unref_object VtePty *pty = NULL;
+
+  pty = priv->spare_pty;
+  priv->spare_pty = NULL;
+
+  g_assert (spare_pty_get_flags (pty) == pty_flags);
+
+  /* Attach the PTY first so the child starts out with the right size */
+  vte_terminal_set_pty (terminal, pty);
+
+  setup.pty = pty;
+  setup.data = data;
+  if (!g_spawn_async (working_dir, argv, env,
+                      (spawn_flags & ~VTE_SPAWN_NO_PARENT_ENVV) | G_SPAWN_DO_NOT_REAP_CHILD,
+                      (GSpawnChildSetupFunc) spare_pty_child_setup, &setup,
+                      pid, error)) {
+    vte_terminal_set_pty (terminal, NULL);
+    return FALSE;
+  }
+
+  vte_terminal_watch_child (terminal, *pid);
+
+  _terminal_debug_print (TERMINAL_DEBUG_PROCESSES,
+                         "[screen %p] launched the child process on a spare PTY\n",
+                         screen);
+
+  return TRUE;
+}
+
 static gboolean
 terminal_screen_do_exec (TerminalScreen *screen,
                          FDSetupData    *data /* adopting */,
@@ -1343,6 +1564,7 @@ terminal_screen_do_exec (TerminalScreen *screen,
                             VTE_SPAWN_NO_PARENT_ENVV;
   GPid pid;
   gboolean result = FALSE;
+  gint64 span;
 
   if (priv->child_pid != -1) {
     g_set_error_literal (error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
@@ -1350,6 +1572,8 @@ terminal_screen_do_exec (TerminalScreen *screen,
     return FALSE;
   }
 
+  span = _terminal_debug_span_begin ("terminal_screen_do_exec");
+
   priv->launch_child_source_id = 0;
 
   _terminal_debug_print (TERMINAL_DEBUG_PROCESSES,
@@ -1366,19 +1590,37 @@ terminal_screen_do_exec (TerminalScreen *screen,
 
   env = get_child_environment (screen, working_dir, &shell);
 
+  /* Use an already open PTY when there is one */
+  if (priv->spare_pty == NULL)
+    priv->spare_pty = terminal_app_take_pty (terminal_app_get ());
+  /* ... unless VTE would open this child's PTY differently */
+  if (priv->spare_pty != NULL &&
+      spare_pty_get_flags (priv->spare_pty) != pty_flags)
+    g_clear_object (&priv->spare_pty);
+
   argv = NULL;
   if (!get_child_command (screen, shell, &spawn_flags, &argv, &err) ||
-      !vte_terminal_spawn_sync (terminal,
-                                pty_flags,
-                                working_dir,
-                                argv,
-                                env,
-                                spawn_flags,
-                                (GSpawnChildSetupFunc) (data ? terminal_screen_child_setup : NULL), 
-                                data,
-                                &pid,
-                                NULL /* cancellable */,
-                                &err)) {
+      !(priv->spare_pty != NULL ?
+        spawn_with_spare_pty (screen,
+                              pty_flags,
+                              working_dir,
+                              argv,
+                              env,
+                              spawn_flags,
+                              data,
+                              &pid,
+                              &err) :
+        vte_terminal_spawn_sync (terminal,
+                                 pty_flags,
+                                 working_dir,
+                                 argv,
+                                 env,
+                                 spawn_flags,
+                                 (GSpawnChildSetupFunc) (data ? terminal_screen_child_setup : NULL),
+                                 data,
+                                 &pid,
+                                 NULL /* cancellable */,
+                                 &err))) {
     GtkWidget *info_bar;
 
     info_bar = terminal_info_bar_new (GTK_MESSAGE_ERROR,
@@ -1404,6 +1646,7 @@ terminal_screen_do_exec (TerminalScreen *screen,
   }
 
   priv->child_pid = pid;
+  _terminal_debug_counter_add ("children spawned", 1);
 
   result = TRUE;
 
@@ -1413,6 +1656,7 @@ out:
   g_strfreev (env);
   free_fd_setup_data (data);
 
+  _terminal_debug_span_end (span, "terminal_screen_do_exec");
   return result;
 }
 
@@ -1438,6 +1682,925 @@ _terminal_screen_launch_child_on_idle (TerminalScreen *screen)
   priv->launch_child_source_id = g_idle_add ((GSourceFunc) terminal_screen_launch_child_cb, screen);
 }
 
+/**
+ * _terminal_screen_prepare_pty:
+ * @screen: a #TerminalScreen
+ *
+ * Opens a PTY in advance for @screen, so that launching its child
+ * process later does not have to. Used for the spare screens that
+ * #TerminalApp keeps ready.
+ */
+void
+_terminal_screen_prepare_pty (TerminalScreen *screen)
+{
+  TerminalScreenPrivate *priv = screen->priv;
+  GError *error = NULL;
+
+  if (priv->spare_pty != NULL || priv->child_pid != -1)
+    return;
+
+  priv->spare_pty = vte_pty_new_sync (VTE_PTY_DEFAULT, NULL, &error);
+  if (priv->spare_pty == NULL) {
+    _terminal_debug_print (TERMINAL_DEBUG_PROCESSES,
+                           "[screen %p] failed to open a spare PTY: %s\n",
+                           screen, error->message);
+    g_error_free (error);
+  }
+}
+
+static void
+terminal_screen_first_output_cb (TerminalScreen *screen)
+{
+  TerminalScreenPrivate *priv = screen->priv;
+
+  g_signal_handlers_disconnect_by_func (screen,
+                                        G_CALLBACK (terminal_screen_first_output_cb),
+                                        NULL);
+
+  _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                         "[screen %p] first output %.3f ms after the request (%s window)\n",
+                         screen,
+                         (g_get_monotonic_time () - priv->request_time) / 1000.,
+                         priv->request_pooled ? "spare" : "new");
+}
+
+/**
+ * _terminal_screen_track_first_output:
+ * @screen: a #TerminalScreen
+ * @request_time: the monotonic time the screen was requested at
+ * @pooled: whether @screen was taken from the spare window pool
+ *
+ * Reports the latency from @request_time to the first output of the
+ * child process, which is normally the shell prompt.
+ */
+void
+_terminal_screen_track_first_output (TerminalScreen *screen,
+                                     gint64          request_time,
+                                     gboolean        pooled)
+{
+  TerminalScreenPrivate *priv = screen->priv;
+
+  priv->request_time = request_time;
+  priv->request_pooled = pooled;
+
+  g_signal_handlers_disconnect_by_func (screen,
+                                        G_CALLBACK (terminal_screen_first_output_cb),
+                                        NULL);
+  g_signal_connect (screen, "contents-changed",
+                    G_CALLBACK (terminal_screen_first_output_cb), NULL);
+}
+
+/**
+ * _terminal_screen_trim_caches:
+ *
+ * Frees the precompiled URL regexes; they are compiled again when the
+ * next screen is created. Must only be called while no screens exist.
+ */
+void
+_terminal_screen_trim_caches (void)
+{
+  free_regexes (n_url_regexes, &url_regexes, &url_regex_flavors);
+  free_regexes (n_extra_regexes, &extra_regexes, &extra_regex_flavors);
+}
+
+/* Rough size of one cell in VTE's scrollback stream, before compression:
+ * the UTF-8 text plus its share of the attribute runs.
+ */
+#define SCROLLBACK_BYTES_PER_CELL (4)
+
+static glong
+get_scrollback_lines_in_use (TerminalScreen *screen)
+{
+  GtkAdjustment *adjustment;
+  glong lines;
+
+  /* The adjustment spans the scrollback and the visible rows */
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen));
+  lines = (glong) (gtk_adjustment_get_upper (adjustment) - gtk_adjustment_get_lower (adjustment));
+
+  return MAX (lines - vte_terminal_get_row_count (VTE_TERMINAL (screen)), 0);
+}
+
+/* The profile's scrollback limit, or -1 if unlimited */
+static glong
+get_scrollback_limit (TerminalScreen *screen)
+{
+  GSettings *profile = screen->priv->profile;
+
+  if (g_settings_get_boolean (profile, TERMINAL_PROFILE_SCROLLBACK_UNLIMITED_KEY))
+    return -1;
+
+  return g_settings_get_int (profile, TERMINAL_PROFILE_SCROLLBACK_LINES_KEY);
+}
+
+/**
+ * terminal_screen_get_scrollback_size:
+ * @screen: a #TerminalScreen
+ *
+ * Returns: an estimate of the uncompressed size of @screen's scrollback
+ */
+gsize
+terminal_screen_get_scrollback_size (TerminalScreen *screen)
+{
+  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), 0);
+
+  return (gsize) get_scrollback_lines_in_use (screen) *
+         vte_terminal_get_column_count (VTE_TERMINAL (screen)) *
+         SCROLLBACK_BYTES_PER_CELL;
+}
+
+/**
+ * terminal_screen_trim_scrollback:
+ * @screen: a #TerminalScreen
+ * @keep_lines: the number of scrollback lines to keep
+ *
+ * Drops all but the newest @keep_lines lines of @screen's scrollback.
+ * The scrollback then grows again up to the profile's limit.
+ *
+ * Returns: an estimate of the number of bytes freed
+ */
+gsize
+terminal_screen_trim_scrollback (TerminalScreen *screen,
+                                 glong           keep_lines)
+{
+  VteTerminal *terminal;
+  glong lines;
+
+  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), 0);
+
+  terminal = VTE_TERMINAL (screen);
+  lines = get_scrollback_lines_in_use (screen);
+  if (lines <= keep_lines)
+    return 0;
+
+  _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                         "[screen %p] trimming scrollback from %ld to %ld lines\n",
+                         screen, lines, keep_lines);
+
+  /* Shrinking the limit drops the oldest lines right away */
+  vte_terminal_set_scrollback_lines (terminal, keep_lines);
+  vte_terminal_set_scrollback_lines (terminal, get_scrollback_limit (screen));
+
+  return (gsize) (lines - keep_lines) *
+         vte_terminal_get_column_count (terminal) *
+         SCROLLBACK_BYTES_PER_CELL;
+}
+
+/**
+ * terminal_screen_get_last_viewed_time:
+ * @screen: a #TerminalScreen
+ *
+ * Returns: the monotonic time @screen was last shown or hidden, or
+ *   created if it has never been shown
+ */
+gint64
+terminal_screen_get_last_viewed_time (TerminalScreen *screen)
+{
+  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), 0);
+
+  return screen->priv->last_viewed_time;
+}
+
+/* Saving the contents
+ *
+ * VTE can only write its contents synchronously, and only from the main
+ * thread, which for a big scrollback blocks the UI for a long time. So
+ * instead we copy the text out of the terminal a few rows at a time from a
+ * low priority idle, and hand the chunks over to a worker thread that
+ * writes them out, gzip-compressing them if asked to. The queue between
+ * them is bounded, so we never hold more than a few chunks in memory.
+ * Output arriving while saving is not included; rows that scroll off the
+ * scrollback before being copied are lost.
+ */
+
+#define SAVE_CONTENTS_ROWS_PER_CHUNK (1000)
+#define SAVE_CONTENTS_MAX_QUEUED_CHUNKS (16)
+#define SAVE_CONTENTS_THROTTLE_INTERVAL (10) /* ms */
+#define SAVE_CONTENTS_PROGRESS_INTERVAL (100) /* ms */
+
+typedef struct {
+  char *text; /* NULL marks the end of the contents */
+  gsize len;
+  glong n_rows;
+} SaveContentsChunk;
+
+typedef struct {
+  volatile gint ref_count;
+
+  /* Shared with the worker thread */
+  GFile *file;
+  gboolean compress;
+  GCancellable *cancellable;
+  GAsyncQueue *queue; /* of SaveContentsChunk */
+  volatile gint rows_written;
+
+  /* Main thread only */
+  TerminalScreen *screen;
+  GTask *task;
+  GCancellable *caller_cancellable;
+  gulong cancelled_handler_id;
+  TerminalScreenSaveProgressFunc progress_callback;
+  gpointer progress_data;
+  glong row;
+  glong end_row;
+  glong n_rows;
+  guint snapshot_source_id;
+  guint progress_source_id;
+} SaveContentsData;
+
+static SaveContentsData *
+save_contents_data_ref (SaveContentsData *data)
+{
+  g_atomic_int_inc (&data->ref_count);
+  return data;
+}
+
+static void
+save_contents_chunk_free (SaveContentsChunk *chunk)
+{
+  g_free (chunk->text);
+  g_slice_free (SaveContentsChunk, chunk);
+}
+
+static void
+save_contents_data_unref (SaveContentsData *data)
+{
+  if (!g_atomic_int_dec_and_test (&data->ref_count))
+    return;
+
+  g_assert (data->snapshot_source_id == 0);
+  g_assert (data->progress_source_id == 0);
+  g_assert (data->task == NULL);
+
+  g_object_unref (data->file);
+  g_object_unref (data->cancellable);
+  g_clear_object (&data->caller_cancellable);
+  g_async_queue_unref (data->queue);
+  g_slice_free (SaveContentsData, data);
+}
+
+/* Runs in the worker thread */
+static void
+save_contents_thread (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+  SaveContentsData *data = task_data;
+  gs_unref_object GOutputStream *file_stream = NULL;
+  gs_unref_object GOutputStream *stream = NULL;
+  SaveContentsChunk *chunk;
+  GError *error = NULL;
+  gboolean existed;
+
+  existed = g_file_query_exists (data->file, NULL);
+  file_stream = G_OUTPUT_STREAM (g_file_replace (data->file, NULL, FALSE,
+                                                 G_FILE_CREATE_NONE,
+                                                 cancellable, &error));
+  if (file_stream != NULL) {
+    if (data->compress) {
+      gs_unref_object GZlibCompressor *compressor =
+        g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+
+      stream = g_converter_output_stream_new (file_stream, G_CONVERTER (compressor));
+      /* The file stream is closed separately below, so that a failure
+       * never commits it.
+       */
+      g_filter_output_stream_set_close_base_stream (G_FILTER_OUTPUT_STREAM (stream), FALSE);
+    } else {
+      stream = g_object_ref (file_stream);
+    }
+  }
+
+  /* Always drain the queue up to the end marker, even after an error, so
+   * that the main thread never waits on a full queue.
+   */
+  while ((chunk = g_async_queue_pop (data->queue))->text != NULL) {
+    if (error == NULL &&
+        g_output_stream_write_all (stream, chunk->text, chunk->len,
+                                   NULL, cancellable, &error))
+      g_atomic_int_add (&data->rows_written, chunk->n_rows);
+    else
+      g_cancellable_cancel (cancellable);
+
+    save_contents_chunk_free (chunk);
+  }
+  save_contents_chunk_free (chunk);
+
+  if (error == NULL && stream != file_stream)
+    g_output_stream_close (stream, cancellable, &error);
+  if (error == NULL)
+    g_output_stream_close (file_stream, cancellable, &error);
+
+  if (error != NULL) {
+    /* Closing with a cancelled cancellable aborts the replace, keeping the
+     * file's old contents; otherwise the stream would be closed on unref,
+     * and the truncated contents written over the file.
+     */
+    if (file_stream != NULL) {
+      g_cancellable_cancel (cancellable);
+      g_output_stream_close (file_stream, cancellable, NULL);
+
+      if (!existed)
+        g_file_delete (data->file, NULL, NULL);
+    }
+
+    g_task_return_error (task, error);
+  } else
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+save_contents_push_chunk (SaveContentsData *data,
+                          char *text,
+                          glong n_rows)
+{
+  SaveContentsChunk *chunk;
+
+  chunk = g_slice_new (SaveContentsChunk);
+  chunk->text = text;
+  chunk->len = text ? strlen (text) : 0;
+  chunk->n_rows = n_rows;
+  g_async_queue_push (data->queue, chunk);
+}
+
+static void
+save_contents_stop (SaveContentsData *data)
+{
+  if (data->snapshot_source_id == 0)
+    return;
+
+  g_source_remove (data->snapshot_source_id);
+  data->snapshot_source_id = 0;
+
+  save_contents_push_chunk (data, NULL, 0);
+}
+
+static void
+save_contents_stop_progress (SaveContentsData *data)
+{
+  if (data->progress_source_id == 0)
+    return;
+
+  g_source_remove (data->progress_source_id);
+  data->progress_source_id = 0;
+}
+
+static gboolean save_contents_snapshot_cb (SaveContentsData *data);
+
+static gboolean
+save_contents_snapshot_throttled_cb (SaveContentsData *data)
+{
+  data->snapshot_source_id =
+    g_idle_add_full (G_PRIORITY_LOW,
+                     (GSourceFunc) save_contents_snapshot_cb,
+                     data, NULL);
+  return FALSE;
+}
+
+static gboolean
+save_contents_snapshot_cb (SaveContentsData *data)
+{
+  VteTerminal *terminal = VTE_TERMINAL (data->screen);
+  glong end_row;
+  gint64 span;
+
+  if (g_cancellable_is_cancelled (data->cancellable)) {
+    save_contents_stop (data);
+    return FALSE;
+  }
+
+  /* Let the worker catch up */
+  if (g_async_queue_length (data->queue) >= SAVE_CONTENTS_MAX_QUEUED_CHUNKS) {
+    data->snapshot_source_id =
+      g_timeout_add (SAVE_CONTENTS_THROTTLE_INTERVAL,
+                     (GSourceFunc) save_contents_snapshot_throttled_cb,
+                     data);
+    return FALSE;
+  }
+
+  span = _terminal_debug_span_begin ("save contents chunk");
+
+  end_row = MIN (data->row + SAVE_CONTENTS_ROWS_PER_CHUNK, data->end_row);
+  save_contents_push_chunk (data,
+                            vte_terminal_get_text_range (terminal,
+                                                         data->row, 0,
+                                                         end_row - 1,
+                                                         vte_terminal_get_column_count (terminal),
+                                                         NULL, NULL, NULL),
+                            end_row - data->row);
+  data->row = end_row;
+
+  _terminal_debug_span_end (span, "save contents chunk");
+
+  if (data->row < data->end_row)
+    return TRUE; /* run again */
+
+  /* All copied; this sends the end marker */
+  save_contents_stop (data);
+  return FALSE;
+}
+
+static gboolean
+save_contents_progress_cb (SaveContentsData *data)
+{
+  data->progress_callback (data->screen,
+                           data->n_rows > 0 ? (double) g_atomic_int_get (&data->rows_written) / data->n_rows : 1.0,
+                           data->progress_data);
+  return TRUE; /* run again */
+}
+
+static void
+save_contents_cancelled_cb (GCancellable *cancellable,
+                            SaveContentsData *data)
+{
+  g_cancellable_cancel (data->cancellable);
+}
+
+static void
+save_contents_screen_destroy_cb (GtkWidget *screen,
+                                 SaveContentsData *data)
+{
+  g_cancellable_cancel (data->cancellable);
+  save_contents_stop (data);
+  save_contents_stop_progress (data);
+}
+
+static void
+save_contents_thread_done_cb (GObject *source_object,
+                              GAsyncResult *result,
+                              gpointer user_data)
+{
+  SaveContentsData *data = user_data;
+  GTask *task;
+  GError *error = NULL;
+
+  g_assert (data->snapshot_source_id == 0);
+
+  save_contents_stop_progress (data);
+
+  g_signal_handlers_disconnect_by_func (data->screen,
+                                        G_CALLBACK (save_contents_screen_destroy_cb),
+                                        data);
+  if (data->caller_cancellable != NULL)
+    g_cancellable_disconnect (data->caller_cancellable, data->cancelled_handler_id);
+
+  task = data->task;
+  data->task = NULL;
+
+  if (g_task_propagate_boolean (G_TASK (result), &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+
+  g_object_unref (task);
+  save_contents_data_unref (data);
+}
+
+/**
+ * terminal_screen_save_contents_async:
+ * @screen: a #TerminalScreen
+ * @file: the file to write to
+ * @compress: whether to gzip-compress the contents
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @progress_callback: (allow-none): called periodically with the
+ *   fraction written so far, or %NULL
+ * @progress_data: data for @progress_callback
+ * @callback: called when done
+ * @user_data: data for @callback
+ *
+ * Writes the text of @screen's scrollback and screen to @file, without
+ * blocking the main loop. If @file exists and writing fails, it keeps
+ * its old contents. Destroying @screen cancels the save.
+ */
+void
+terminal_screen_save_contents_async (TerminalScreen *screen,
+                                     GFile *file,
+                                     gboolean compress,
+                                     GCancellable *cancellable,
+                                     TerminalScreenSaveProgressFunc progress_callback,
+                                     gpointer progress_data,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data)
+{
+  SaveContentsData *data;
+  GtkAdjustment *vadjustment;
+  gs_unref_object GTask *thread_task = NULL;
+
+  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  g_return_if_fail (G_IS_FILE (file));
+
+  data = g_slice_new0 (SaveContentsData);
+  data->ref_count = 1;
+  data->file = g_object_ref (file);
+  data->compress = compress;
+  data->cancellable = g_cancellable_new ();
+  data->queue = g_async_queue_new_full ((GDestroyNotify) save_contents_chunk_free);
+  data->screen = screen;
+  data->task = g_task_new (screen, cancellable, callback, user_data);
+  data->progress_callback = progress_callback;
+  data->progress_data = progress_data;
+
+  /* Write errors cancel our own cancellable, not the caller's */
+  if (cancellable != NULL) {
+    data->caller_cancellable = g_object_ref (cancellable);
+    data->cancelled_handler_id =
+      g_cancellable_connect (cancellable,
+                             G_CALLBACK (save_contents_cancelled_cb),
+                             data, NULL);
+  }
+
+  vadjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (screen));
+  data->row = (glong) gtk_adjustment_get_lower (vadjustment);
+  data->end_row = (glong) gtk_adjustment_get_upper (vadjustment);
+  data->n_rows = MAX (data->end_row - data->row, 0);
+
+  g_signal_connect (screen, "destroy",
+                    G_CALLBACK (save_contents_screen_destroy_cb), data);
+
+  data->snapshot_source_id =
+    g_idle_add_full (G_PRIORITY_LOW,
+                     (GSourceFunc) save_contents_snapshot_cb,
+                     data, NULL);
+  if (progress_callback != NULL)
+    data->progress_source_id =
+      g_timeout_add (SAVE_CONTENTS_PROGRESS_INTERVAL,
+                     (GSourceFunc) save_contents_progress_cb,
+                     data);
+
+  thread_task = g_task_new (NULL, data->cancellable, save_contents_thread_done_cb, data);
+  /* A write error cancels too, and must not be reported as a cancellation */
+  g_task_set_check_cancellable (thread_task, FALSE);
+  g_task_set_task_data (thread_task, save_contents_data_ref (data),
+                        (GDestroyNotify) save_contents_data_unref);
+  g_task_run_in_thread (thread_task, save_contents_thread);
+}
+
+/**
+ * terminal_screen_save_contents_finish:
+ * @screen: a #TerminalScreen
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError to fill in
+ *
+ * Returns: %TRUE on success, or %FALSE with @error filled in
+ */
+gboolean
+terminal_screen_save_contents_finish (TerminalScreen *screen,
+                                      GAsyncResult *result,
+                                      GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, screen), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/* Session state
+ *
+ * The scrollback is saved as plain text, gzip-compressed, in a side file
+ * next to the session file. On restore it is read back asynchronously,
+ * so that the window appears right away and all tabs load in parallel
+ * (the reads and the decompression run on GIO's worker threads), with
+ * the tabs that are shown going first.
+ */
+
+#define RESTORE_SCROLLBACK_CHUNK_SIZE (64 * 1024)
+
+/**
+ * terminal_screen_save_config:
+ * @screen: a #TerminalScreen
+ * @key_file: a #GKeyFile
+ * @group: the group to save @screen's state to
+ *
+ * Saves @screen's profile, working directory, command, size and zoom
+ * to @group in @key_file, in the format terminal_options_merge_config()
+ * reads.
+ */
+void
+terminal_screen_save_config (TerminalScreen *screen,
+                             GKeyFile *key_file,
+                             const char *group)
+{
+  TerminalScreenPrivate *priv;
+  VteTerminal *terminal;
+  gs_free char *profile_uuid = NULL;
+  gs_free char *working_dir = NULL;
+
+  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
+
+  priv = screen->priv;
+  terminal = VTE_TERMINAL (screen);
+
+  profile_uuid = terminal_settings_list_dup_uuid_from_child (terminal_app_get_profiles_list (terminal_app_get ()),
+                                                             priv->profile);
+  if (profile_uuid != NULL)
+    g_key_file_set_string (key_file, group, TERMINAL_CONFIG_TERMINAL_PROP_PROFILE_ID, profile_uuid);
+
+  working_dir = terminal_screen_get_current_dir (screen);
+  if (working_dir != NULL) {
+    gs_free char *escaped = g_strescape (working_dir, NULL);
+
+    g_key_file_set_string (key_file, group, TERMINAL_CONFIG_TERMINAL_PROP_WORKING_DIRECTORY, escaped);
+  }
+
+  if (priv->override_command != NULL) {
+    GString *flat;
+    gs_free char *escaped = NULL;
+    guint i;
+
+    flat = g_string_new (NULL);
+    for (i = 0; priv->override_command[i] != NULL; i++) {
+      gs_free char *quoted = g_shell_quote (priv->override_command[i]);
+
+      if (i > 0)
+        g_string_append_c (flat, ' ');
+      g_string_append (flat, quoted);
+    }
+
+    escaped = g_strescape (flat->str, NULL);
+    g_key_file_set_string (key_file, group, TERMINAL_CONFIG_TERMINAL_PROP_COMMAND, escaped);
+    g_string_free (flat, TRUE);
+  }
+
+  g_key_file_set_integer (key_file, group, TERMINAL_CONFIG_TERMINAL_PROP_WIDTH,
+                          vte_terminal_get_column_count (terminal));
+  g_key_file_set_integer (key_file, group, TERMINAL_CONFIG_TERMINAL_PROP_HEIGHT,
+                          vte_terminal_get_row_count (terminal));
+  g_key_file_set_double (key_file, group, TERMINAL_CONFIG_TERMINAL_PROP_ZOOM,
+                         vte_terminal_get_font_scale (terminal));
+}
+
+static void restore_scrollback_read_next (TerminalScreen *screen);
+
+static void
+restore_scrollback_done (TerminalScreen *screen,
+                         GError *error)
+{
+  TerminalScreenPrivate *priv = screen->priv;
+  gboolean cancelled;
+
+  cancelled = g_cancellable_is_cancelled (priv->restore_cancellable);
+
+  if (error != NULL && !cancelled)
+    _terminal_debug_print (TERMINAL_DEBUG_SERVER,
+                           "[screen %p] failed to restore the scrollback: %s\n",
+                           screen, error->message);
+
+  g_clear_object (&priv->restore_stream);
+  g_clear_object (&priv->restore_cancellable);
+
+  if (priv->exec_task != NULL) {
+    gs_unref_object GTask *task = priv->exec_task;
+    GError *err = NULL;
+
+    priv->exec_task = NULL;
+
+    if (cancelled)
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                               "Terminal closed before its child process was launched");
+    else if (terminal_screen_do_exec (screen, NULL, &err))
+      g_task_return_boolean (task, TRUE);
+    else
+      g_task_return_error (task, err);
+  }
+}
+
+static void
+restore_scrollback_read_cb (GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+  TerminalScreen *screen = user_data;
+  gs_unref_bytes GBytes *bytes = NULL;
+  GError *error = NULL;
+  const char *data, *p, *end;
+  gsize len;
+  GString *text;
+
+  bytes = g_input_stream_read_bytes_finish (G_INPUT_STREAM (source), result, &error);
+  if (bytes == NULL || g_bytes_get_size (bytes) == 0 ||
+      g_cancellable_is_cancelled (screen->priv->restore_cancellable)) {
+    restore_scrollback_done (screen, error);
+    g_clear_error (&error);
+    g_object_unref (screen);
+    return;
+  }
+
+  /* The saved text has bare newlines */
+  data = g_bytes_get_data (bytes, &len);
+  end = data + len;
+  text = g_string_sized_new (len + len / 32);
+  while ((p = memchr (data, '\n', end - data)) != NULL) {
+    g_string_append_len (text, data, p - data);
+    g_string_append_len (text, "\r\n", 2);
+    data = p + 1;
+  }
+  g_string_append_len (text, data, end - data);
+
+  vte_terminal_feed (VTE_TERMINAL (screen), text->str, text->len);
+  g_string_free (text, TRUE);
+
+  restore_scrollback_read_next (screen);
+  g_object_unref (screen);
+}
+
+static void
+restore_scrollback_read_next (TerminalScreen *screen)
+{
+  TerminalScreenPrivate *priv = screen->priv;
+
+  g_input_stream_read_bytes_async (priv->restore_stream,
+                                   RESTORE_SCROLLBACK_CHUNK_SIZE,
+                                   gtk_widget_get_mapped (GTK_WIDGET (screen)) ? G_PRIORITY_DEFAULT
+                                                                               : G_PRIORITY_LOW,
+                                   priv->restore_cancellable,
+                                   restore_scrollback_read_cb,
+                                   g_object_ref (screen));
+}
+
+static void
+restore_scrollback_open_cb (GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+  TerminalScreen *screen = user_data;
+  TerminalScreenPrivate *priv = screen->priv;
+  gs_unref_object GFileInputStream *file_stream = NULL;
+  gs_unref_object GZlibDecompressor *decompressor = NULL;
+  GError *error = NULL;
+
+  file_stream = g_file_read_finish (G_FILE (source), result, &error);
+  if (file_stream == NULL) {
+    restore_scrollback_done (screen, error);
+    g_error_free (error);
+    g_object_unref (screen);
+    return;
+  }
+
+  decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+  priv->restore_stream = g_converter_input_stream_new (G_INPUT_STREAM (file_stream),
+                                                       G_CONVERTER (decompressor));
+
+  restore_scrollback_read_next (screen);
+  g_object_unref (screen);
+}
+
+/**
+ * terminal_screen_restore_scrollback:
+ * @screen: a #TerminalScreen
+ * @file: a gzip-compressed file written by
+ *   terminal_screen_save_contents_async()
+ *
+ * Starts loading the scrollback saved in @file into @screen. A child
+ * process launched in the meantime is only started once that's done.
+ */
+void
+terminal_screen_restore_scrollback (TerminalScreen *screen,
+                                    GFile *file)
+{
+  TerminalScreenPrivate *priv;
+
+  g_return_if_fail (TERMINAL_IS_SCREEN (screen));
+  g_return_if_fail (G_IS_FILE (file));
+
+  priv = screen->priv;
+  g_return_if_fail (priv->restore_cancellable == NULL);
+
+  priv->restore_cancellable = g_cancellable_new ();
+  g_file_read_async (file,
+                     gtk_widget_get_mapped (GTK_WIDGET (screen)) ? G_PRIORITY_DEFAULT
+                                                                 : G_PRIORITY_LOW,
+                     priv->restore_cancellable,
+                     restore_scrollback_open_cb,
+                     g_object_ref (screen));
+}
+
+static void
+count_widgets_cb (GtkWidget *widget,
+                  guint     *n_widgets)
+{
+  (*n_widgets)++;
+
+  if (GTK_IS_CONTAINER (widget))
+    gtk_container_forall (GTK_CONTAINER (widget),
+                          (GtkCallback) count_widgets_cb,
+                          n_widgets);
+}
+
+#ifdef WITH_PCRE2
+
+static gsize
+pattern_memory_size (const TerminalRegexPattern *regex_patterns,
+                     guint n_regexes)
+{
+  gsize total = 0;
+  guint i;
+
+  /* VteRegex doesn't expose its code, so compile the patterns the same
+   * way here and ask PCRE2.
+   */
+  for (i = 0; i < n_regexes; i++)
+    {
+      pcre2_code_8 *code;
+      size_t size;
+      int errcode;
+      PCRE2_SIZE erroffset;
+
+      code = pcre2_compile_8 ((PCRE2_SPTR8) regex_patterns[i].pattern,
+                              PCRE2_ZERO_TERMINATED,
+                              PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_MULTILINE |
+                              (regex_patterns[i].caseless ? PCRE2_CASELESS : 0),
+                              &errcode, &erroffset, NULL);
+      if (code == NULL)
+        continue;
+
+      if (pcre2_pattern_info_8 (code, PCRE2_INFO_SIZE, &size) == 0)
+        total += size;
+      if (pcre2_jit_compile_8 (code, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_SOFT) == 0 &&
+          pcre2_pattern_info_8 (code, PCRE2_INFO_JITSIZE, &size) == 0)
+        total += size;
+
+      pcre2_code_free_8 (code);
+    }
+
+  return total;
+}
+
+#endif /* WITH_PCRE2 */
+
+/**
+ * terminal_screen_get_regex_memory_size:
+ *
+ * Returns: the memory used by the compiled URL and number regexes, which
+ *   all screens share, or 0 if it isn't known
+ */
+gsize
+terminal_screen_get_regex_memory_size (void)
+{
+#ifdef WITH_PCRE2
+  static gsize size = 0;
+
+  if (size == 0)
+    size = pattern_memory_size (url_regex_patterns, G_N_ELEMENTS (url_regex_patterns)) +
+           pattern_memory_size (extra_regex_patterns, G_N_ELEMENTS (extra_regex_patterns));
+
+  return size;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * terminal_screen_get_memory_report:
+ * @screen: a #TerminalScreen
+ *
+ * Describes the memory @screen uses, as a dictionary with these keys:
+ *
+ *   "uuid" (s), "title" (s): identify the screen
+ *   "scrollback-lines" (x): the lines of scrollback in use
+ *   "scrollback-limit" (x): the profile's limit, or -1 if unlimited
+ *   "scrollback-bytes" (t): an estimate of the scrollback's uncompressed size
+ *   "match-tags" (u): the number of URL match tags
+ *   "widgets" (u): the number of widgets in the screen's container
+ *
+ * Returns: (transfer floating): a #GVariant of type a{sv}
+ */
+GVariant *
+terminal_screen_get_memory_report (TerminalScreen *screen)
+{
+  TerminalScreenPrivate *priv;
+  TerminalScreenContainer *container;
+  GVariantBuilder builder;
+  const char *title;
+  gint64 lines, limit;
+  guint n_widgets = 0;
+
+  g_return_val_if_fail (TERMINAL_IS_SCREEN (screen), NULL);
+
+  priv = screen->priv;
+
+  lines = get_scrollback_lines_in_use (screen);
+  limit = get_scrollback_limit (screen);
+
+  container = terminal_screen_container_get_from_screen (screen);
+  if (container != NULL)
+    count_widgets_cb (GTK_WIDGET (container), &n_widgets);
+
+  title = terminal_screen_get_title (screen);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "uuid", g_variant_new_string (priv->uuid));
+  g_variant_builder_add (&builder, "{sv}", "title", g_variant_new_string (title ? title : ""));
+  g_variant_builder_add (&builder, "{sv}", "scrollback-lines", g_variant_new_int64 (lines));
+  g_variant_builder_add (&builder, "{sv}", "scrollback-limit", g_variant_new_int64 (limit));
+  g_variant_builder_add (&builder, "{sv}", "scrollback-bytes",
+                         g_variant_new_uint64 (terminal_screen_get_scrollback_size (screen)));
+  g_variant_builder_add (&builder, "{sv}", "match-tags",
+                         g_variant_new_uint32 (g_slist_length (priv->match_tags)));
+  g_variant_builder_add (&builder, "{sv}", "widgets", g_variant_new_uint32 (n_widgets));
+
+  return g_variant_builder_end (&builder);
+}
+
 static TerminalScreenPopupInfo *
 terminal_screen_popup_info_new (TerminalScreen *screen)
 {
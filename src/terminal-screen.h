@@ -81,17 +81,30 @@ TerminalScreen *terminal_screen_new (GSettings       *profile,
                                      char           **child_env,
                                      double           zoom);
 
-gboolean terminal_screen_exec (TerminalScreen *screen,
-                               char          **argv,
-                               char          **envv,
-                               gboolean        shell,
-                               const char     *cwd,
-                               GUnixFDList    *fd_list,
-                               GVariant       *fd_array,
-                               GError        **error);
+void terminal_screen_exec_async (TerminalScreen     *screen,
+                                 char              **argv,
+                                 char              **envv,
+                                 gboolean            shell,
+                                 const char         *cwd,
+                                 GUnixFDList        *fd_list,
+                                 GVariant           *fd_array,
+                                 GAsyncReadyCallback callback,
+                                 gpointer            user_data);
+
+gboolean terminal_screen_exec_finish (TerminalScreen *screen,
+                                      GAsyncResult   *result,
+                                      GError        **error);
 
 void _terminal_screen_launch_child_on_idle (TerminalScreen *screen);
 
+void _terminal_screen_prepare_pty (TerminalScreen *screen);
+
+void _terminal_screen_track_first_output (TerminalScreen *screen,
+                                          gint64          request_time,
+                                          gboolean        pooled);
+
+void _terminal_screen_trim_caches (void);
+
 void terminal_screen_set_profile (TerminalScreen *screen,
                                   GSettings      *profile);
 GSettings* terminal_screen_get_profile (TerminalScreen *screen);
@@ -120,10 +133,41 @@ void terminal_screen_save_config (TerminalScreen *screen,
                                   GKeyFile *key_file,
                                   const char *group);
 
+typedef void (* TerminalScreenSaveProgressFunc) (TerminalScreen *screen,
+                                                 double fraction,
+                                                 gpointer user_data);
+
+void terminal_screen_save_contents_async (TerminalScreen *screen,
+                                          GFile *file,
+                                          gboolean compress,
+                                          GCancellable *cancellable,
+                                          TerminalScreenSaveProgressFunc progress_callback,
+                                          gpointer progress_data,
+                                          GAsyncReadyCallback callback,
+                                          gpointer user_data);
+
+gboolean terminal_screen_save_contents_finish (TerminalScreen *screen,
+                                               GAsyncResult *result,
+                                               GError **error);
+
+void terminal_screen_restore_scrollback (TerminalScreen *screen,
+                                         GFile *file);
+
 gboolean terminal_screen_has_foreground_process (TerminalScreen *screen,
                                                  char           **process_name,
                                                  char           **cmdline);
 
+GVariant *terminal_screen_get_memory_report (TerminalScreen *screen);
+
+gsize terminal_screen_get_scrollback_size (TerminalScreen *screen);
+
+gsize terminal_screen_trim_scrollback (TerminalScreen *screen,
+                                       glong           keep_lines);
+
+gint64 terminal_screen_get_last_viewed_time (TerminalScreen *screen);
+
+gsize terminal_screen_get_regex_memory_size (void);
+
 /* Allow scales a bit smaller and a bit larger than the usual pango ranges */
 #define TERMINAL_SCALE_XXX_SMALL   (PANGO_SCALE_XX_SMALL/1.2)
 #define TERMINAL_SCALE_XXXX_SMALL  (TERMINAL_SCALE_XXX_SMALL/1.2)
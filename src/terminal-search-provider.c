@@ -25,6 +25,7 @@
 #include "terminal-screen-container.h"
 #include "terminal-search-provider.h"
 #include "terminal-search-provider-gdbus-generated.h"
+#include "terminal-text-utils.h"
 #include "terminal-window.h"
 
 struct _TerminalSearchProvider
@@ -41,67 +42,6 @@ struct _TerminalSearchProviderClass
 
 G_DEFINE_TYPE (TerminalSearchProvider, terminal_search_provider, G_TYPE_OBJECT)
 
-static char *
-normalize_casefold_and_unaccent (const char *str)
-{
-  gs_free char *casefolded = NULL, *normalized = NULL;
-  char *retval = NULL;
-
-  if (str == NULL)
-    goto out;
-
-  normalized = g_utf8_normalize (str, -1, G_NORMALIZE_ALL_COMPOSE);
-  casefolded = g_utf8_casefold (normalized, -1);
-  retval = g_str_to_ascii (casefolded, NULL);
-
- out:
-  return retval;
-}
-
-static char **
-normalize_casefold_and_unaccent_terms (const char* const *terms)
-{
-  char **casefolded_terms;
-  guint i, n;
-
-  n = g_strv_length ((char **) terms);
-  casefolded_terms = g_new (char *, n + 1);
-
-  for (i = 0; i < n; i++)
-    casefolded_terms[i] = normalize_casefold_and_unaccent (terms[i]);
-  casefolded_terms[n] = NULL;
-
-  return casefolded_terms;
-}
-
-static gboolean
-match_terms (const char        *str,
-             const char* const *terms)
-{
-  gs_free char *casefolded_str = NULL;
-  gboolean matches = TRUE;
-  guint i;
-
-  if (str == NULL)
-    {
-      matches = FALSE;
-      goto out;
-    }
-
-  casefolded_str = normalize_casefold_and_unaccent (str);
-  for (i = 0; terms[i] != NULL; i++)
-    {
-      if (strstr (casefolded_str, terms[i]) == NULL)
-        {
-          matches = FALSE;
-          break;
-        }
-    }
-
- out:
-  return matches;
-}
-
 static gboolean
 handle_get_initial_result_set_cb (TerminalSearchProvider2  *skeleton,
                                   GDBusMethodInvocation    *invocation,
@@ -112,8 +52,10 @@ handle_get_initial_result_set_cb (TerminalSearchProvider2  *skeleton,
   gs_unref_ptrarray GPtrArray *results;
   TerminalApp *app;
   gs_strfreev char **casefolded_terms = NULL;
+  gint64 span;
 
   _terminal_debug_print (TERMINAL_DEBUG_SEARCH, "GetInitialResultSet started\n");
+  span = _terminal_debug_span_begin ("search provider: GetInitialResultSet");
 
   app = terminal_app_get ();
   windows = gtk_application_get_windows (GTK_APPLICATION (app));
@@ -122,6 +64,9 @@ handle_get_initial_result_set_cb (TerminalSearchProvider2  *skeleton,
       TerminalWindow *window = TERMINAL_WINDOW (l->data);
       GList *c, *containers;
 
+      if (terminal_app_is_spare_window (app, GTK_WINDOW (window)))
+        continue;
+
       containers = terminal_window_list_screen_containers (window);
       for (c = containers; c != NULL; c = c->next)
         {
@@ -133,7 +78,7 @@ handle_get_initial_result_set_cb (TerminalSearchProvider2  *skeleton,
         }
     }
 
-  casefolded_terms = normalize_casefold_and_unaccent_terms (terms);
+  casefolded_terms = terminal_util_normalize_casefold_and_unaccent_terms (terms);
   results = g_ptr_array_new_with_free_func (g_free);
 
   for (l = screens; l != NULL; l = l->next)
@@ -145,10 +90,10 @@ handle_get_initial_result_set_cb (TerminalSearchProvider2  *skeleton,
       cwd = vte_terminal_get_current_directory_uri (VTE_TERMINAL (screen));
       title = terminal_screen_get_title (screen);
       terminal_screen_has_foreground_process (screen, &process, &cmdline);
-      if (match_terms (cwd, (const char *const *) casefolded_terms) ||
-          match_terms (title, (const char *const *) casefolded_terms) ||
-          match_terms (process, (const char *const *) casefolded_terms) ||
-          match_terms (cmdline, (const char *const *) casefolded_terms))
+      if (terminal_util_match_terms (cwd, (const char *const *) casefolded_terms) ||
+          terminal_util_match_terms (title, (const char *const *) casefolded_terms) ||
+          terminal_util_match_terms (process, (const char *const *) casefolded_terms) ||
+          terminal_util_match_terms (cmdline, (const char *const *) casefolded_terms))
         {
           const char *uuid;
 
@@ -164,6 +109,7 @@ handle_get_initial_result_set_cb (TerminalSearchProvider2  *skeleton,
                                                              invocation,
                                                              (const char *const *) results->pdata);
 
+  _terminal_debug_span_end (span, "search provider: GetInitialResultSet");
   _terminal_debug_print (TERMINAL_DEBUG_SEARCH, "GetInitialResultSet completed\n");
   return TRUE;
 }
@@ -178,12 +124,14 @@ handle_get_subsearch_result_set_cb (TerminalSearchProvider2  *skeleton,
   gs_unref_ptrarray GPtrArray *results;
   TerminalApp *app;
   gs_strfreev char **casefolded_terms = NULL;
+  gint64 span;
   guint i;
 
   _terminal_debug_print (TERMINAL_DEBUG_SEARCH, "GetSubsearchResultSet started\n");
+  span = _terminal_debug_span_begin ("search provider: GetSubsearchResultSet");
 
   app = terminal_app_get ();
-  casefolded_terms = normalize_casefold_and_unaccent_terms (terms);
+  casefolded_terms = terminal_util_normalize_casefold_and_unaccent_terms (terms);
   results = g_ptr_array_new_with_free_func (g_free);
 
   for (i = 0; previous_results[i] != NULL; i++)
@@ -202,10 +150,10 @@ handle_get_subsearch_result_set_cb (TerminalSearchProvider2  *skeleton,
       cwd = vte_terminal_get_current_directory_uri (VTE_TERMINAL (screen));
       title = terminal_screen_get_title (screen);
       terminal_screen_has_foreground_process (screen, &process, &cmdline);
-      if (match_terms (cwd, (const char *const *) casefolded_terms) ||
-          match_terms (title, (const char *const *) casefolded_terms) ||
-          match_terms (process, (const char *const *) casefolded_terms) ||
-          match_terms (cmdline, (const char *const *) casefolded_terms))
+      if (terminal_util_match_terms (cwd, (const char *const *) casefolded_terms) ||
+          terminal_util_match_terms (title, (const char *const *) casefolded_terms) ||
+          terminal_util_match_terms (process, (const char *const *) casefolded_terms) ||
+          terminal_util_match_terms (cmdline, (const char *const *) casefolded_terms))
         {
           g_ptr_array_add (results, g_strdup (previous_results[i]));
           _terminal_debug_print (TERMINAL_DEBUG_SEARCH, "Search hit: %s\n", previous_results[i]);
@@ -217,6 +165,7 @@ handle_get_subsearch_result_set_cb (TerminalSearchProvider2  *skeleton,
                                                                invocation,
                                                                (const char *const *) results->pdata);
 
+  _terminal_debug_span_end (span, "search provider: GetSubsearchResultSet");
   _terminal_debug_print (TERMINAL_DEBUG_SEARCH, "GetSubsearchResultSet completed\n");
   return TRUE;
 }
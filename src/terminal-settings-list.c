@@ -37,7 +37,11 @@ struct _TerminalSettingsList {
   char *path;
   char *child_schema_id;
 
-  char **uuids;
+  /* The children's UUIDs in list order (owns the strings), and an index
+   * mapping each UUID to its position + 1 in @uuids.
+   */
+  GPtrArray *uuids;
+  GHashTable *uuid_index;
   char *default_uuid;
 
   GHashTable *children;
@@ -48,7 +52,9 @@ struct _TerminalSettingsList {
 struct _TerminalSettingsListClass {
   GSettingsClass parent;
 
-  void (* children_changed) (TerminalSettingsList *list);
+  void (* children_changed) (TerminalSettingsList *list,
+                             char **added,
+                             char **removed);
   void (* default_changed)  (TerminalSettingsList *list);
 };
 
@@ -79,94 +85,27 @@ strv_printerr (char **strv)
     g_printerr ("%s'%s'", p != strv ? ", " : "", *p);
 }
 
-static char **
-strv_sort (char **strv)
-{
-  // FIXMEchpe
-  return strv;
-}
-
-static gboolean
-strv_equal (char **a,
-            char **b)
-{
-  char **e, **f;
-
-  if (a == NULL || b == NULL)
-    return a == b;
-
-  for (e = a, f = b; *e && *f; e++, f++) {
-    if (!g_str_equal (*e, *f))
-      return FALSE;
-  }
-
-  return *e == *f;
-}
-
-static int
-strv_find (char **strv,
-           const char *str)
-{
-  int i;
-
-  if (strv == NULL || str == NULL)
-    return -1;
-
-  for (i = 0; strv[i]; i++) {
-    if (!g_str_equal (strv[i], str))
-      continue;
-
-    return i;
-  }
-
-  return -1;
-}
-
-static char **
-strv_dupv_insert (char **strv,
-                  const char *str)
+static guint
+uuids_lookup (TerminalSettingsList *list,
+              const char *uuid)
 {
-  char **nstrv, **p, **q;
-
-  if (strv == NULL) {
-    char *s[2] = { (char *) str, NULL };
-    return g_strdupv (s);
-  }
-
-  /* Is it already in the list? */
-  for (p = strv; *p; p++)
-    if (g_str_equal (*p, str))
-      return g_strdupv (strv);
-
-  /* Not found; append */
-  nstrv = g_new (char *, (p - strv) + 2);
-  for (p = strv, q = nstrv; *p; p++, q++)
-    *q = g_strdup (*p);
-  *q++ = g_strdup (str);
-  *q = NULL;
+  if (uuid == NULL)
+    return 0;
 
-  return strv_sort (nstrv);
+  return GPOINTER_TO_UINT (g_hash_table_lookup (list->uuid_index, uuid));
 }
 
-static char **
-strv_dupv_remove (char **strv,
-                  const char *str)
+static GHashTable *
+uuid_index_new (GPtrArray *uuids)
 {
-  char **nstrv, **p, **q;
-
-  if (strv == NULL)
-    return NULL;
+  GHashTable *index;
+  guint i;
 
-  nstrv = g_strdupv (strv);
-  for (p = q = nstrv; *p; p++) {
-    if (!g_str_equal (*p, str))
-      *q++ = *p;
-    else
-      g_free (*p);
-  }
-  *q = NULL;
+  index = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < uuids->len; i++)
+    g_hash_table_insert (index, g_ptr_array_index (uuids, i), GUINT_TO_POINTER (i + 1));
 
-  return nstrv;
+  return index;
 }
 
 gboolean
@@ -228,7 +167,7 @@ list_map_func (GVariant *value,
   TerminalSettingsList *list = user_data;
   gs_strfreev char **entries;
 
-  entries = strv_sort (g_variant_dup_strv (value, NULL));
+  entries = g_variant_dup_strv (value, NULL);
 
   if (validate_list (list, entries)) {
     gs_transfer_out_value(result, &entries);
@@ -252,7 +191,7 @@ terminal_settings_list_ref_child_internal (TerminalSettingsList *list,
   GSettings *child;
   gs_free char *path = NULL;
 
-  if (strv_find (list->uuids, uuid) == -1)
+  if (uuids_lookup (list, uuid) == 0)
     return NULL;
 
   _terminal_debug_print (TERMINAL_DEBUG_SETTINGS_LIST,
@@ -270,93 +209,455 @@ terminal_settings_list_ref_child_internal (TerminalSettingsList *list,
   return g_object_ref (child);
 }
 
-static char *
-clone_child (TerminalSettingsList *list,
-             const char *uuid)
+static char **
+list_child_keys (TerminalSettingsList *list)
+{
+  gs_unref_object GSettings *dummy;
+
+  /* FIXME: this is beyond ugly. Need API on GSettingsSchema to list all the keys! */
+  dummy = g_settings_new_with_path (list->child_schema_id, "/foo/");
+  return g_settings_list_keys (dummy);
+}
+
+static void
+clone_child_dconf (TerminalSettingsList *list,
+                   DConfChangeset *changeset,
+                   char **keys,
+                   GVariant **values,
+                   const char *new_uuid)
 {
-  char *new_uuid;
-  gs_free char *path;
   gs_free char *new_path;
-  char **keys;
   guint i;
-  gs_unref_object DConfClient *client;
-  DConfChangeset *changeset;
 
-  new_uuid = new_list_entry ();
+  new_path = path_new (list, new_uuid);
 
-  _terminal_debug_print (TERMINAL_DEBUG_SETTINGS_LIST,
-                         "%s UUID %s NEW UUID %s \n", G_STRFUNC, uuid ? uuid : "(null)", new_uuid);
+  for (i = 0; keys[i]; i++) {
+    gs_free char *wkey;
+
+    if (values[i] == NULL)
+      continue;
+
+    wkey = g_strconcat (new_path, keys[i], NULL);
+    dconf_changeset_set (changeset, wkey, values[i]);
+  }
+}
+
+static void
+clone_child_delayed (TerminalSettingsList *list,
+                     char **keys,
+                     const char *uuid,
+                     const char *new_uuid)
+{
+  gs_unref_object GSettings *child;
+  gs_unref_object GSettings *new_child;
+  gs_free char *path;
+  gs_free char *new_path;
+  guint i;
 
   path = path_new (list, uuid);
   new_path = path_new (list, new_uuid);
 
-  client = dconf_client_new ();
-  changeset = dconf_changeset_new ();
+  child = g_settings_new_with_path (list->child_schema_id, path);
+  new_child = g_settings_new_with_path (list->child_schema_id, new_path);
 
-  /* FIXME: this is beyond ugly. Need API on GSettingsSchema to list all the keys! */
-  {
-    gs_unref_object GSettings *dummy = g_settings_new_with_path (list->child_schema_id, "/foo/");
-    keys = g_settings_list_keys (dummy);
-  }
+  /* Collect all keys and write them to the backend at once */
+  g_settings_delay (new_child);
 
   for (i = 0; keys[i]; i++) {
-    gs_free char *rkey;
     gs_unref_variant GVariant *value;
 
-    rkey = g_strconcat (path, keys[i], NULL);
-    value = dconf_client_read (client, rkey);
+    value = g_settings_get_user_value (child, keys[i]);
+    if (value)
+      g_settings_set_value (new_child, keys[i], value);
+  }
 
-    if (value) {
-      gs_free char *wkey;
-      wkey = g_strconcat (new_path, keys[i], NULL);
-      dconf_changeset_set (changeset, wkey, value);
+  g_settings_apply (new_child);
+}
+
+/*
+ * list_new_uuids:
+ * @insert: (allow-none): UUIDs to append to the list
+ * @remove: (allow-none): a UUID to remove from the list
+ *
+ * Returns the current list with @insert appended and @remove dropped. The
+ * strings are borrowed, not copied; free the array with g_free().
+ *
+ * Returns: (transfer container): the new list, or %NULL if the list would
+ *   become empty and the list doesn't allow that
+ */
+static const char **
+list_new_uuids (TerminalSettingsList *list,
+                char **insert,
+                const char *remove)
+{
+  const char **strv;
+  guint i, n, skip;
+
+  skip = uuids_lookup (list, remove);
+
+  strv = g_new (const char *, list->uuids->len + (insert ? g_strv_length (insert) : 0) + 1);
+  for (i = n = 0; i < list->uuids->len; i++) {
+    if (i + 1 == skip)
+      continue;
+    strv[n++] = g_ptr_array_index (list->uuids, i);
+  }
+  for (i = 0; insert != NULL && insert[i] != NULL; i++) {
+    if (uuids_lookup (list, insert[i]) == 0)
+      strv[n++] = insert[i];
+  }
+  strv[n] = NULL;
+
+  if (n == 0 && (list->flags & TERMINAL_SETTINGS_LIST_FLAG_ALLOW_EMPTY) == 0) {
+    g_free (strv);
+    return NULL;
+  }
+
+  return strv;
+}
+
+/*
+ * terminal_settings_list_write_list:
+ *
+ * Writes the list returned by list_new_uuids().
+ *
+ * Returns: %FALSE if the list would become empty and the list doesn't allow that
+ */
+static gboolean
+terminal_settings_list_write_list (TerminalSettingsList *list,
+                                   char **insert,
+                                   const char *remove)
+{
+  gs_free const char **strv;
+
+  strv = list_new_uuids (list, insert, remove);
+  if (strv == NULL)
+    return FALSE;
+
+  g_settings_set_strv (&list->parent, TERMINAL_SETTINGS_LIST_LIST_KEY, strv);
+  return TRUE;
+}
+
+static void terminal_settings_list_update_list (TerminalSettingsList *list);
+
+/*
+ * clone_children:
+ * @uuid: the UUID of the child to clone
+ * @n_clones: the number of clones to make
+ *
+ * Copies the keys of @uuid into @n_clones new children, and adds them to
+ * the list. On dconf, the keys and the list are written in a single
+ * changeset; otherwise each clone is written with one delayed apply, and
+ * then the list.
+ *
+ * Returns: (transfer full): the UUIDs of the new children
+ */
+static char **
+clone_children (TerminalSettingsList *list,
+                const char *uuid,
+                guint n_clones)
+{
+  char **new_uuids;
+  gs_strfreev char **keys;
+  guint i;
+
+  g_assert (n_clones <= TERMINAL_SETTINGS_LIST_MAX_CLONES);
+
+  new_uuids = g_new0 (char *, n_clones + 1);
+  for (i = 0; i < n_clones; i++)
+    new_uuids[i] = new_list_entry ();
+
+  _terminal_debug_print (TERMINAL_DEBUG_SETTINGS_LIST,
+                         "%s UUID %s cloning %u children\n", G_STRFUNC, uuid, n_clones);
+
+  keys = list_child_keys (list);
+
+  if (settings_backend_is_dconf ()) {
+    gs_unref_object DConfClient *client;
+    DConfChangeset *changeset;
+    gs_free char *path;
+    gs_free char *list_key;
+    gs_free const char **strv;
+    GVariant **values;
+    guint n_keys;
+
+    client = dconf_client_new ();
+    changeset = dconf_changeset_new ();
+
+    /* All clones get the same values, so only read them once */
+    path = path_new (list, uuid);
+    n_keys = g_strv_length (keys);
+    values = g_new0 (GVariant *, n_keys);
+    for (i = 0; i < n_keys; i++) {
+      gs_free char *rkey;
+
+      rkey = g_strconcat (path, keys[i], NULL);
+      values[i] = dconf_client_read (client, rkey);
     }
+
+    for (i = 0; i < n_clones; i++)
+      clone_child_dconf (list, changeset, keys, values, new_uuids[i]);
+
+    for (i = 0; i < n_keys; i++)
+      if (values[i])
+        g_variant_unref (values[i]);
+    g_free (values);
+
+    /* Adding clones never empties the list */
+    strv = list_new_uuids (list, new_uuids, NULL);
+    list_key = g_strconcat (list->path, TERMINAL_SETTINGS_LIST_LIST_KEY, NULL);
+    dconf_changeset_set (changeset, list_key,
+                         g_variant_new_strv (strv, -1));
+
+    dconf_client_change_sync (client, changeset, NULL, NULL, NULL);
+    dconf_changeset_unref (changeset);
+
+    /* We'd only hear about the new list from the backend later; pick it
+     * up now, so that the clones can be used right away.
+     */
+    terminal_settings_list_update_list (list);
+  } else {
+    for (i = 0; i < n_clones; i++)
+      clone_child_delayed (list, keys, uuid, new_uuids[i]);
+
+    terminal_settings_list_write_list (list, new_uuids, NULL);
   }
 
-  dconf_client_change_sync (client, changeset, NULL, NULL, NULL);
-  dconf_changeset_unref (changeset);
+  return new_uuids;
+}
 
-  return new_uuid;
+static char **
+terminal_settings_list_add_children_internal (TerminalSettingsList *list,
+                                              const char *uuid,
+                                              guint n_children)
+{
+  char **new_uuids;
+  guint i;
+
+  /* A single list write, so listeners see all new children at once */
+  if (uuid) {
+    new_uuids = clone_children (list, uuid, n_children);
+  } else {
+    new_uuids = g_new0 (char *, n_children + 1);
+    for (i = 0; i < n_children; i++)
+      new_uuids[i] = new_list_entry ();
+
+    terminal_settings_list_write_list (list, new_uuids, NULL);
+  }
+
+  _TERMINAL_DEBUG_IF (TERMINAL_DEBUG_SETTINGS_LIST) {
+    g_printerr ("%s NEW UUIDs [", G_STRFUNC);
+    strv_printerr (new_uuids);
+    g_printerr ("]\n");
+  }
+
+  return new_uuids;
 }
 
 static char *
 terminal_settings_list_add_child_internal (TerminalSettingsList *list,
                                            const char *uuid)
 {
+  char **new_uuids;
   char *new_uuid;
-  gs_strfreev char **new_uuids;
 
-  if (uuid && settings_backend_is_dconf ())
-    new_uuid = clone_child (list, uuid);
-  else
-    new_uuid = new_list_entry ();
+  new_uuids = terminal_settings_list_add_children_internal (list, uuid, 1);
+  new_uuid = new_uuids[0];
+  g_free (new_uuids);
 
-  _terminal_debug_print (TERMINAL_DEBUG_SETTINGS_LIST,
-                         "%s NEW UUID %s\n", G_STRFUNC, new_uuid);
+  return new_uuid;
+}
 
-  new_uuids = strv_dupv_insert (list->uuids, new_uuid);
-  g_settings_set_strv (&list->parent, TERMINAL_SETTINGS_LIST_LIST_KEY,
-                       (const char * const *) new_uuids);
+/* Bundles
+ *
+ * A bundle is a key file with one group per child, named by its UUID, that
+ * holds the child's non-default keys in GVariant text format, plus a
+ * BUNDLE_GROUP group listing the children and the default child.
+ */
 
-  return new_uuid;
+#define BUNDLE_GROUP          "List"
+#define BUNDLE_SCHEMA_KEY     "Schema"
+#define BUNDLE_CHILDREN_KEY   "Children"
+#define BUNDLE_DEFAULT_KEY    "Default"
+
+static gboolean
+strv_has (char **strv,
+          const char *str)
+{
+  for ( ; strv != NULL && *strv; strv++)
+    if (g_str_equal (*strv, str))
+      return TRUE;
+
+  return FALSE;
+}
+
+/*
+ * bundle_parse_child:
+ *
+ * Parses and validates the values of child @uuid in @keyfile.
+ *
+ * Returns: (transfer full): an a{sv} dictionary of the values, or %NULL
+ */
+static GVariant *
+bundle_parse_child (GSettingsSchema *schema,
+                    GKeyFile *keyfile,
+                    const char *uuid,
+                    char **keys,
+                    GError **error)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  for (i = 0; keys[i]; i++) {
+    GSettingsSchemaKey *schema_key;
+    gs_free char *text = NULL;
+    GVariant *value;
+    gboolean valid;
+
+    text = g_key_file_get_value (keyfile, uuid, keys[i], NULL);
+    if (text == NULL)
+      continue;
+
+    schema_key = g_settings_schema_get_key (schema, keys[i]);
+    value = g_variant_parse (g_settings_schema_key_get_value_type (schema_key),
+                             text, NULL, NULL, error);
+    if (value != NULL) {
+      valid = g_settings_schema_key_range_check (schema_key, value);
+      if (!valid) {
+        g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                     "Value for key \"%s\" of \"%s\" is out of range", keys[i], uuid);
+        g_variant_unref (value);
+      }
+    } else
+      valid = FALSE;
+
+    g_settings_schema_key_unref (schema_key);
+
+    if (!valid) {
+      g_variant_builder_clear (&builder);
+      return NULL;
+    }
+
+    g_variant_builder_add (&builder, "{sv}", keys[i], value);
+    g_variant_unref (value);
+  }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static gboolean
+import_children_dconf (TerminalSettingsList *list,
+                       char **uuids,
+                       GPtrArray *children,
+                       char **keys,
+                       const char *default_uuid,
+                       GError **error)
+{
+  gs_unref_object DConfClient *client;
+  gs_free const char **new_list = NULL;
+  DConfChangeset *changeset;
+  guint i, j;
+  gboolean rv;
+
+  changeset = dconf_changeset_new ();
+
+  for (i = 0; uuids[i]; i++) {
+    GVariant *dict = g_ptr_array_index (children, i);
+    gs_free char *path;
+    gboolean exists;
+
+    path = path_new (list, uuids[i]);
+    exists = uuids_lookup (list, uuids[i]) != 0;
+
+    for (j = 0; keys[j]; j++) {
+      gs_unref_variant GVariant *value;
+      gs_free char *wkey;
+
+      value = g_variant_lookup_value (dict, keys[j], NULL);
+      /* Reset keys of existing children that the bundle leaves at the default */
+      if (value == NULL && !exists)
+        continue;
+
+      wkey = g_strconcat (path, keys[j], NULL);
+      dconf_changeset_set (changeset, wkey, value);
+    }
+  }
+
+  new_list = list_new_uuids (list, uuids, NULL);
+  if (new_list != NULL) {
+    gs_free char *wkey;
+
+    wkey = g_strconcat (list->path, TERMINAL_SETTINGS_LIST_LIST_KEY, NULL);
+    dconf_changeset_set (changeset, wkey, g_variant_new_strv (new_list, -1));
+  }
+
+  if (default_uuid != NULL) {
+    gs_free char *wkey;
+
+    wkey = g_strconcat (list->path, TERMINAL_SETTINGS_LIST_DEFAULT_KEY, NULL);
+    dconf_changeset_set (changeset, wkey, g_variant_new_string (default_uuid));
+  }
+
+  client = dconf_client_new ();
+  rv = dconf_client_change_sync (client, changeset, NULL, NULL, error);
+  dconf_changeset_unref (changeset);
+
+  return rv;
+}
+
+static void
+import_children_delayed (TerminalSettingsList *list,
+                         char **uuids,
+                         GPtrArray *children,
+                         char **keys,
+                         const char *default_uuid)
+{
+  guint i, j;
+
+  for (i = 0; uuids[i]; i++) {
+    GVariant *dict = g_ptr_array_index (children, i);
+    gs_unref_object GSettings *child;
+    gs_free char *path;
+    gboolean exists;
+
+    path = path_new (list, uuids[i]);
+    exists = uuids_lookup (list, uuids[i]) != 0;
+
+    child = g_settings_new_with_path (list->child_schema_id, path);
+    g_settings_delay (child);
+
+    for (j = 0; keys[j]; j++) {
+      gs_unref_variant GVariant *value;
+
+      value = g_variant_lookup_value (dict, keys[j], NULL);
+      if (value != NULL)
+        g_settings_set_value (child, keys[j], value);
+      else if (exists)
+        g_settings_reset (child, keys[j]);
+    }
+
+    g_settings_apply (child);
+  }
+
+  terminal_settings_list_write_list (list, uuids, NULL);
+
+  if (default_uuid != NULL)
+    g_settings_set_string (&list->parent, TERMINAL_SETTINGS_LIST_DEFAULT_KEY, default_uuid);
 }
 
 static void
 terminal_settings_list_remove_child_internal (TerminalSettingsList *list,
                                               const char *uuid)
 {
-  gs_strfreev char **new_uuids;
-
   _terminal_debug_print (TERMINAL_DEBUG_SETTINGS_LIST,
                          "%s UUID %s\n", G_STRFUNC, uuid);
 
-  new_uuids = strv_dupv_remove (list->uuids, uuid);
-
-  if ((new_uuids == NULL || new_uuids[0] == NULL) &&
-      (list->flags & TERMINAL_SETTINGS_LIST_FLAG_ALLOW_EMPTY) == 0)
+  if (uuids_lookup (list, uuid) == 0)
     return;
 
-  g_settings_set_strv (&list->parent, TERMINAL_SETTINGS_LIST_LIST_KEY, (const char * const *) new_uuids);
+  if (!terminal_settings_list_write_list (list, NULL, uuid))
+    return;
 
   if (list->default_uuid != NULL &&
       g_str_equal (list->default_uuid, uuid))
@@ -376,10 +677,10 @@ terminal_settings_list_remove_child_internal (TerminalSettingsList *list,
 static void
 terminal_settings_list_update_list (TerminalSettingsList *list)
 {
-  char **uuids, *uuid;
-  GSettings *child;
-  GHashTable *new_children;
-  guint i;
+  char **uuids;
+  GPtrArray *old_uuids, *new_uuids, *added, *removed;
+  GHashTable *old_index, *new_index;
+  guint i, n;
   gboolean changed;
 
   uuids = g_settings_get_mapped (&list->parent,
@@ -388,49 +689,64 @@ terminal_settings_list_update_list (TerminalSettingsList *list)
 
   _TERMINAL_DEBUG_IF (TERMINAL_DEBUG_SETTINGS_LIST) {
     g_printerr ("%s: current UUIDs [", G_STRFUNC);
-    strv_printerr (list->uuids);
+    for (i = 0; i < list->uuids->len; i++)
+      g_printerr ("%s'%s'", i ? ", " : "", (char *) g_ptr_array_index (list->uuids, i));
     g_printerr ("]\n new UUIDs [");
     strv_printerr (uuids);
     g_printerr ("]\n");
   }
 
-  if (strv_equal (uuids, list->uuids) &&
-      ((list->flags & TERMINAL_SETTINGS_LIST_FLAG_HAS_DEFAULT) == 0 ||
-       strv_find (list->uuids, list->default_uuid) != -1)) {
-    g_strfreev (uuids);
-    return;
-  }
+  /* Adopt the strings; the index refers to them until @new_uuids is freed */
+  n = uuids ? g_strv_length (uuids) : 0;
+  new_uuids = g_ptr_array_new_full (n, (GDestroyNotify) g_free);
+  for (i = 0; i < n; i++)
+    g_ptr_array_add (new_uuids, uuids[i]);
+  g_free (uuids);
 
-  new_children = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                        (GDestroyNotify) g_free,
-                                        (GDestroyNotify) g_object_unref);
+  new_index = uuid_index_new (new_uuids);
 
-  if (uuids) {
-    for (i = 0; uuids[i] != NULL; i++) {
-      uuid = uuids[i];
+  added = g_ptr_array_new ();
+  removed = g_ptr_array_new ();
 
-      child = g_hash_table_lookup (list->children, uuid);
+  for (i = 0; i < new_uuids->len; i++) {
+    char *uuid = g_ptr_array_index (new_uuids, i);
 
-      if (child) {
-        g_object_ref (child);
-        g_hash_table_remove (list->children, uuid);
-        g_hash_table_insert (new_children, g_strdup (uuid), child /* adopted */);
-      }
-    }
+    if (uuids_lookup (list, uuid) == 0)
+      g_ptr_array_add (added, uuid);
+  }
 
-    changed = !strv_equal (uuids, list->uuids);
-  } else {
-    changed = g_strv_length (list->uuids) != 0;
+  for (i = 0; i < list->uuids->len; i++) {
+    char *uuid = g_ptr_array_index (list->uuids, i);
+
+    if (!g_hash_table_contains (new_index, uuid)) {
+      g_ptr_array_add (removed, uuid);
+      g_hash_table_remove (list->children, uuid);
+    }
   }
 
-  g_hash_table_unref (list->children);
-  list->children = new_children;
+  changed = added->len > 0 || removed->len > 0;
+  /* Same set of UUIDs; has only the order changed? */
+  for (i = 0; !changed && i < new_uuids->len; i++)
+    changed = uuids_lookup (list, g_ptr_array_index (new_uuids, i)) != i + 1;
+
+  old_uuids = list->uuids;
+  old_index = list->uuid_index;
+  list->uuids = new_uuids;
+  list->uuid_index = new_index;
 
-  g_strfreev (list->uuids);
-  list->uuids = uuids; /* adopts */
+  if (changed) {
+    g_ptr_array_add (added, NULL);
+    g_ptr_array_add (removed, NULL);
 
-  if (changed)
-    g_signal_emit (list, signals[SIGNAL_CHILDREN_CHANGED], 0);
+    g_signal_emit (list, signals[SIGNAL_CHILDREN_CHANGED], 0,
+                   (char **) added->pdata, (char **) removed->pdata);
+  }
+
+  /* The removed UUIDs belong to @old_uuids, so only free them now */
+  g_ptr_array_free (added, TRUE);
+  g_ptr_array_free (removed, TRUE);
+  g_hash_table_unref (old_index);
+  g_ptr_array_unref (old_uuids);
 }
 
 static void
@@ -478,6 +794,8 @@ static void
 terminal_settings_list_init (TerminalSettingsList *list)
 {
   list->flags = TERMINAL_SETTINGS_LIST_FLAG_NONE;
+  list->uuids = g_ptr_array_new_with_free_func ((GDestroyNotify) g_free);
+  list->uuid_index = g_hash_table_new (g_str_hash, g_str_equal);
 }
 
 static void
@@ -505,7 +823,8 @@ terminal_settings_list_finalize (GObject *object)
 
   g_free (list->path);
   g_free (list->child_schema_id);
-  g_strfreev (list->uuids);
+  g_hash_table_unref (list->uuid_index);
+  g_ptr_array_unref (list->uuids);
   g_free (list->default_uuid);
   g_hash_table_unref (list->children);
 
@@ -569,18 +888,22 @@ terminal_settings_list_class_init (TerminalSettingsListClass *klass)
   /**
    * TerminalSettingsList::children-changed:
    * @list: the object on which the signal was emitted
+   * @added: (array zero-terminated=1): the UUIDs of the children that were added
+   * @removed: (array zero-terminated=1): the UUIDs of the children that were removed
    *
    * The "children-changed" signal is emitted when the list of children
-   * has potentially changed.
+   * has changed. Both arrays are empty when only the order changed.
    */
   signals[SIGNAL_CHILDREN_CHANGED] =
     g_signal_new ("children-changed", TERMINAL_TYPE_SETTINGS_LIST,
                   G_SIGNAL_RUN_LAST,
                   G_STRUCT_OFFSET (TerminalSettingsListClass, children_changed),
                   NULL, NULL,
-                  g_cclosure_marshal_VOID__VOID,
+                  g_cclosure_marshal_generic,
                   G_TYPE_NONE,
-                  0);
+                  2,
+                  G_TYPE_STRV | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_STRV | G_SIGNAL_TYPE_STATIC_SCOPE);
 
   /**
    * TerminalSettingsList::default-changed:
@@ -640,9 +963,17 @@ terminal_settings_list_new (const char *path,
 char **
 terminal_settings_list_dupv_children (TerminalSettingsList *list)
 {
+  char **uuids;
+  guint i;
+
   g_return_val_if_fail (TERMINAL_IS_SETTINGS_LIST (list), NULL);
 
-  return g_strdupv (list->uuids);
+  uuids = g_new (char *, list->uuids->len + 1);
+  for (i = 0; i < list->uuids->len; i++)
+    uuids[i] = g_strdup (g_ptr_array_index (list->uuids, i));
+  uuids[i] = NULL;
+
+  return uuids;
 }
 
 /**
@@ -659,18 +990,18 @@ terminal_settings_list_dup_default_child (TerminalSettingsList *list)
   if ((list->flags & TERMINAL_SETTINGS_LIST_FLAG_HAS_DEFAULT) == 0)
     return NULL;
 
-  if ((strv_find (list->uuids, list->default_uuid)) != -1)
+  if (uuids_lookup (list, list->default_uuid) != 0)
     return g_strdup (list->default_uuid);
 
   /* Just randomly designate the first child as default, but don't write that
    * to dconf.
    */
-  if (list->uuids == NULL || list->uuids[0] == NULL) {
+  if (list->uuids->len == 0) {
     g_warn_if_fail ((list->flags & TERMINAL_SETTINGS_LIST_FLAG_ALLOW_EMPTY));
     return NULL;
   }
 
-  return g_strdup (list->uuids[0]);
+  return g_strdup (g_ptr_array_index (list->uuids, 0));
 }
 
 /**
@@ -687,7 +1018,7 @@ terminal_settings_list_has_child (TerminalSettingsList *list,
   g_return_val_if_fail (TERMINAL_IS_SETTINGS_LIST (list), FALSE);
   g_return_val_if_fail (terminal_settings_list_valid_uuid (uuid), FALSE);
 
-  return strv_find (list->uuids, uuid) != -1;
+  return uuids_lookup (list, uuid) != 0;
 }
 
 /**
@@ -726,12 +1057,9 @@ terminal_settings_list_ref_children (TerminalSettingsList *list)
 
   g_return_val_if_fail (TERMINAL_IS_SETTINGS_LIST (list), NULL);
 
-  if (list->uuids == NULL)
-    return NULL;
-
   l = NULL;
-  for (i = 0; list->uuids[i]; i++)
-    l = g_list_prepend (l, terminal_settings_list_ref_child (list, list->uuids[i]));
+  for (i = 0; i < list->uuids->len; i++)
+    l = g_list_prepend (l, terminal_settings_list_ref_child_internal (list, g_ptr_array_index (list->uuids, i)));
 
   return g_list_reverse (l);
 }
@@ -795,6 +1123,212 @@ terminal_settings_list_clone_child (TerminalSettingsList *list,
   return terminal_settings_list_add_child_internal (list, uuid);
 }
 
+/**
+ * terminal_settings_list_clone_child_n:
+ * @list: a #TerminalSettingsList
+ * @uuid: the UUID of the child to clone
+ * @n_clones: the number of clones to make
+ *
+ * Like terminal_settings_list_clone_child(), but adds @n_clones new children
+ * at once. With dconf, all their keys and the list itself are written in
+ * one changeset. @n_clones must be at most %TERMINAL_SETTINGS_LIST_MAX_CLONES.
+ *
+ * Returns: (transfer full): the UUIDs of the new children
+ */
+char **
+terminal_settings_list_clone_child_n (TerminalSettingsList *list,
+                                      const char *uuid,
+                                      guint n_clones)
+{
+  g_return_val_if_fail (TERMINAL_IS_SETTINGS_LIST (list), NULL);
+  g_return_val_if_fail (terminal_settings_list_valid_uuid (uuid), NULL);
+  g_return_val_if_fail (n_clones > 0 && n_clones <= TERMINAL_SETTINGS_LIST_MAX_CLONES, NULL);
+
+  return terminal_settings_list_add_children_internal (list, uuid, n_clones);
+}
+
+/**
+ * terminal_settings_list_export_children:
+ * @list: a #TerminalSettingsList
+ * @uuids: (allow-none) (array zero-terminated=1): the UUIDs of the children to
+ *   export, or %NULL to export all children
+ * @keyfile: the #GKeyFile to export to
+ * @error: a #GError location
+ *
+ * Writes the children with UUIDs @uuids, and the default child if it is one
+ * of them, to @keyfile in a form terminal_settings_list_import_children()
+ * can read back.
+ *
+ * Returns: %TRUE on success, or %FALSE with @error filled in
+ */
+gboolean
+terminal_settings_list_export_children (TerminalSettingsList *list,
+                                        char **uuids,
+                                        GKeyFile *keyfile,
+                                        GError **error)
+{
+  gs_strfreev char **all_uuids = NULL;
+  gs_strfreev char **keys = NULL;
+  gs_free char *default_uuid = NULL;
+  guint i, j;
+
+  g_return_val_if_fail (TERMINAL_IS_SETTINGS_LIST (list), FALSE);
+  g_return_val_if_fail (keyfile != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (uuids == NULL)
+    uuids = all_uuids = terminal_settings_list_dupv_children (list);
+
+  for (i = 0; uuids[i]; i++) {
+    if (uuids_lookup (list, uuids[i]) != 0)
+      continue;
+
+    g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND,
+                 "No child with UUID \"%s\" exists", uuids[i]);
+    return FALSE;
+  }
+
+  /* Write the list group first, so it comes first in the file */
+  g_key_file_set_string (keyfile, BUNDLE_GROUP, BUNDLE_SCHEMA_KEY, list->child_schema_id);
+  g_key_file_set_string_list (keyfile, BUNDLE_GROUP, BUNDLE_CHILDREN_KEY,
+                              (const char * const *) uuids, g_strv_length (uuids));
+
+  default_uuid = terminal_settings_list_dup_default_child (list);
+  if (default_uuid != NULL && strv_has (uuids, default_uuid))
+    g_key_file_set_string (keyfile, BUNDLE_GROUP, BUNDLE_DEFAULT_KEY, default_uuid);
+
+  keys = list_child_keys (list);
+
+  for (i = 0; uuids[i]; i++) {
+    gs_unref_object GSettings *child;
+
+    child = terminal_settings_list_ref_child_internal (list, uuids[i]);
+
+    for (j = 0; keys[j]; j++) {
+      gs_unref_variant GVariant *value;
+      gs_free char *text = NULL;
+
+      value = g_settings_get_user_value (child, keys[j]);
+      if (value == NULL)
+        continue;
+
+      text = g_variant_print (value, FALSE);
+      g_key_file_set_value (keyfile, uuids[i], keys[j], text);
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+ * terminal_settings_list_import_children:
+ * @list: a #TerminalSettingsList
+ * @keyfile: a #GKeyFile written by terminal_settings_list_export_children()
+ * @error: a #GError location
+ *
+ * Adds the children in @keyfile to @list, keeping their UUIDs, and makes the
+ * bundle's default child the default. Children that already exist are
+ * overwritten. Everything is validated before anything is written. With dconf,
+ * all changes, including the list itself, are written in a single
+ * transaction, so "children-changed" is emitted only once.
+ *
+ * Returns: (transfer full): the UUIDs of the imported children, or %NULL
+ *   with @error filled in
+ */
+char **
+terminal_settings_list_import_children (TerminalSettingsList *list,
+                                        GKeyFile *keyfile,
+                                        GError **error)
+{
+  GSettingsSchema *schema = NULL;
+  GPtrArray *children = NULL;
+  gs_strfreev char **keys = NULL;
+  gs_free char *schema_id = NULL;
+  gs_free char *default_uuid = NULL;
+  char **uuids = NULL;
+  guint i;
+  gboolean rv = FALSE;
+
+  g_return_val_if_fail (TERMINAL_IS_SETTINGS_LIST (list), NULL);
+  g_return_val_if_fail (keyfile != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  schema_id = g_key_file_get_string (keyfile, BUNDLE_GROUP, BUNDLE_SCHEMA_KEY, error);
+  if (schema_id == NULL)
+    goto out;
+
+  if (!g_str_equal (schema_id, list->child_schema_id)) {
+    g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                 "Bundle has schema \"%s\" but \"%s\" was expected",
+                 schema_id, list->child_schema_id);
+    goto out;
+  }
+
+  uuids = g_key_file_get_string_list (keyfile, BUNDLE_GROUP, BUNDLE_CHILDREN_KEY, NULL, error);
+  if (uuids == NULL)
+    goto out;
+
+  for (i = 0; uuids[i]; i++) {
+    if (terminal_settings_list_valid_uuid (uuids[i]) &&
+        !strv_has (uuids + i + 1, uuids[i]))
+      continue;
+
+    g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                 "\"%s\" is not a valid or unique UUID", uuids[i]);
+    goto out;
+  }
+
+  default_uuid = g_key_file_get_string (keyfile, BUNDLE_GROUP, BUNDLE_DEFAULT_KEY, NULL);
+  if (default_uuid != NULL &&
+      ((list->flags & TERMINAL_SETTINGS_LIST_FLAG_HAS_DEFAULT) == 0 ||
+       !strv_has (uuids, default_uuid))) {
+    g_free (default_uuid);
+    default_uuid = NULL;
+  }
+
+  schema = g_settings_schema_source_lookup (g_settings_schema_source_get_default (),
+                                            list->child_schema_id, TRUE);
+  g_assert (schema != NULL);
+  keys = list_child_keys (list);
+
+  /* Parse everything before writing anything */
+  children = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+  for (i = 0; uuids[i]; i++) {
+    GVariant *dict;
+
+    dict = bundle_parse_child (schema, keyfile, uuids[i], keys, error);
+    if (dict == NULL)
+      goto out;
+
+    g_ptr_array_add (children, dict);
+  }
+
+  _terminal_debug_print (TERMINAL_DEBUG_SETTINGS_LIST,
+                         "%s importing %u children\n", G_STRFUNC, children->len);
+
+  if (settings_backend_is_dconf ()) {
+    if (!import_children_dconf (list, uuids, children, keys, default_uuid, error))
+      goto out;
+  } else {
+    import_children_delayed (list, uuids, children, keys, default_uuid);
+  }
+
+  rv = TRUE;
+
+ out:
+  if (children)
+    g_ptr_array_unref (children);
+  if (schema)
+    g_settings_schema_unref (schema);
+
+  if (!rv) {
+    g_strfreev (uuids);
+    return NULL;
+  }
+
+  return uuids;
+}
+
 /**
  * terminal_settings_list_remove_child:
  * @list: a #TerminalSettingsList
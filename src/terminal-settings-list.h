@@ -56,6 +56,21 @@ char *terminal_settings_list_add_child (TerminalSettingsList *list);
 char *terminal_settings_list_clone_child (TerminalSettingsList *list,
                                           const char *uuid);
 
+#define TERMINAL_SETTINGS_LIST_MAX_CLONES (1000)
+
+char **terminal_settings_list_clone_child_n (TerminalSettingsList *list,
+                                             const char *uuid,
+                                             guint n_clones);
+
+gboolean terminal_settings_list_export_children (TerminalSettingsList *list,
+                                                 char **uuids,
+                                                 GKeyFile *keyfile,
+                                                 GError **error);
+
+char **terminal_settings_list_import_children (TerminalSettingsList *list,
+                                               GKeyFile *keyfile,
+                                               GError **error);
+
 void terminal_settings_list_remove_child (TerminalSettingsList *list,
                                           const char *uuid);
 
@@ -0,0 +1,232 @@
+/*
+ * Copyright © 2001, 2002 Havoc Pennington
+ * Copyright © 2008, 2011 Christian Persch
+ * Copyright © 2013, 2014 Red Hat, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* String helpers that run on every pointer motion, drop or search
+ * request. They only depend on GLib, so that gnome-terminal-microbench
+ * can link them without the rest of the server.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <langinfo.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "terminal-text-utils.h"
+#include "terminal-libgsystem.h"
+
+char *
+terminal_util_concat_uris (char **uris,
+                           gsize *length)
+{
+  GString *string;
+  gsize len;
+  guint i;
+
+  len = 0;
+  for (i = 0; uris[i]; ++i)
+    len += strlen (uris[i]) + 1;
+
+  if (length)
+    *length = len;
+
+  string = g_string_sized_new (len + 1);
+  for (i = 0; uris[i]; ++i)
+    {
+      g_string_append (string, uris[i]);
+      g_string_append_c (string, ' ');
+    }
+
+  return g_string_free (string, FALSE);
+}
+
+/*
+ * "1234567", "'", 3 -> "1'234'567"
+ */
+char *
+terminal_util_add_separators (const char *in, const char *sep, int groupby)
+{
+  int inlen, outlen, seplen, firstgrouplen;
+  char *out, *ret;
+
+  if (in[0] == '\0')
+    return g_strdup("");
+
+  inlen = strlen(in);
+  seplen = strlen(sep);
+  outlen = inlen + (inlen - 1) / groupby * seplen;
+  ret = out = g_malloc(outlen + 1);
+
+  firstgrouplen = (inlen - 1) % groupby + 1;
+  strncpy(out, in, firstgrouplen);
+  in += firstgrouplen;
+  out += firstgrouplen;
+
+  while (*in != '\0') {
+    strncpy(out, sep, seplen);
+    out += seplen;
+    strncpy(out, in, groupby);
+    in += groupby;
+    out += groupby;
+  }
+
+  g_assert(out - ret == outlen);
+  *out = '\0';
+  return ret;
+}
+
+/**
+ * terminal_util_number_info:
+ * @str: a dec or hex number as string
+ *
+ * Returns: (transfer full): Useful info about @str, or %NULL if it's too large
+ */
+char *
+terminal_util_number_info (const char *str)
+{
+  gs_free char *decstr = NULL;
+  gs_free char *hextmp = NULL;
+  gs_free char *hexstr = NULL;
+  gs_free char *magnitudestr = NULL;
+  unsigned long long num;
+  gboolean exact = TRUE;
+  gboolean hex = FALSE;
+  const char *thousep;
+
+  errno = 0;
+  /* Deliberately not handle octal */
+  if (str[1] == 'x' || str[1] == 'X') {
+    num = strtoull(str + 2, NULL, 16);
+    hex = TRUE;
+  } else {
+    num = strtoull(str, NULL, 10);
+  }
+  if (errno) {
+    return NULL;
+  }
+
+  /* No use in dec-hex conversion for so small numbers */
+  if (num < 10) {
+    return NULL;
+  }
+
+  /* Group the decimal digits */
+  thousep = nl_langinfo(THOUSEP);
+  if (thousep[0] != '\0') {
+    /* If thousep is nonempty, use printf's magic which can handle
+       more complex separating logics, e.g. 2+2+2+3 for some locales */
+    decstr = g_strdup_printf("%'llu", num);
+  } else {
+    /* If, however, thousep is empty, override it with a space so that we
+       do always group the digits (that's the whole point of this feature;
+       the choice of space guarantees not conflicting with the decimal separator) */
+    gs_free char *tmp = g_strdup_printf("%llu", num);
+    thousep = " ";
+    decstr = terminal_util_add_separators (tmp, thousep, 3);
+  }
+
+  /* Group the hex digits by 4 using the same nonempty separator */
+  hextmp = g_strdup_printf("%llx", num);
+  hexstr = terminal_util_add_separators (hextmp, thousep, 4);
+
+  /* Find out the human-readable magnitude, e.g. 15.99 Mi */
+  if (num >= 1024) {
+    int power = 0;
+    while (num >= 1024 * 1024) {
+      power++;
+      if (num % 1024 != 0)
+        exact = FALSE;
+      num /= 1024;
+    }
+    /* Show 2 fraction digits, always rounding downwards. Printf rounds floats to the nearest representable value,
+       so do the calculation with integers until we get 100-fold the desired value, and then switch to float. */
+    if (100 * num % 1024 != 0)
+      exact = FALSE;
+    num = 100 * num / 1024;
+    magnitudestr = g_strdup_printf(" %s %.2f %ci", exact ? "=" : "≈", (double) num / 100, "KMGTPE"[power]);
+  } else {
+    magnitudestr = g_strdup("");
+  }
+
+  return g_strdup_printf(hex ? "0x%2$s = %1$s%3$s" : "%s = 0x%s%s", decstr, hexstr, magnitudestr);
+}
+
+char *
+terminal_util_normalize_casefold_and_unaccent (const char *str)
+{
+  gs_free char *casefolded = NULL, *normalized = NULL;
+  char *retval = NULL;
+
+  if (str == NULL)
+    goto out;
+
+  normalized = g_utf8_normalize (str, -1, G_NORMALIZE_ALL_COMPOSE);
+  casefolded = g_utf8_casefold (normalized, -1);
+  retval = g_str_to_ascii (casefolded, NULL);
+
+ out:
+  return retval;
+}
+
+char **
+terminal_util_normalize_casefold_and_unaccent_terms (const char* const *terms)
+{
+  char **casefolded_terms;
+  guint i, n;
+
+  n = g_strv_length ((char **) terms);
+  casefolded_terms = g_new (char *, n + 1);
+
+  for (i = 0; i < n; i++)
+    casefolded_terms[i] = terminal_util_normalize_casefold_and_unaccent (terms[i]);
+  casefolded_terms[n] = NULL;
+
+  return casefolded_terms;
+}
+
+gboolean
+terminal_util_match_terms (const char        *str,
+                           const char* const *terms)
+{
+  gs_free char *casefolded_str = NULL;
+  gboolean matches = TRUE;
+  guint i;
+
+  if (str == NULL)
+    {
+      matches = FALSE;
+      goto out;
+    }
+
+  casefolded_str = terminal_util_normalize_casefold_and_unaccent (str);
+  for (i = 0; terms[i] != NULL; i++)
+    {
+      if (strstr (casefolded_str, terms[i]) == NULL)
+        {
+          matches = FALSE;
+          break;
+        }
+    }
+
+ out:
+  return matches;
+}
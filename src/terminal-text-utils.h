@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2001 Havoc Pennington
+ * Copyright © 2008, 2010 Christian Persch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TERMINAL_TEXT_UTILS_H
+#define TERMINAL_TEXT_UTILS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+char *terminal_util_concat_uris (char **uris,
+                                 gsize *length);
+
+char *terminal_util_add_separators (const char *in,
+                                    const char *sep,
+                                    int         groupby);
+
+char *terminal_util_number_info (const char *str);
+
+char *terminal_util_normalize_casefold_and_unaccent (const char *str);
+
+char **terminal_util_normalize_casefold_and_unaccent_terms (const char* const *terms);
+
+gboolean terminal_util_match_terms (const char        *str,
+                                    const char* const *terms);
+
+G_END_DECLS
+
+#endif /* TERMINAL_TEXT_UTILS_H */
@@ -23,6 +23,7 @@
 #include <gtk/gtk.h>
 
 #include "terminal-screen.h"
+#include "terminal-text-utils.h"
 
 G_BEGIN_DECLS
 
@@ -48,9 +49,6 @@ void terminal_util_open_url (GtkWidget *parent,
 
 void terminal_util_transform_uris_to_quoted_fuse_paths (char **uris);
 
-char *terminal_util_concat_uris (char **uris,
-                                 gsize *length);
-
 char *terminal_util_get_licence_text (void);
 
 void terminal_util_load_builder_resource (const char *path,
@@ -89,8 +87,6 @@ void terminal_g_settings_set_rgba_palette (GSettings      *settings,
 
 void terminal_util_bind_mnemonic_label_sensitivity (GtkWidget *widget);
 
-char *terminal_util_number_info (const char *str);
-
 G_END_DECLS
 
 #endif /* TERMINAL_UTIL_H */
@@ -34,6 +34,7 @@
 #include "terminal-enums.h"
 #include "terminal-encoding.h"
 #include "terminal-icon-button.h"
+#include "terminal-info-bar.h"
 #include "terminal-intl.h"
 #include "terminal-mdi-container.h"
 #include "terminal-notebook.h"
@@ -80,6 +81,8 @@ struct _TerminalWindowPrivate
   GtkWidget *confirm_close_dialog;
   TerminalSearchPopover *search_popover;
 
+  gint64 last_frame_time; /* for the perf debug category */
+
   guint menubar_visible : 1;
   guint use_default_menubar_visibility : 1;
 
@@ -207,6 +210,8 @@ static void help_about_callback           (GtkAction *action,
 #ifdef ENABLE_INSPECTOR
 static void help_inspector_callback       (GtkAction *action,
                                            TerminalWindow *window);
+static void help_memory_report_callback   (GtkAction *action,
+                                           TerminalWindow *window);
 #endif
 
 static gboolean find_larger_zoom_factor  (double  current,
@@ -458,14 +463,101 @@ action_new_profile_cb (GSimpleAction *action,
 
 
 #ifdef ENABLE_SAVE
+
+/* Saving the contents */
+
+typedef struct {
+  TerminalScreen *screen;
+  GtkWidget *info_bar;
+  GCancellable *cancellable;
+} SaveContentsData;
+
+static void
+save_contents_progress_cb (TerminalScreen *screen,
+                           double fraction,
+                           gpointer user_data)
+{
+  SaveContentsData *data = user_data;
+
+  terminal_info_bar_set_fraction (TERMINAL_INFO_BAR (data->info_bar), fraction);
+}
+
+static void
+save_contents_info_bar_response_cb (GtkWidget *info_bar,
+                                    int response,
+                                    SaveContentsData *data)
+{
+  if (response == GTK_RESPONSE_CANCEL)
+    g_cancellable_cancel (data->cancellable);
+}
+
+static void
+save_contents_done_cb (GObject *source_object,
+                       GAsyncResult *result,
+                       gpointer user_data)
+{
+  SaveContentsData *data = user_data;
+  gs_free_error GError *error = NULL;
+
+  gtk_widget_destroy (data->info_bar);
+  g_object_unref (data->info_bar);
+
+  if (!terminal_screen_save_contents_finish (data->screen, result, &error) &&
+      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    GtkWindow *parent;
+
+    parent = (GtkWindow*) gtk_widget_get_ancestor (GTK_WIDGET (data->screen), GTK_TYPE_WINDOW);
+    terminal_util_show_error_dialog (parent, NULL, error,
+                                     "%s", _("Could not save contents"));
+  }
+
+  g_object_unref (data->screen);
+  g_object_unref (data->cancellable);
+  g_slice_free (SaveContentsData, data);
+}
+
+static void
+save_contents_start (TerminalScreen *screen,
+                     GFile *file)
+{
+  SaveContentsData *data;
+  gs_free char *basename = NULL;
+  gs_free char *display_name = NULL;
+
+  data = g_slice_new0 (SaveContentsData);
+  data->screen = g_object_ref (screen);
+  data->cancellable = g_cancellable_new ();
+
+  display_name = g_file_get_parse_name (file);
+  /* Keep a ref, since the terminal may be destroyed before we're done */
+  data->info_bar = g_object_ref (terminal_info_bar_new (GTK_MESSAGE_INFO,
+                                                        _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                                        NULL));
+  terminal_info_bar_format_text (TERMINAL_INFO_BAR (data->info_bar),
+                                 _("Saving contents to “%s”…"), display_name);
+  terminal_info_bar_set_fraction (TERMINAL_INFO_BAR (data->info_bar), 0.0);
+  g_signal_connect (data->info_bar, "response",
+                    G_CALLBACK (save_contents_info_bar_response_cb), data);
+
+  gtk_widget_set_halign (data->info_bar, GTK_ALIGN_FILL);
+  gtk_widget_set_valign (data->info_bar, GTK_ALIGN_START);
+  gtk_overlay_add_overlay (GTK_OVERLAY (terminal_screen_container_get_from_screen (screen)),
+                           data->info_bar);
+  gtk_widget_show (data->info_bar);
+
+  basename = g_file_get_basename (file);
+  terminal_screen_save_contents_async (screen, file,
+                                       basename != NULL && g_str_has_suffix (basename, ".gz"),
+                                       data->cancellable,
+                                       save_contents_progress_cb, data,
+                                       save_contents_done_cb, data);
+}
+
 static void
 save_contents_dialog_on_response (GtkDialog *dialog, gint response_id, gpointer terminal)
 {
-  GtkWindow *parent;
   gs_free gchar *filename_uri = NULL;
   gs_unref_object GFile *file = NULL;
-  GOutputStream *stream;
-  gs_free_error GError *error = NULL;
 
   if (response_id != GTK_RESPONSE_ACCEPT)
     {
@@ -473,7 +565,6 @@ save_contents_dialog_on_response (GtkDialog *dialog, gint response_id, gpointer
       return;
     }
 
-  parent = (GtkWindow*) gtk_widget_get_ancestor (GTK_WIDGET (terminal), GTK_TYPE_WINDOW);
   filename_uri = gtk_file_chooser_get_uri (GTK_FILE_CHOOSER (dialog));
 
   gtk_widget_destroy (GTK_WIDGET (dialog));
@@ -482,26 +573,7 @@ save_contents_dialog_on_response (GtkDialog *dialog, gint response_id, gpointer
     return;
 
   file = g_file_new_for_uri (filename_uri);
-  stream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error));
-
-  if (stream)
-    {
-      /* XXX
-       * FIXME
-       * This is a sync operation.
-       * Should be replaced with the async version when vte implements that.
-       */
-      vte_terminal_write_contents_sync (terminal, stream,
-					VTE_WRITE_DEFAULT,
-					NULL, &error);
-      g_object_unref (stream);
-    }
-
-  if (error)
-    {
-      terminal_util_show_error_dialog (parent, NULL, error,
-				       "%s", _("Could not save contents"));
-    }
+  save_contents_start (terminal, file);
 }
 #endif /* ENABLE_SAVE */
 
@@ -870,14 +942,17 @@ search_popover_search_cb (TerminalSearchPopover *popover,
                           TerminalWindow *window)
 {
   TerminalWindowPrivate *priv = window->priv;
+  gint64 span;
 
   if (G_UNLIKELY (priv->active_screen == NULL))
     return;
 
+  span = _terminal_debug_span_begin ("search");
   if (backward)
     vte_terminal_search_find_previous (VTE_TERMINAL (priv->active_screen));
   else
     vte_terminal_search_find_next (VTE_TERMINAL (priv->active_screen));
+  _terminal_debug_span_end (span, "search");
 }
 
 static void
@@ -969,9 +1044,13 @@ action_find_cb (GSimpleAction *action,
   if (g_str_equal (mode, "find")) {
     terminal_window_ensure_search_popover (window);
   } else if (g_str_equal (mode, "next")) {
+    gint64 span = _terminal_debug_span_begin ("search");
     vte_terminal_search_find_next (VTE_TERMINAL (priv->active_screen));
+    _terminal_debug_span_end (span, "search");
   } else if (g_str_equal (mode, "previous")) {
+    gint64 span = _terminal_debug_span_begin ("search");
     vte_terminal_search_find_previous (VTE_TERMINAL (priv->active_screen));
+    _terminal_debug_span_end (span, "search");
   } else if (g_str_equal (mode, "clear")) {
 #ifdef WITH_PCRE2
     vte_terminal_search_set_regex (VTE_TERMINAL (priv->active_screen), NULL, 0);
@@ -2261,6 +2340,31 @@ terminal_window_size_allocate_cb (GtkWidget *widget,
 }
 #endif /* ENABLE_DEBUG */
 
+/* Reports the interval between consecutive frames while the window
+ * keeps repainting, e.g. because a terminal is busy with output.
+ * This prints a line per frame, so it has its own "frames" category
+ * instead of flooding the "perf" output; gnome-terminal-bench collects
+ * these.
+ */
+static void
+terminal_window_frame_clock_after_paint_cb (GdkFrameClock  *frame_clock,
+                                            TerminalWindow *window)
+{
+  TerminalWindowPrivate *priv = window->priv;
+  gint64 frame_time;
+
+  frame_time = g_get_monotonic_time ();
+
+  /* Gaps of a second or more mean we went idle in between */
+  if (priv->last_frame_time != 0 &&
+      frame_time - priv->last_frame_time < G_USEC_PER_SEC)
+    _terminal_debug_print (TERMINAL_DEBUG_FRAMES,
+                           "[frames] frame interval %.3f ms\n",
+                           (frame_time - priv->last_frame_time) / 1000.);
+
+  priv->last_frame_time = frame_time;
+}
+
 static void
 terminal_window_realize (GtkWidget *widget)
 {
@@ -2278,6 +2382,11 @@ terminal_window_realize (GtkWidget *widget)
 
   GTK_WIDGET_CLASS (terminal_window_parent_class)->realize (widget);
 
+  _TERMINAL_DEBUG_IF (TERMINAL_DEBUG_FRAMES)
+    g_signal_connect_object (gtk_widget_get_frame_clock (widget), "after-paint",
+                             G_CALLBACK (terminal_window_frame_clock_after_paint_cb),
+                             window, 0);
+
   /* Need to do this now since this requires the window to be realized */
   if (priv->active_screen != NULL)
     sync_screen_icon_title (priv->active_screen, NULL, window);
@@ -2377,17 +2486,32 @@ terminal_window_screen_changed (GtkWidget *widget,
 
 static void
 terminal_window_profile_list_changed_cb (TerminalSettingsList *profiles_list,
+                                         char **added,
+                                         char **removed,
                                          TerminalWindow *window)
 {
+  gint64 span;
+
+  /* The menus are sorted by name, so a reordered list changes nothing */
+  if (added != NULL && added[0] == NULL &&
+      removed != NULL && removed[0] == NULL)
+    return;
+
+  span = _terminal_debug_span_begin ("profile menu rebuild");
   terminal_window_update_set_profile_menu (window);
   terminal_window_update_new_terminal_menus (window);
+  _terminal_debug_span_end (span, "profile menu rebuild");
 }
 
 static void
 terminal_window_encoding_list_changed_cb (TerminalApp *app,
                                           TerminalWindow *window)
 {
+  gint64 span;
+
+  span = _terminal_debug_span_begin ("encoding menu rebuild");
   terminal_window_update_encoding_menu (window);
+  _terminal_debug_span_end (span, "encoding menu rebuild");
 }
 
 static void
@@ -2550,6 +2674,9 @@ terminal_window_init (TerminalWindow *window)
       { "HelpInspector", NULL, N_("_Inspector"), NULL,
         NULL,
         G_CALLBACK (help_inspector_callback) },
+      { "HelpMemoryReport", NULL, N_("_Memory Report"), NULL,
+        NULL,
+        G_CALLBACK (help_memory_report_callback) },
 #endif
 
       /* Popup menu */
@@ -2622,6 +2749,9 @@ terminal_window_init (TerminalWindow *window)
   GtkClipboard *clipboard;
   uuid_t u;
   char uuidstr[37], role[64];
+  gint64 span;
+
+  span = _terminal_debug_span_begin ("terminal_window_init");
 
   priv = window->priv = G_TYPE_INSTANCE_GET_PRIVATE (window, TERMINAL_TYPE_WINDOW, TerminalWindowPrivate);
 
@@ -2745,6 +2875,9 @@ terminal_window_init (TerminalWindow *window)
   gtk_ui_manager_add_ui (manager, priv->ui_id,
                          "/menubar/Help", "HelpInspector", "HelpInspector",
                          GTK_UI_MANAGER_MENUITEM, FALSE);
+  gtk_ui_manager_add_ui (manager, priv->ui_id,
+                         "/menubar/Help", "HelpMemoryReport", "HelpMemoryReport",
+                         GTK_UI_MANAGER_MENUITEM, FALSE);
 #endif
 
   priv->menubar = gtk_ui_manager_get_widget (manager, "/menubar");
@@ -2757,7 +2890,7 @@ terminal_window_init (TerminalWindow *window)
 
   app = terminal_app_get ();
   profiles_list = terminal_app_get_profiles_list (app);
-  terminal_window_profile_list_changed_cb (profiles_list, window);
+  terminal_window_profile_list_changed_cb (profiles_list, NULL, NULL, window);
   g_signal_connect (profiles_list, "children-changed",
                     G_CALLBACK (terminal_window_profile_list_changed_cb), window);
   
@@ -2783,6 +2916,9 @@ terminal_window_init (TerminalWindow *window)
 
   g_snprintf (role, sizeof (role), "gnome-terminal-window-%s", uuidstr);
   gtk_window_set_role (GTK_WINDOW (window), role);
+
+  _terminal_debug_counter_add ("windows created", 1);
+  _terminal_debug_span_end (span, "terminal_window_init");
 }
 
 static void
@@ -3924,6 +4060,182 @@ help_inspector_callback (GtkAction *action,
 {
   gtk_window_set_interactive_debugging (TRUE);
 }
+
+enum {
+  MEMORY_REPORT_RESPONSE_REFRESH = 1
+};
+
+enum {
+  MEMORY_REPORT_COLUMN_TITLE,
+  MEMORY_REPORT_COLUMN_SCROLLBACK,
+  MEMORY_REPORT_COLUMN_SIZE,
+  MEMORY_REPORT_COLUMN_BYTES,
+  MEMORY_REPORT_COLUMN_MATCH_TAGS,
+  MEMORY_REPORT_COLUMN_WIDGETS,
+  N_MEMORY_REPORT_COLUMNS
+};
+
+static void
+memory_report_dialog_refresh (GtkDialog *dialog)
+{
+  GtkListStore *store;
+  GtkLabel *label;
+  gs_unref_variant GVariant *report = NULL;
+  gs_unref_variant GVariant *screens = NULL;
+  gs_free char *regex_size = NULL;
+  GVariantIter iter;
+  GVariant *screen;
+  guint64 regex_bytes;
+
+  store = g_object_get_data (G_OBJECT (dialog), "store");
+  label = g_object_get_data (G_OBJECT (dialog), "label");
+
+  report = g_variant_ref_sink (terminal_app_get_memory_report (terminal_app_get ()));
+  screens = g_variant_lookup_value (report, "screens", G_VARIANT_TYPE ("aa{sv}"));
+  if (!g_variant_lookup (report, "regex-bytes", "t", &regex_bytes))
+    regex_bytes = 0;
+
+  gtk_list_store_clear (store);
+
+  g_variant_iter_init (&iter, screens);
+  while ((screen = g_variant_iter_next_value (&iter)) != NULL) {
+    gs_free char *scrollback = NULL, *size = NULL;
+    const char *title;
+    gint64 lines, limit;
+    guint64 bytes;
+    guint32 match_tags, widgets;
+
+    if (!g_variant_lookup (screen, "title", "&s", &title))
+      title = "";
+    if (!g_variant_lookup (screen, "scrollback-lines", "x", &lines))
+      lines = 0;
+    if (!g_variant_lookup (screen, "scrollback-limit", "x", &limit))
+      limit = 0;
+    if (!g_variant_lookup (screen, "scrollback-bytes", "t", &bytes))
+      bytes = 0;
+    if (!g_variant_lookup (screen, "match-tags", "u", &match_tags))
+      match_tags = 0;
+    if (!g_variant_lookup (screen, "widgets", "u", &widgets))
+      widgets = 0;
+
+    if (limit < 0)
+      scrollback = g_strdup_printf ("%" G_GINT64_FORMAT " (%s)", lines, _("unlimited"));
+    else
+      scrollback = g_strdup_printf ("%" G_GINT64_FORMAT " / %" G_GINT64_FORMAT, lines, limit);
+    size = g_format_size (bytes);
+
+    gtk_list_store_insert_with_values (store, NULL, -1,
+                                       MEMORY_REPORT_COLUMN_TITLE, title,
+                                       MEMORY_REPORT_COLUMN_SCROLLBACK, scrollback,
+                                       MEMORY_REPORT_COLUMN_SIZE, size,
+                                       MEMORY_REPORT_COLUMN_BYTES, bytes,
+                                       MEMORY_REPORT_COLUMN_MATCH_TAGS, match_tags,
+                                       MEMORY_REPORT_COLUMN_WIDGETS, widgets,
+                                       -1);
+    g_variant_unref (screen);
+  }
+
+  if (regex_bytes > 0) {
+    regex_size = g_format_size (regex_bytes);
+    gtk_label_set_text (label, regex_size);
+  } else {
+    gtk_label_set_text (label, _("Unknown"));
+  }
+}
+
+static void
+memory_report_dialog_response_cb (GtkDialog *dialog,
+                                  int response,
+                                  gpointer user_data)
+{
+  if (response == MEMORY_REPORT_RESPONSE_REFRESH)
+    memory_report_dialog_refresh (dialog);
+  else
+    gtk_widget_destroy (GTK_WIDGET (dialog));
+}
+
+static void
+memory_report_add_column (GtkTreeView *tree_view,
+                          const char *title,
+                          int column,
+                          int sort_column)
+{
+  GtkTreeViewColumn *tree_column;
+
+  tree_column = gtk_tree_view_column_new_with_attributes (title,
+                                                          gtk_cell_renderer_text_new (),
+                                                          "text", column,
+                                                          NULL);
+  gtk_tree_view_column_set_sort_column_id (tree_column, sort_column);
+  gtk_tree_view_column_set_resizable (tree_column, TRUE);
+  gtk_tree_view_append_column (tree_view, tree_column);
+}
+
+/* Which tab uses how much memory; mainly to find the one whose unlimited
+ * scrollback keeps growing.
+ */
+static void
+help_memory_report_callback (GtkAction *action,
+                             TerminalWindow *window)
+{
+  GtkWidget *dialog, *content_area, *scrolled_window, *tree_view, *box, *label;
+  GtkListStore *store;
+
+  dialog = gtk_dialog_new_with_buttons (_("Memory Report"),
+                                        GTK_WINDOW (window),
+                                        GTK_DIALOG_DESTROY_WITH_PARENT,
+                                        _("_Refresh"), MEMORY_REPORT_RESPONSE_REFRESH,
+                                        _("_Close"), GTK_RESPONSE_CLOSE,
+                                        NULL);
+  gtk_window_set_default_size (GTK_WINDOW (dialog), 640, 320);
+
+  store = gtk_list_store_new (N_MEMORY_REPORT_COLUMNS,
+                              G_TYPE_STRING,
+                              G_TYPE_STRING,
+                              G_TYPE_STRING,
+                              G_TYPE_UINT64,
+                              G_TYPE_UINT,
+                              G_TYPE_UINT);
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+                                        MEMORY_REPORT_COLUMN_BYTES,
+                                        GTK_SORT_DESCENDING);
+
+  tree_view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+  memory_report_add_column (GTK_TREE_VIEW (tree_view), _("Title"),
+                            MEMORY_REPORT_COLUMN_TITLE, MEMORY_REPORT_COLUMN_TITLE);
+  memory_report_add_column (GTK_TREE_VIEW (tree_view), _("Scrollback Lines"),
+                            MEMORY_REPORT_COLUMN_SCROLLBACK, MEMORY_REPORT_COLUMN_BYTES);
+  memory_report_add_column (GTK_TREE_VIEW (tree_view), _("Scrollback Size"),
+                            MEMORY_REPORT_COLUMN_SIZE, MEMORY_REPORT_COLUMN_BYTES);
+  memory_report_add_column (GTK_TREE_VIEW (tree_view), _("Match Tags"),
+                            MEMORY_REPORT_COLUMN_MATCH_TAGS, MEMORY_REPORT_COLUMN_MATCH_TAGS);
+  memory_report_add_column (GTK_TREE_VIEW (tree_view), _("Widgets"),
+                            MEMORY_REPORT_COLUMN_WIDGETS, MEMORY_REPORT_COLUMN_WIDGETS);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled_window), GTK_SHADOW_IN);
+  gtk_widget_set_vexpand (scrolled_window, TRUE);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), tree_view);
+
+  box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+  gtk_box_pack_start (GTK_BOX (box), gtk_label_new (_("Shared URL regexes:")), FALSE, FALSE, 0);
+  label = gtk_label_new (NULL);
+  gtk_box_pack_start (GTK_BOX (box), label, FALSE, FALSE, 0);
+
+  content_area = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
+  gtk_container_set_border_width (GTK_CONTAINER (content_area), 6);
+  gtk_box_set_spacing (GTK_BOX (content_area), 6);
+  gtk_box_pack_start (GTK_BOX (content_area), scrolled_window, TRUE, TRUE, 0);
+  gtk_box_pack_start (GTK_BOX (content_area), box, FALSE, FALSE, 0);
+
+  g_object_set_data_full (G_OBJECT (dialog), "store", store, g_object_unref);
+  g_object_set_data (G_OBJECT (dialog), "label", label);
+  g_signal_connect (dialog, "response",
+                    G_CALLBACK (memory_report_dialog_response_cb), NULL);
+
+  memory_report_dialog_refresh (GTK_DIALOG (dialog));
+  gtk_widget_show_all (dialog);
+}
 #endif
 
 GtkUIManager *
@@ -42,6 +42,133 @@
 #include "terminal-defines.h"
 #include "terminal-client-utils.h"
 
+/**
+ * handle_layout:
+ * @factory:
+ * @options: a #TerminalOptions
+ * @error: a #GError to fill in
+ *
+ * Creates all windows and tabs in @options with a single RestoreLayout
+ * call, which lets the server build them in one pass.
+ *
+ * Returns: %TRUE if @options could be successfully handled, or %FALSE on
+ *   error
+ */
+static gboolean
+handle_layout (TerminalFactory *factory,
+               TerminalOptions *options,
+               GError **error)
+{
+  GVariantBuilder builder, windows;
+  GVariant *receivers;
+  char **errors;
+  GList *lw, *lt;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&builder, "{sv}",
+                         "display", g_variant_new_bytestring (options->display_name));
+  if (options->startup_id)
+    g_variant_builder_add (&builder, "{sv}",
+                           "desktop-startup-id", g_variant_new_bytestring (options->startup_id));
+  /* Only adds the environment */
+  terminal_client_append_exec_options (&builder, NULL, NULL, 0, FALSE);
+
+  g_variant_builder_init (&windows, G_VARIANT_TYPE ("aa{sv}"));
+  for (lw = options->initial_windows; lw != NULL; lw = lw->next)
+    {
+      InitialWindow *iw = lw->data;
+
+      g_variant_builder_open (&windows, G_VARIANT_TYPE ("a{sv}"));
+
+      terminal_client_append_create_instance_options (&windows,
+                                                      options->display_name,
+                                                      NULL /* startup id */,
+                                                      iw->geometry,
+                                                      iw->role,
+                                                      NULL /* profile */,
+                                                      NULL /* title */,
+                                                      FALSE /* active */,
+                                                      iw->start_maximized,
+                                                      iw->start_fullscreen);
+      /* Restored windows shouldn't demand attention; see bug #586308. */
+      if (iw->source_tag == SOURCE_SESSION)
+        g_variant_builder_add (&windows, "{sv}",
+                               "present-window", g_variant_new_boolean (FALSE));
+      if (iw->force_menubar_state)
+        g_variant_builder_add (&windows, "{sv}",
+                               "show-menubar", g_variant_new_boolean (iw->menubar_state));
+
+      g_variant_builder_open (&windows, G_VARIANT_TYPE ("{sv}"));
+      g_variant_builder_add (&windows, "s", "tabs");
+      g_variant_builder_open (&windows, G_VARIANT_TYPE ("v"));
+      g_variant_builder_open (&windows, G_VARIANT_TYPE ("aa{sv}"));
+
+      for (lt = iw->tabs; lt != NULL; lt = lt->next)
+        {
+          InitialTab *it = lt->data;
+          const char *profile, *working_dir;
+          char **argv;
+          int argc;
+
+          profile = it->profile ? it->profile : options->default_profile;
+          working_dir = it->working_dir ? it->working_dir : options->default_working_dir;
+          argv = it->exec_argv ? it->exec_argv : options->exec_argv;
+          argc = argv ? g_strv_length (argv) : 0;
+
+          g_variant_builder_open (&windows, G_VARIANT_TYPE ("a{sv}"));
+          if (profile)
+            g_variant_builder_add (&windows, "{sv}",
+                                   "profile", g_variant_new_string (profile));
+          if (it->profile ? it->profile_fallback : options->default_profile_fallback)
+            g_variant_builder_add (&windows, "{sv}",
+                                   "profile-fallback", g_variant_new_boolean (TRUE));
+          if (it->active)
+            g_variant_builder_add (&windows, "{sv}",
+                                   "active", g_variant_new_boolean (TRUE));
+          if (options->zoom_set || it->zoom_set)
+            g_variant_builder_add (&windows, "{sv}",
+                                   "zoom", g_variant_new_double (it->zoom_set ? it->zoom : options->zoom));
+          if (it->scrollback_file)
+            g_variant_builder_add (&windows, "{sv}",
+                                   "scrollback-file", g_variant_new_bytestring (it->scrollback_file));
+          if (working_dir)
+            g_variant_builder_add (&windows, "{sv}",
+                                   "cwd", g_variant_new_bytestring (working_dir));
+          if (argc == 0)
+            g_variant_builder_add (&windows, "{sv}",
+                                   "shell", g_variant_new_boolean (TRUE));
+          else
+            g_variant_builder_add (&windows, "{sv}",
+                                   "arguments", g_variant_new_bytestring_array ((const char * const *) argv, argc));
+          g_variant_builder_close (&windows); /* a{sv} */
+        }
+
+      g_variant_builder_close (&windows); /* aa{sv} */
+      g_variant_builder_close (&windows); /* v */
+      g_variant_builder_close (&windows); /* {sv} */
+
+      g_variant_builder_close (&windows); /* a{sv} */
+    }
+
+  if (!terminal_factory_call_restore_layout_sync (factory,
+                                                  g_variant_builder_end (&builder),
+                                                  g_variant_builder_end (&windows),
+                                                  &receivers,
+                                                  &errors,
+                                                  NULL /* cancellable */,
+                                                  error))
+    return FALSE;
+
+  /* Tabs that couldn't be restored were skipped */
+  for (i = 0; errors[i] != NULL; i++)
+    g_printerr ("Error creating terminal: %s\n", errors[i]);
+  g_strfreev (errors);
+
+  g_variant_unref (receivers);
+  return TRUE;
+}
+
 /**
  * handle_options:
  * @app:
@@ -69,6 +196,26 @@ handle_options (TerminalFactory *factory,
                                                         options->screen_number);
 #endif
 
+  if (options->save_config_file)
+    {
+      /* Writing out big scrollbacks can take longer than the default timeout */
+      g_dbus_proxy_set_default_timeout (G_DBUS_PROXY (factory), G_MAXINT);
+
+      if (!terminal_factory_call_save_config_sync (factory,
+                                                   options->save_config_file,
+                                                   NULL /* cancellable */,
+                                                   error))
+        return FALSE;
+
+      /* Only open windows when asked to */
+      if (options->initial_windows == NULL)
+        return TRUE;
+    }
+
+  /* Build restored layouts in one go */
+  if (options->loaded_config && options->initial_windows != NULL)
+    return handle_layout (factory, options, error);
+
   /* Make sure we open at least one window */
   terminal_options_ensure_window (options);
 
@@ -107,6 +254,10 @@ handle_options (TerminalFactory *factory,
                                                           iw->start_maximized,
                                                           iw->start_fullscreen);
 
+          if (it->profile ? it->profile_fallback : options->default_profile_fallback)
+            g_variant_builder_add (&builder, "{sv}",
+                                   "profile-fallback", g_variant_new_boolean (TRUE));
+
           if (window_id)
             g_variant_builder_add (&builder, "{sv}",
                                    "window-id", g_variant_new_uint32 (window_id));
@@ -115,6 +266,9 @@ handle_options (TerminalFactory *factory,
           if (iw->source_tag == SOURCE_SESSION)
             g_variant_builder_add (&builder, "{sv}",
                                    "present-window", g_variant_new_boolean (FALSE));
+          if (it->scrollback_file)
+            g_variant_builder_add (&builder, "{sv}",
+                                   "scrollback-file", g_variant_new_bytestring (it->scrollback_file));
           if (options->zoom_set || it->zoom_set)
             g_variant_builder_add (&builder, "{sv}",
                                    "zoom", g_variant_new_double (it->zoom_set ? it->zoom : options->zoom));
@@ -196,6 +350,31 @@ handle_options (TerminalFactory *factory,
   return TRUE;
 }
 
+/* Fast path: determine display and startup ID from the environment,
+ * without initialising GDK.
+ */
+static gboolean
+get_display_from_environment (TerminalOptions *options)
+{
+  char *display_name;
+  gboolean is_x11;
+
+  display_name = terminal_client_get_display_name_from_environment (&is_x11);
+  if (display_name == NULL)
+    return FALSE;
+
+  if (options->startup_id == NULL && is_x11) {
+    options->startup_id = terminal_client_get_fallback_startup_id_for_display (display_name);
+    if (options->startup_id == NULL) {
+      g_free (display_name);
+      return FALSE;
+    }
+  }
+
+  options->display_name = display_name;
+  return TRUE;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -208,6 +387,9 @@ main (int argc, char **argv)
   GError *error = NULL;
   char *working_directory;
   int exit_code = EXIT_FAILURE;
+  gint64 start_time;
+
+  start_time = g_get_monotonic_time ();
 
   setlocale (LC_ALL, "");
 
@@ -239,13 +421,29 @@ main (int argc, char **argv)
 
   g_set_application_name (_("Terminal"));
 
-  /* Do this here so that gdk_display is initialized */
-  if (options->startup_id == NULL)
-    options->startup_id = terminal_client_get_fallback_startup_id ();
+  if (options->gdk_initialized ||
+      !get_display_from_environment (options)) {
+    if (!options->gdk_initialized) {
+      if (!gdk_init_check (NULL, NULL)) {
+        g_printerr (_("Failed to open display\n"));
+        goto out;
+      }
+      options->gdk_initialized = TRUE;
+    }
+
+    /* Do this here so that gdk_display is initialized */
+    if (options->startup_id == NULL)
+      options->startup_id = terminal_client_get_fallback_startup_id ();
+
+    display = gdk_display_get_default ();
+    display_name = gdk_display_get_name (display);
+    options->display_name = g_strdup (display_name);
+  }
 
-  display = gdk_display_get_default ();
-  display_name = gdk_display_get_name (display);
-  options->display_name = g_strdup (display_name);
+  _terminal_debug_print (TERMINAL_DEBUG_PERF,
+                         "Client cold start: %.3f ms to first D-Bus call (%s)\n",
+                         (g_get_monotonic_time () - start_time) / 1000.,
+                         options->gdk_initialized ? "GDK" : "environment");
 
   factory = terminal_factory_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
                                                      G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |